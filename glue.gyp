@@ -192,6 +192,13 @@
         'upstream.gyp:lcrq-base',
       ],
     },
+    {
+      'target_name': 'linked-crq',
+      'type': 'static_library',
+      'sources': [
+        'src/benchmark/std_glue/glue_linked_crq.cc'
+      ],
+    },
     {
       'target_name': 'lb-stack',
       'type': 'static_library',
@@ -206,6 +213,34 @@
         'src/benchmark/std_glue/glue_lb_queue.cc'
       ],
     },
+    {
+      'target_name': 'mpmc-queue',
+      'type': 'static_library',
+      'sources': [
+        'src/benchmark/std_glue/glue_mpmc_queue.cc'
+      ],
+    },
+    {
+      'target_name': 'locked-heap',
+      'type': 'static_library',
+      'sources': [
+        'src/benchmark/std_glue/glue_locked_heap.cc'
+      ],
+    },
+    {
+      'target_name': 'multiqueue',
+      'type': 'static_library',
+      'sources': [
+        'src/benchmark/std_glue/glue_multiqueue.cc'
+      ],
+    },
+    {
+      'target_name': 'klsm',
+      'type': 'static_library',
+      'sources': [
+        'src/benchmark/std_glue/glue_klsm.cc'
+      ],
+    },
     {
       'target_name': 'hc-ts-cas-stack',
       'type': 'static_library',
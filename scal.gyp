@@ -16,6 +16,8 @@
         'src/util/allocation.h',
         'src/util/allocation.cc',
         'src/util/barrier.h',
+        'src/util/binary_log.h',
+        'src/util/binary_log.cc',
         'src/util/bitmap.h',
         'src/util/malloc-compat.h',
         'src/util/operation_logger.h',
@@ -25,6 +27,8 @@
         'src/util/threadlocals.h',
         'src/util/threadlocals.cc',
         'src/util/time.h',
+        'src/util/topology.h',
+        'src/util/topology.cc',
         'src/util/workloads.h',
         'src/util/workloads.cc',
       ],
@@ -36,6 +40,12 @@
       'sources': [
         'src/benchmark/common.h',
         'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
         'src/util/allocation.h',
         'src/util/allocation.cc',
         'src/util/threadlocals.h',
@@ -52,6 +62,35 @@
       'sources': [
         'src/benchmark/common.h',
         'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
+        'src/util/allocation.h',
+        'src/util/allocation.cc',
+        'src/util/threadlocals.h',
+        'src/util/threadlocals.cc',
+        'src/util/workloads.h',
+        'src/util/workloads.cc',
+        'src/benchmark/mm/mm.cc',
+      ],
+    },
+    {
+      'target_name': 'mm-harness-tcmalloc',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)', '-ltcmalloc_minimal' ],
+      'defines': [ 'SCAL_HAVE_TCMALLOC' ],
+      'sources': [
+        'src/benchmark/common.h',
+        'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
         'src/util/allocation.h',
         'src/util/allocation.cc',
         'src/util/threadlocals.h',
@@ -68,12 +107,24 @@
       'sources': [
         'src/benchmark/common.h',
         'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
         'src/util/allocation.h',
         'src/util/allocation.cc',
         'src/util/threadlocals.h',
         'src/util/threadlocals.cc',
         'src/util/workloads.h',
         'src/util/workloads.cc',
+        'src/benchmark/latency_histogram.h',
+        'src/benchmark/latency_histogram.cc',
+        'src/benchmark/sweep.h',
+        'src/benchmark/sweep.cc',
+        'src/benchmark/throughput_sampler.h',
+        'src/benchmark/throughput_sampler.cc',
         'src/benchmark/prodcon/prodcon.cc',
       ],
     },
@@ -82,9 +133,169 @@
       'type': 'static_library',
       'sources': [
         'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/benchmark/latency_histogram.h',
+        'src/benchmark/latency_histogram.cc',
+        'src/benchmark/sweep.h',
+        'src/benchmark/sweep.cc',
+        'src/benchmark/throughput_sampler.h',
+        'src/benchmark/throughput_sampler.cc',
         'src/benchmark/seqalt/seqalt.cc',
       ],
     },
+    {
+      'target_name': 'prodcon-pq-base',
+      'type': 'static_library',
+      'libraries': [ '<@(default_libraries)' ],
+      'sources': [
+        'src/benchmark/common.h',
+        'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
+        'src/util/allocation.h',
+        'src/util/allocation.cc',
+        'src/util/threadlocals.h',
+        'src/util/threadlocals.cc',
+        'src/util/workloads.h',
+        'src/util/workloads.cc',
+        'src/benchmark/latency_histogram.h',
+        'src/benchmark/latency_histogram.cc',
+        'src/benchmark/prodcon-pq/prodcon-pq.cc',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-base',
+      'type': 'static_library',
+      'libraries': [ '<@(default_libraries)' ],
+      'sources': [
+        'src/benchmark/common.h',
+        'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
+        'src/util/allocation.h',
+        'src/util/allocation.cc',
+        'src/util/threadlocals.h',
+        'src/util/threadlocals.cc',
+        'src/benchmark/bfs/graph.h',
+        'src/benchmark/bfs/graph.cc',
+        'src/benchmark/bfs/bfs_parallel.cc',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-base',
+      'type': 'static_library',
+      'libraries': [ '<@(default_libraries)' ],
+      'sources': [
+        'src/benchmark/common.h',
+        'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/util/topology.h',
+        'src/util/topology.cc',
+        'src/util/allocation.h',
+        'src/util/allocation.cc',
+        'src/util/threadlocals.h',
+        'src/util/threadlocals.cc',
+        'src/benchmark/bfs/graph.h',
+        'src/benchmark/bfs/graph.cc',
+        'src/benchmark/bfs/weighted_graph.h',
+        'src/benchmark/bfs/weighted_graph.cc',
+        'src/benchmark/bfs/sssp_parallel.cc',
+      ],
+    },
+    {
+      'target_name': 'scal-bench',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'defines': [ 'SCAL_DS_REGISTRY' ],
+      'dependencies': [
+        'libscal',
+      ],
+      'sources': [
+        'src/benchmark/common.h',
+        'src/benchmark/common.cc',
+        'src/benchmark/thread_placement.h',
+        'src/benchmark/thread_placement.cc',
+        'src/benchmark/perf_counters.h',
+        'src/benchmark/perf_counters.cc',
+        'src/benchmark/scal-bench/scal-bench.cc',
+        'src/benchmark/std_glue/ds_registry.h',
+        'src/benchmark/std_glue/ds_registry.cc',
+        'src/benchmark/std_glue/glue_flags.cc',
+        # Glue files that need no target specific defines.
+        'src/benchmark/std_glue/glue_ms_queue.cc',
+        'src/benchmark/std_glue/glue_treiber_stack.cc',
+        'src/benchmark/std_glue/glue_kstack.cc',
+        'src/benchmark/std_glue/glue_dds_1random_ms.cc',
+        'src/benchmark/std_glue/glue_dds_1random_treiber.cc',
+        'src/benchmark/std_glue/glue_dds_partrr_ms.cc',
+        'src/benchmark/std_glue/glue_dds_partrr_treiber.cc',
+        'src/benchmark/std_glue/glue_fc_queue.cc',
+        'src/benchmark/std_glue/glue_rd_queue.cc',
+        'src/benchmark/std_glue/glue_sq_queue.cc',
+        'src/benchmark/std_glue/glue_uskfifo.cc',
+        'src/benchmark/std_glue/glue_bskfifo.cc',
+        'src/benchmark/std_glue/glue_ll_dyn_dds_ms.cc',
+        'src/benchmark/std_glue/glue_ll_dyn_dds_treiber.cc',
+        'src/benchmark/std_glue/glue_lb_stack.cc',
+        'src/benchmark/std_glue/glue_lb_queue.cc',
+        'src/benchmark/std_glue/glue_mpmc_queue.cc',
+        'src/benchmark/std_glue/glue_linked_crq.cc',
+        'src/benchmark/std_glue/glue_locked_heap.cc',
+        'src/benchmark/std_glue/glue_multiqueue.cc',
+        'src/benchmark/std_glue/glue_klsm.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_cas_stack.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_stutter_stack.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_interval_stack.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_atomic_stack.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_hardware_stack.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_cas_queue.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_stutter_queue.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_interval_queue.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_atomic_queue.cc',
+        'src/benchmark/std_glue/glue_hardcoded_ts_hardware_queue.cc',
+        'src/benchmark/std_glue/glue_rts_queue.cc',
+        'src/benchmark/std_glue/glue_cts_queue.cc',
+        'src/benchmark/std_glue/glue_ts_cas_deque.cc',
+        'src/benchmark/std_glue/glue_ts_stutter_deque.cc',
+        'src/benchmark/std_glue/glue_ts_interval_deque.cc',
+        'src/benchmark/std_glue/glue_ts_atomic_deque.cc',
+        'src/benchmark/std_glue/glue_ts_hardware_deque.cc',
+        'src/benchmark/std_glue/glue_eb_stack.cc',
+        'src/benchmark/std_glue/glue_lru_dds_ms.cc',
+        'src/benchmark/std_glue/glue_lru_dds_treiber_stack.cc',
+        'src/benchmark/std_glue/glue_ts_atomic_queue.cc',
+        'src/benchmark/std_glue/glue_ts_hardware_queue.cc',
+        'src/benchmark/std_glue/glue_ts_hardware_stack.cc',
+        'src/benchmark/std_glue/glue_ts_interval_queue.cc',
+        'src/benchmark/std_glue/glue_ts_interval_stack.cc',
+        'src/benchmark/std_glue/glue_ts_stutter_queue.cc',
+      ],
+    },
+    {
+      'target_name': 'scal-analyze',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+      ],
+      'sources': [
+        'src/benchmark/scal-analyze/scal-analyze.cc',
+      ],
+    },
     {
       'target_name': 'prodcon-ms',
       'type': 'executable',
@@ -345,6 +556,16 @@
         'glue.gyp:lcrq',
       ],
     },
+    {
+      'target_name': 'prodcon-linked-crq',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'prodcon-base',
+        'glue.gyp:linked-crq',
+      ],
+    },
     {
       'target_name': 'seqalt-lcrq',
       'type': 'executable',
@@ -355,6 +576,16 @@
         'glue.gyp:lcrq',
       ],
     },
+    {
+      'target_name': 'seqalt-linked-crq',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'seqalt-base',
+        'glue.gyp:linked-crq',
+      ],
+    },
     {
       'target_name': 'prodcon-hc-ts-cas-stack',
       'type': 'executable',
@@ -555,6 +786,206 @@
         'glue.gyp:lb-queue',
       ],
     },
+    {
+      'target_name': 'prodcon-mpmc-queue',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'prodcon-base',
+        'glue.gyp:mpmc-queue',
+      ],
+    },
+    {
+      'target_name': 'prodcon-pq-locked-heap',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'prodcon-pq-base',
+        'glue.gyp:locked-heap',
+      ],
+    },
+    {
+      'target_name': 'prodcon-pq-multiqueue',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'prodcon-pq-base',
+        'glue.gyp:multiqueue',
+      ],
+    },
+    {
+      'target_name': 'prodcon-pq-klsm',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'prodcon-pq-base',
+        'glue.gyp:klsm',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-ms',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:ms',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-treiber',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:treiber',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-kstack',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:kstack',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-bs-kfifo',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:bs-kfifo',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-dds-partrr-ms',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:dds-partrr-ms',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-ll-dyn-dds-ms',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:ll-dyn-dds-ms',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-hc-ts-interval-queue',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:hc-ts-interval-queue',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-multiqueue',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:multiqueue',
+      ],
+    },
+    {
+      'target_name': 'bfs-parallel-klsm',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'bfs-parallel-base',
+        'glue.gyp:klsm',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-ms',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:ms',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-kstack',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:kstack',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-bs-kfifo',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:bs-kfifo',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-ll-dyn-dds-ms',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:ll-dyn-dds-ms',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-multiqueue',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:multiqueue',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-klsm',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:klsm',
+      ],
+    },
+    {
+      'target_name': 'sssp-parallel-locked-heap',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'sssp-parallel-base',
+        'glue.gyp:locked-heap',
+      ],
+    },
     {
       'target_name': 'prodcon-lru-dds-ms',
       'type': 'executable',
@@ -935,6 +1366,16 @@
         'glue.gyp:lb-queue',
       ],
     },
+    {
+      'target_name': 'seqalt-mpmc-queue',
+      'type': 'executable',
+      'libraries': [ '<@(default_libraries)' ],
+      'dependencies': [
+        'libscal',
+        'seqalt-base',
+        'glue.gyp:mpmc-queue',
+      ],
+    },
     #{
     #  'target_name': 'seqalt-wf-queue',
     #  'type': 'executable',
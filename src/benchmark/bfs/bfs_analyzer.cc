@@ -15,7 +15,8 @@
 #include "util/scal-time.h"
 
 DEFINE_string(prealloc_size, "1g", "tread local space that is initialized");
-DEFINE_int64(root, -1, "root for BFS; -1: pseudorandom (time-based seed)");
+DEFINE_int64(root, -1, "root for BFS; -1: pseudorandom vertex with edges "
+                        "(time-based seed)");
 
 namespace {
 
@@ -24,15 +25,16 @@ const size_t kMaxDebugLevels = 256;
 }  // namespace
 
 int main(int argc, char **argv) {
-  std::string usage("bfs-analyzer [options] graph_file");
+  std::string usage("bfs-analyzer [options] {graph_file | --gen=<spec>}");
   google::SetUsageMessage(usage);
   uint32_t cmd_index = google::ParseCommandLineFlags(&
       argc, const_cast<char***>(&argv), true);
-  if (cmd_index >= static_cast<uint32_t>(argc)) {
+  const char *graph_file = (cmd_index < static_cast<uint32_t>(argc)) ?
+      argv[cmd_index] : NULL;
+  if ((graph_file == NULL) && FLAGS_gen.empty()) {
     google::ShowUsageWithFlags(google::GetArgv0());
     exit(EXIT_FAILURE);
   }
-  const char *graph_file = argv[cmd_index];
 
   uint64_t tlsize = scal::human_size_to_pages(FLAGS_prealloc_size.c_str(),
                                               FLAGS_prealloc_size.size());
@@ -41,7 +43,7 @@ int main(int argc, char **argv) {
   scal::ThreadContext::assign_context();
 
   SingleList<uint64_t> *q = new SingleList<uint64_t>();
-  Graph *g = Graph::from_graph_file(graph_file);
+  Graph *g = Graph::from_flags(graph_file);
 
   uint64_t debug_levels = 0;
   uint64_t debug_level_cnt[kMaxDebugLevels];
@@ -49,23 +51,22 @@ int main(int argc, char **argv) {
  
   uint64_t root_index;
   if (FLAGS_root == -1) {
-    root_index = scal::rand_range(0, g->size());
+    root_index = g->random_root();
   } else {
     root_index = static_cast<uint64_t>(FLAGS_root);
   }
 
-  Vertex &cur_vertex = g->get(root_index);
-  cur_vertex.distance = 0;
+  g->get(root_index).distance = 0;
   q->enqueue(root_index);
   debug_level_cnt[debug_levels]++;
   uint64_t vertex_index;
   while (q->dequeue(&vertex_index)) {
-    cur_vertex = g->get(vertex_index);  
+    Vertex cur_vertex = g->get(vertex_index);
     if (debug_levels == cur_vertex.distance) {
       debug_levels++;
     }
     for (uint64_t i = 0; i < cur_vertex.neighbors.size(); i++) {
-      Vertex& neighbor = g->get(cur_vertex.neighbors[i]);
+      Vertex neighbor = g->get(cur_vertex.neighbors[i]);
       if (neighbor.distance == Vertex::no_distance) {
         neighbor.distance = cur_vertex.distance + 1;
         q->enqueue(cur_vertex.neighbors[i]);
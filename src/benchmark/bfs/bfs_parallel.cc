@@ -0,0 +1,316 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Parallel breadth-first search with the worklist taken from the glue layer,
+// i.e., any pool that provides ds_new().
+//
+// Threads take vertices from the pool and lower the distances of their
+// neighbors with CAS on Vertex::distance, putting every neighbor whose
+// distance they lowered. Unless the pool is a strict FIFO queue, vertices can
+// be expanded before their final distance is known and are then expanded
+// again once a shorter path is found (re-expansions). Items carry the
+// distance they have been put with, so outdated items are dropped.
+//
+// The search terminates once the pool is empty and no thread is expanding a
+// vertex anymore, which is tracked by a counter of items that have been put
+// but not fully expanded.
+
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "benchmark/bfs/graph.h"
+#include "benchmark/common.h"
+#include "benchmark/perf_counters.h"
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "benchmark/thread_placement.h"
+#include "datastructures/pool.h"
+#include "datastructures/single_list.h"
+#include "util/allocation.h"
+#include "util/platform.h"
+#include "util/random.h"
+#include "util/scal-time.h"
+#include "util/threadlocals.h"
+
+DEFINE_string(prealloc_size, "1g", "tread local space that is initialized");
+DEFINE_uint64(threads, 1, "number of threads");
+DEFINE_int64(root, -1, "root for BFS; -1: pseudorandom vertex with edges");
+DEFINE_bool(check, true, "compare the distances against a sequential BFS");
+DEFINE_bool(print_summary, true, "print execution summary");
+
+namespace {
+
+// Items are (distance << kVertexBits) | (vertex + 1), so that they are
+// never 0 and priority queues order them by distance.
+const uint64_t kVertexBits = 32;
+const uint64_t kVertexMask = (1UL << kVertexBits) - 1;
+
+inline uint64_t EncodeItem(uint64_t vertex, uint64_t distance) {
+  return (distance << kVertexBits) | (vertex + 1);
+}
+
+
+inline uint64_t ItemVertex(uint64_t item) {
+  return (item & kVertexMask) - 1;
+}
+
+
+inline uint64_t ItemDistance(uint64_t item) {
+  return item >> kVertexBits;
+}
+
+
+struct BfsStats {
+  BfsStats() : expansions(0), stale(0), updates(0), empty_gets(0) {}
+
+  // Vertices taken from the pool and expanded.
+  uint64_t expansions;
+  // Items dropped because the vertex has been reached on a shorter path.
+  uint64_t stale;
+  // Successful CAS operations on distances.
+  uint64_t updates;
+  uint64_t empty_gets;
+};
+
+
+// Plain BFS with a sequential queue, see bfs_sequential.cc.
+uint64_t SequentialBfs(Graph* g, uint64_t root, uint64_t* distances) {
+  for (uint64_t i = 0; i < g->size(); i++) {
+    distances[i] = Vertex::no_distance;
+  }
+  const uint64_t start_time = get_utime();
+  SingleList<uint64_t> q;
+  distances[root] = 0;
+  q.enqueue(root);
+  uint64_t vertex_index;
+  while (q.dequeue(&vertex_index)) {
+    const Vertex cur_vertex = g->get(vertex_index);
+    for (uint64_t i = 0; i < cur_vertex.neighbors.size(); i++) {
+      const uint64_t neighbor = cur_vertex.neighbors[i];
+      if (distances[neighbor] == Vertex::no_distance) {
+        distances[neighbor] = distances[vertex_index] + 1;
+        q.enqueue(neighbor);
+      }
+    }
+  }
+  return get_utime() - start_time;
+}
+
+}  // namespace
+
+class BfsBench : public scal::Benchmark {
+ public:
+  BfsBench(uint64_t num_threads,
+           uint64_t thread_prealloc_size,
+           Pool<uint64_t>* ds,
+           Graph* graph,
+           uint64_t pending)
+      : Benchmark(num_threads, thread_prealloc_size, ds),
+        graph_(graph),
+        pending_(pending) {
+  }
+
+  inline const BfsStats& stats() { return stats_; }
+
+ protected:
+  void bench_func(void);
+
+ private:
+  void Expand(Pool<uint64_t>* ds, uint64_t item, BfsStats* stats);
+
+  Graph* graph_;
+  // Items put into the pool that have not been fully expanded yet.
+  std::atomic<uint64_t> pending_;
+  uint8_t pad_[scal::kCachePrefetch];
+  BfsStats stats_;
+};
+
+uint64_t g_num_threads;
+
+int main(int argc, const char **argv) {
+  std::string usage("bfs-parallel [options] {graph_file | --gen=<spec>}");
+  google::SetUsageMessage(usage);
+  uint32_t cmd_index = google::ParseCommandLineFlags(
+      &argc, const_cast<char***>(&argv), true);
+  const char* graph_file = (cmd_index < static_cast<uint32_t>(argc)) ?
+      argv[cmd_index] : NULL;
+  if ((graph_file == NULL) && FLAGS_gen.empty()) {
+    google::ShowUsageWithFlags(google::GetArgv0());
+    exit(EXIT_FAILURE);
+  }
+  if (FLAGS_threads == 0) {
+    fprintf(stderr, "%s: error: at least one thread is required\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+
+  size_t tlsize = scal::HumanSizeToPages(
+      FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
+
+  g_num_threads = FLAGS_threads;
+  scal::ThreadLocalAllocator::Get().Init(tlsize, true);
+  scal::ThreadContext::prepare(g_num_threads + 1);
+  scal::ThreadContext::assign_context();
+
+  Graph* g = Graph::from_flags(graph_file);
+  if ((g->size() == 0) || (g->size() >= kVertexMask)) {
+    fprintf(stderr, "%s: error: unsupported number of vertices: %" PRIu64
+                    "\n", __func__, g->size());
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t root;
+  if (FLAGS_root < 0) {
+    root = g->random_root();
+  } else {
+    root = static_cast<uint64_t>(FLAGS_root);
+  }
+  if (root >= g->size()) {
+    fprintf(stderr, "%s: error: root %" PRIu64 " out of range\n",
+            __func__, root);
+    exit(EXIT_FAILURE);
+  }
+
+  Pool<uint64_t>* ds = static_cast<Pool<uint64_t>*>(ds_new());
+  g->get(root).distance = 0;
+  if (!ds->put(EncodeItem(root, 0))) {
+    fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+    abort();
+  }
+
+  BfsBench* benchmark = new BfsBench(g_num_threads, tlsize, ds, g, 1);
+  benchmark->run();
+  const BfsStats& stats = benchmark->stats();
+  const uint64_t exec_time = benchmark->execution_time();
+
+  // Vertices per level.
+  std::vector<uint64_t> levels;
+  uint64_t reached = 0;
+  for (uint64_t i = 0; i < g->size(); i++) {
+    const uint64_t distance = g->get(i).distance;
+    if (distance == Vertex::no_distance) {
+      continue;
+    }
+    if (distance >= levels.size()) {
+      levels.resize(distance + 1, 0);
+    }
+    levels[distance]++;
+    reached++;
+  }
+
+  uint64_t sequential_time = 0;
+  if (FLAGS_check) {
+    uint64_t* expected = static_cast<uint64_t*>(
+        malloc(g->size() * sizeof(uint64_t)));
+    sequential_time = SequentialBfs(g, root, expected);
+    for (uint64_t i = 0; i < g->size(); i++) {
+      if (g->get(i).distance != expected[i]) {
+        fprintf(stderr, "%s: error: vertex %" PRIu64 " has distance %" PRIu64
+                        " instead of %" PRIu64 "\n",
+                __func__, i, g->get(i).distance, expected[i]);
+        exit(EXIT_FAILURE);
+      }
+    }
+    free(expected);
+  }
+
+  if (FLAGS_print_summary) {
+    printf("{\"threads\": %" PRIu64 " ,\"vertices\": %" PRIu64
+           " ,\"root\": %" PRIu64 " ,\"runtime\": %" PRIu64
+           " ,\"reached\": %" PRIu64 " ,\"expansions\": %" PRIu64
+           " ,\"reexpansions\": %" PRIu64 " ,\"stale\": %" PRIu64
+           " ,\"updates\": %" PRIu64 " ,\"empty_gets\": %" PRIu64,
+           g_num_threads,
+           g->size(),
+           root,
+           exec_time,
+           reached,
+           stats.expansions,
+           stats.expansions - reached,
+           stats.stale,
+           stats.updates,
+           stats.empty_gets);
+    if (FLAGS_check) {
+      printf(" ,\"sequential_runtime\": %" PRIu64 " ,\"speedup\": %.2f",
+             sequential_time,
+             (exec_time == 0) ? 0.0 :
+                 static_cast<double>(sequential_time) / exec_time);
+    }
+    printf(" ,\"levels\": [");
+    for (size_t i = 0; i < levels.size(); i++) {
+      printf("%s%" PRIu64, (i == 0) ? "" : ", ", levels[i]);
+    }
+    printf("]");
+    char *ds_stats = ds_get_stats();
+    if (ds_stats != NULL) {
+      printf(" %s", ds_stats);
+    }
+    if (benchmark->placement() != NULL) {
+      benchmark->placement()->PrintJson(stdout);
+    }
+    if (benchmark->perf_counters() != NULL) {
+      benchmark->perf_counters()->PrintJson(stdout, stats.expansions);
+    }
+    printf("}\n");
+  }
+  return EXIT_SUCCESS;
+}
+
+
+void BfsBench::Expand(Pool<uint64_t>* ds, uint64_t item, BfsStats* stats) {
+  const uint64_t vertex = ItemVertex(item);
+  const Vertex cur_vertex = graph_->get(vertex);
+  const uint64_t distance = cur_vertex.distance;
+  if (ItemDistance(item) > distance) {
+    stats->stale++;
+    return;
+  }
+  stats->expansions++;
+  for (uint64_t i = 0; i < cur_vertex.neighbors.size(); i++) {
+    const uint64_t neighbor_index = cur_vertex.neighbors[i];
+    Vertex neighbor = graph_->get(neighbor_index);
+    uint64_t old_distance = neighbor.distance;
+    while ((distance + 1) < old_distance) {
+      const uint64_t seen = __sync_val_compare_and_swap(
+          &neighbor.distance, old_distance, distance + 1);
+      if (seen == old_distance) {
+        stats->updates++;
+        pending_.fetch_add(1);
+        if (!ds->put(EncodeItem(neighbor_index, distance + 1))) {
+          fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+          abort();
+        }
+        break;
+      }
+      old_distance = seen;
+    }
+  }
+}
+
+
+void BfsBench::bench_func(void) {
+  Pool<uint64_t>* ds = static_cast<Pool<uint64_t>*>(data_);
+  BfsStats stats;
+  uint64_t item;
+  while (true) {
+    if (ds->get(&item)) {
+      Expand(ds, item, &stats);
+      pending_.fetch_sub(1);
+    } else if (pending_.load() == 0) {
+      // Items are only put while expanding another item, i.e., before the
+      // counter drops to 0.
+      break;
+    } else {
+      stats.empty_gets++;
+    }
+  }
+  __sync_fetch_and_add(&stats_.expansions, stats.expansions);
+  __sync_fetch_and_add(&stats_.stale, stats.stale);
+  __sync_fetch_and_add(&stats_.updates, stats.updates);
+  __sync_fetch_and_add(&stats_.empty_gets, stats.empty_gets);
+}
@@ -4,19 +4,48 @@
 
 #include "benchmark/bfs/graph.h"
 
-#include <assert.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
-#include <cstddef>
-#include <cstdlib>
 #include <string>
 #include <vector>
 
-#include "util/malloc.h"
+#include "util/platform.h"
+#include "util/random.h"
+
+DEFINE_bool(graph_cache, true, "store parsed graphs in <graph_file>.csr and "
+                               "map them in later runs");
+DEFINE_uint64(parse_threads, 0, "threads used to parse or generate graphs; "
+                                "0: number of cores");
+DEFINE_string(gen, "", "generate the graph instead of reading a file, e.g., "
+                       "rmat:scale=20,ef=16, grid:x=1000,y=1000, "
+                       "uniform:scale=20,ef=16, regular:scale=20,degree=8");
 
 namespace {
 
+// Layout of a csr file: The header, num_vertices + 1 offsets, and num_edges
+// edges, all of them uint64_t.
+struct CsrHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t num_vertices;
+  uint64_t num_edges;
+};
+
+const uint64_t kCsrMagic = 0x5253436c616373UL;  // "scalCSR"
+const uint64_t kCsrVersion = 1;
+
+// Text files are only split into chunks of at least this size.
+const uint64_t kMinChunkSize = 1 << 16;
+
 void invalid_graph_file(const char *fn) {
   fprintf(stderr, "%s: invalid graph file\n", fn);
   exit(EXIT_FAILURE);
@@ -27,149 +56,945 @@ void invalid_mtx_file(const char* fn) {
   exit(EXIT_FAILURE);
 }
 
-bool inline is_comment(const std::string &source) {
-  if (source.find_first_of("%") == 0) {
-    return true;
+void invalid_csr_file(const char* fn, const char* csr_file) {
+  fprintf(stderr, "%s: %s is not a valid csr file\n", fn, csr_file);
+  exit(EXIT_FAILURE);
+}
+
+uint64_t* alloc_array(uint64_t size) {
+  // Allocate at least one entry, so that empty arrays are valid pointers.
+  uint64_t* array = static_cast<uint64_t*>(
+      malloc((size + 1) * sizeof(uint64_t)));
+  if (array == NULL) {
+    fprintf(stderr, "%s: unable to allocate %" PRIu64 " entries\n",
+            __func__, size);
+    exit(EXIT_FAILURE);
   }
-  return false;
+  return array;
 }
 
-std::vector<uint64_t> inline tokenize(const std::string &source,
-                                      const char *delimiter = " ",
-                                      bool keep_empty = false) {
-  std::vector<uint64_t> results;
-  size_t prev = 0;
-  size_t next = 0;
+bool ends_with(const char* s, const char* suffix) {
+  const size_t len = strlen(s);
+  const size_t suffix_len = strlen(suffix);
+  return (len >= suffix_len) && (strcmp(s + len - suffix_len, suffix) == 0);
+}
+
+
+// A text file mapped into memory.
+class TextFile {
+ public:
+  TextFile(const char* fn, const char* file) : mem_(NULL), size_(0) {
+    const int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "%s: unable to open file %s\n", fn, file);
+      exit(EXIT_FAILURE);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      perror("fstat");
+      exit(EXIT_FAILURE);
+    }
+    size_ = st.st_size;
+    if (size_ > 0) {
+      mem_ = mmap(NULL, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+      if (mem_ == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+      }
+    }
+    close(fd);
+  }
+
+  ~TextFile() {
+    if (mem_ != NULL) {
+      munmap(mem_, size_);
+    }
+  }
+
+  inline const char* begin() const { return static_cast<const char*>(mem_); }
+  inline const char* end() const { return begin() + size_; }
+
+ private:
+  void* mem_;
+  size_t size_;
+};
+
+
+inline const char* skip_line(const char* pos, const char* end) {
+  const char* newline = static_cast<const char*>(
+      memchr(pos, '\n', end - pos));
+  return (newline == NULL) ? end : newline + 1;
+}
+
+
+// Parses the next number of the line starting at *pos. Returns false and
+// leaves *pos at the end of the line if there is none.
+inline bool next_number(const char** pos, const char* end, uint64_t* num) {
+  const char* p = *pos;
+  while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) {
+    p++;
+  }
+  if ((p == end) || (*p == '\n')) {
+    *pos = p;
+    return false;
+  }
+  if ((*p < '0') || (*p > '9')) {
+    invalid_graph_file(__func__);
+  }
+  uint64_t n = 0;
+  while ((p < end) && (*p >= '0') && (*p <= '9')) {
+    n = 10 * n + (*p - '0');
+    p++;
+  }
+  *pos = p;
+  *num = n;
+  return true;
+}
+
+
+// Returns the numbers of the first line that is not a comment, and moves
+// *pos past it.
+std::vector<uint64_t> parse_header(const char** pos, const char* end) {
+  std::vector<uint64_t> numbers;
+  while ((*pos < end) && (**pos == '%')) {
+    *pos = skip_line(*pos, end);
+  }
   uint64_t num;
-  while ((next = source.find_first_of(delimiter, prev)) != std::string::npos) {
-    if (keep_empty || (next - prev != 0)) {
-      num = atol(source.substr(prev, next - prev).c_str());
-      if (num == 0) {
-        invalid_graph_file(__func__);
+  while (next_number(pos, end, &num)) {
+    numbers.push_back(num);
+  }
+  *pos = skip_line(*pos, end);
+  return numbers;
+}
+
+
+// Splits [begin, end) into at most max_chunks chunks that start at the
+// beginning of a line. Chunk i is [(*bounds)[i], (*bounds)[i + 1]).
+void split_lines(const char* begin, const char* end, uint64_t max_chunks,
+                 std::vector<const char*>* bounds) {
+  uint64_t num_chunks = (end - begin) / kMinChunkSize;
+  if (num_chunks > max_chunks) {
+    num_chunks = max_chunks;
+  }
+  if (num_chunks == 0) {
+    num_chunks = 1;
+  }
+  bounds->push_back(begin);
+  for (uint64_t i = 1; i < num_chunks; i++) {
+    const char* pos = begin + (end - begin) * i / num_chunks;
+    if (pos < bounds->back()) {
+      pos = bounds->back();
+    }
+    // A chunk starting right after a newline keeps the line.
+    bounds->push_back((pos[-1] == '\n') ? pos : skip_line(pos, end));
+  }
+  bounds->push_back(end);
+}
+
+
+uint64_t parse_threads() {
+  if (FLAGS_parse_threads != 0) {
+    return FLAGS_parse_threads;
+  }
+  const long cores = scal::number_of_cores();  // NOLINT
+  return (cores > 0) ? cores : 1;
+}
+
+
+template<typename F>
+struct WorkerArg {
+  const F* func;
+  uint64_t id;
+};
+
+
+template<typename F>
+void* worker_start(void* arg) {
+  WorkerArg<F>* worker = static_cast<WorkerArg<F>*>(arg);
+  (*worker->func)(worker->id);
+  return NULL;
+}
+
+
+// Calls func(0), ..., func(num - 1) on num threads and waits for them.
+template<typename F>
+void run_parallel(uint64_t num, const F& func) {
+  std::vector<pthread_t> threads(num);
+  std::vector<WorkerArg<F> > args(num);
+  for (uint64_t i = 0; i < num; i++) {
+    args[i].func = &func;
+    args[i].id = i;
+    if (pthread_create(&threads[i], NULL, worker_start<F>, &args[i]) != 0) {
+      perror("pthread_create");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (uint64_t i = 0; i < num; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+
+// The neighbors of the lines in one chunk of a graph file.
+struct AdjacencyChunk {
+  std::vector<uint64_t> degrees;
+  std::vector<uint64_t> edges;
+};
+
+
+// The entries in one chunk of an mtx file.
+struct EntryChunk {
+  std::vector<uint64_t> rows;
+  std::vector<uint64_t> cols;
+};
+
+
+// Builds the csr arrays from the entries (row, col) of all chunks: The
+// entries are sorted by row with a counting sort; the columns of a row are
+// sorted as well, so that the result does not depend on how the entries are
+// distributed among the chunks. Clears the chunks.
+void build_csr(uint64_t num_vertices, std::vector<EntryChunk>* chunks,
+               uint64_t** offsets_out, uint64_t** edges_out) {
+  const uint64_t num_chunks = chunks->size();
+
+  // Degrees, counted concurrently.
+  uint64_t* offsets = alloc_array(num_vertices + 1);
+  memset(offsets, 0, (num_vertices + 1) * sizeof(uint64_t));
+  run_parallel(num_chunks, [&](uint64_t id) {
+    const std::vector<uint64_t>& rows = (*chunks)[id].rows;
+    for (uint64_t i = 0; i < rows.size(); i++) {
+      __sync_fetch_and_add(&offsets[rows[i] + 1], 1);
+    }
+  });
+  for (uint64_t i = 0; i < num_vertices; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  uint64_t* edges = alloc_array(offsets[num_vertices]);
+  uint64_t* next = alloc_array(num_vertices);
+  memcpy(next, offsets, num_vertices * sizeof(uint64_t));
+  run_parallel(num_chunks, [&](uint64_t id) {
+    const EntryChunk& chunk = (*chunks)[id];
+    for (uint64_t i = 0; i < chunk.rows.size(); i++) {
+      edges[__sync_fetch_and_add(&next[chunk.rows[i]], 1)] = chunk.cols[i];
+    }
+  });
+  free(next);
+  chunks->clear();
+
+  run_parallel(num_chunks, [&](uint64_t id) {
+    const uint64_t first = num_vertices * id / num_chunks;
+    const uint64_t last = num_vertices * (id + 1) / num_chunks;
+    for (uint64_t v = first; v < last; v++) {
+      std::sort(&edges[offsets[v]], &edges[offsets[v + 1]]);
+    }
+  });
+  *offsets_out = offsets;
+  *edges_out = edges;
+}
+
+
+//
+// Graph generators
+//
+
+// Generated graphs have at most 2^kMaxScale vertices and 2^kMaxEdgesScale
+// undirected edges.
+const uint64_t kMaxScale = 40;
+const uint64_t kMaxEdgesScale = 48;
+
+void invalid_generator_spec(const char* fn, const char* spec) {
+  fprintf(stderr, "%s: invalid generator spec %s\n", fn, spec);
+  exit(EXIT_FAILURE);
+}
+
+
+// SplitMix64 finalizer.
+inline uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9UL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebUL;
+  return x ^ (x >> 31);
+}
+
+
+// Random numbers that only depend on a seed and a counter, e.g., the index of
+// an edge, so that generated graphs do not depend on the number of threads.
+class CounterRandom {
+ public:
+  CounterRandom(uint64_t seed, uint64_t counter)
+      : state_(mix(seed ^ mix(counter))) {}
+
+  inline uint64_t next() {
+    state_ += 0x9e3779b97f4a7c15UL;
+    return mix(state_);
+  }
+
+  // Uniform in [0, 1).
+  inline double next_double() {
+    return static_cast<double>(next() >> 11) / static_cast<double>(1UL << 53);
+  }
+
+  // Uniform in [0, n).
+  inline uint64_t next_below(uint64_t n) {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(next()) * n) >> 64);
+  }
+
+ private:
+  uint64_t state_;
+};
+
+
+// A pseudorandom permutation of [0, n) that can be evaluated independently
+// for every element: A balanced Feistel network on the smallest even number
+// of bits covering n, with cycle walking for results that are >= n.
+class RandomPermutation {
+ public:
+  RandomPermutation(uint64_t n, uint64_t seed) : n_(n), half_bits_(1) {
+    while ((1UL << (2 * half_bits_)) < n) {
+      half_bits_++;
+    }
+    mask_ = (1UL << half_bits_) - 1;
+    for (uint64_t i = 0; i < kRounds; i++) {
+      keys_[i] = mix(seed + i + 1);
+    }
+  }
+
+  inline uint64_t operator()(uint64_t x) const {
+    do {
+      x = encrypt(x);
+    } while (x >= n_);
+    return x;
+  }
+
+ private:
+  static const uint64_t kRounds = 4;
+
+  inline uint64_t encrypt(uint64_t x) const {
+    uint64_t left = x >> half_bits_;
+    uint64_t right = x & mask_;
+    for (uint64_t i = 0; i < kRounds; i++) {
+      const uint64_t tmp = right;
+      right = left ^ (mix(right ^ keys_[i]) & mask_);
+      left = tmp;
+    }
+    return (left << half_bits_) | right;
+  }
+
+  uint64_t n_;
+  uint64_t half_bits_;
+  uint64_t mask_;
+  uint64_t keys_[kRounds];
+};
+
+
+// A generator spec of the form <name>:<key>=<value>,<key>=<value>,...
+class GeneratorSpec {
+ public:
+  explicit GeneratorSpec(const char* spec) : spec_(spec) {
+    const char* colon = strchr(spec, ':');
+    if (colon == NULL) {
+      name_ = spec;
+      return;
+    }
+    name_ = std::string(spec, colon - spec);
+    const char* pos = colon + 1;
+    while (*pos != '\0') {
+      const char* comma = strchr(pos, ',');
+      const std::string param = (comma == NULL) ?
+          std::string(pos) : std::string(pos, comma - pos);
+      const size_t equals = param.find('=');
+      if ((equals == std::string::npos) || (equals == 0)) {
+        invalid_generator_spec(__func__, spec_);
+      }
+      Param p;
+      p.key = param.substr(0, equals);
+      p.value = param.substr(equals + 1);
+      p.used = false;
+      params_.push_back(p);
+      pos = (comma == NULL) ? (pos + param.size()) : (comma + 1);
+    }
+  }
+
+  inline const std::string& name() const { return name_; }
+  inline const char* spec() const { return spec_; }
+
+  bool has(const char* key) const {
+    for (size_t i = 0; i < params_.size(); i++) {
+      if (params_[i].key == key) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint64_t get_uint(const char* key, uint64_t default_value) {
+    const char* value = find(key);
+    if (value == NULL) {
+      return default_value;
+    }
+    char* end;
+    const uint64_t result = strtoull(value, &end, 10);
+    if ((*value < '0') || (*value > '9') || (*end != '\0')) {
+      invalid_generator_spec(__func__, spec_);
+    }
+    return result;
+  }
+
+  double get_double(const char* key, double default_value) {
+    const char* value = find(key);
+    if (value == NULL) {
+      return default_value;
+    }
+    char* end;
+    const double result = strtod(value, &end);
+    if ((*value == '\0') || (*end != '\0')) {
+      invalid_generator_spec(__func__, spec_);
+    }
+    return result;
+  }
+
+  // Fails on parameters that have not been read by the generator.
+  void check_unused() const {
+    for (size_t i = 0; i < params_.size(); i++) {
+      if (!params_[i].used) {
+        fprintf(stderr, "%s: unknown parameter %s for generator %s\n",
+                __func__, params_[i].key.c_str(), name_.c_str());
+        exit(EXIT_FAILURE);
       }
-      // We use zero based indices and node ids.
-      results.push_back(num - 1);
     }
-    prev = next + 1;
   }
-  if (prev < source.size()) {
-    num = atol(source.substr(prev).c_str());
-    if (num == 0) {
-      invalid_graph_file(__func__);
+
+ private:
+  struct Param {
+    std::string key;
+    std::string value;
+    bool used;
+  };
+
+  const char* find(const char* key) {
+    const char* value = NULL;
+    for (size_t i = 0; i < params_.size(); i++) {
+      if (params_[i].key == key) {
+        params_[i].used = true;
+        value = params_[i].value.c_str();
+      }
     }
-    // Again, we use zero based indices and node ids.
-    results.push_back(num - 1);
+    return value;
   }
-  return results;
+
+  const char* spec_;
+  std::string name_;
+  std::vector<Param> params_;
+};
+
+
+// First item of chunk id when num_items are split into num_chunks chunks.
+inline uint64_t chunk_begin(uint64_t num_items, uint64_t id,
+                            uint64_t num_chunks) {
+  return static_cast<uint64_t>(
+      static_cast<unsigned __int128>(num_items) * id / num_chunks);
+}
+
+
+inline void add_undirected(EntryChunk* chunk, uint64_t from, uint64_t to) {
+  chunk->rows.push_back(from);
+  chunk->cols.push_back(to);
+  if (from != to) {
+    chunk->rows.push_back(to);
+    chunk->cols.push_back(from);
+  }
+}
+
+
+// Number of vertices given as scale=<log2(n)> or n=<n>.
+uint64_t generator_vertices(GeneratorSpec* spec) {
+  if (spec->has("scale")) {
+    const uint64_t scale = spec->get_uint("scale", 0);
+    if (scale > kMaxScale) {
+      invalid_generator_spec(__func__, spec->spec());
+    }
+    return 1UL << scale;
+  }
+  const uint64_t n = spec->get_uint("n", 0);
+  if ((n == 0) || (n > (1UL << kMaxScale))) {
+    invalid_generator_spec(__func__, spec->spec());
+  }
+  return n;
+}
+
+
+// Number of undirected edges given as edge factor ef per vertex.
+uint64_t generator_edges(GeneratorSpec* spec, uint64_t num_vertices) {
+  const uint64_t ef = spec->get_uint("ef", 16);
+  if (ef > ((1UL << kMaxEdgesScale) / num_vertices)) {
+    invalid_generator_spec(__func__, spec->spec());
+  }
+  return ef * num_vertices;
+}
+
+
+// R-MAT [Chakrabarti 2004] with the Graph500 parameters by default: Every
+// edge picks one of the four quadrants of the adjacency matrix with
+// probabilities a, b, c, and 1 - a - b - c, once per bit of the vertex ids.
+// Vertex ids are then scrambled with a pseudorandom permutation (permute=0
+// keeps them), so that the high degree vertices are spread over the graph.
+uint64_t generate_rmat(GeneratorSpec* spec, std::vector<EntryChunk>* chunks) {
+  if (!spec->has("scale")) {
+    invalid_generator_spec(__func__, spec->spec());
+  }
+  const uint64_t num_vertices = generator_vertices(spec);
+  const uint64_t num_edges = generator_edges(spec, num_vertices);
+  const double a = spec->get_double("a", 0.57);
+  const double b = spec->get_double("b", 0.19);
+  const double c = spec->get_double("c", 0.19);
+  const uint64_t seed = spec->get_uint("seed", 1);
+  const bool permute = spec->get_uint("permute", 1) != 0;
+  spec->check_unused();
+  if ((a < 0) || (b < 0) || (c < 0) || ((a + b + c) > 1)) {
+    invalid_generator_spec(__func__, spec->spec());
+  }
+  uint64_t scale = 0;
+  while ((1UL << scale) < num_vertices) {
+    scale++;
+  }
+
+  const RandomPermutation permutation(num_vertices, mix(~seed));
+  const uint64_t num_chunks = chunks->size();
+  run_parallel(num_chunks, [&](uint64_t id) {
+    EntryChunk& chunk = (*chunks)[id];
+    const uint64_t first = chunk_begin(num_edges, id, num_chunks);
+    const uint64_t last = chunk_begin(num_edges, id + 1, num_chunks);
+    chunk.rows.reserve(2 * (last - first));
+    chunk.cols.reserve(2 * (last - first));
+    for (uint64_t e = first; e < last; e++) {
+      CounterRandom random(seed, e);
+      uint64_t from = 0;
+      uint64_t to = 0;
+      for (uint64_t bit = 0; bit < scale; bit++) {
+        const double r = random.next_double();
+        from <<= 1;
+        to <<= 1;
+        if (r < a) {
+          // Upper left quadrant.
+        } else if (r < (a + b)) {
+          to |= 1;
+        } else if (r < (a + b + c)) {
+          from |= 1;
+        } else {
+          from |= 1;
+          to |= 1;
+        }
+      }
+      if (permute) {
+        from = permutation(from);
+        to = permutation(to);
+      }
+      add_undirected(&chunk, from, to);
+    }
+  });
+  return num_vertices;
+}
+
+
+// A 2D grid of x * y vertices, or a 3D grid of x * y * z vertices, where
+// every vertex is connected to its (up to 4 or 6) direct neighbors. Vertex
+// (i, j, k) has id (k * y + j) * x + i.
+uint64_t generate_grid(GeneratorSpec* spec, std::vector<EntryChunk>* chunks) {
+  const uint64_t x = spec->get_uint("x", 0);
+  const uint64_t y = spec->get_uint("y", 0);
+  const uint64_t z = spec->get_uint("z", 1);
+  spec->check_unused();
+  if ((x == 0) || (y == 0) || (z == 0) ||
+      (x > (1UL << kMaxScale)) || (y > ((1UL << kMaxScale) / x)) ||
+      (z > ((1UL << kMaxScale) / (x * y)))) {
+    invalid_generator_spec(__func__, spec->spec());
+  }
+  const uint64_t num_vertices = x * y * z;
+
+  const uint64_t num_chunks = chunks->size();
+  run_parallel(num_chunks, [&](uint64_t id) {
+    EntryChunk& chunk = (*chunks)[id];
+    const uint64_t first = chunk_begin(num_vertices, id, num_chunks);
+    const uint64_t last = chunk_begin(num_vertices, id + 1, num_chunks);
+    for (uint64_t v = first; v < last; v++) {
+      const uint64_t i = v % x;
+      const uint64_t j = (v / x) % y;
+      const uint64_t k = v / (x * y);
+      const uint64_t neighbors[6] = {
+          (k > 0) ? (v - x * y) : v,
+          (j > 0) ? (v - x) : v,
+          (i > 0) ? (v - 1) : v,
+          (i + 1 < x) ? (v + 1) : v,
+          (j + 1 < y) ? (v + x) : v,
+          (k + 1 < z) ? (v + x * y) : v,
+      };
+      for (uint64_t n = 0; n < 6; n++) {
+        if (neighbors[n] != v) {
+          chunk.rows.push_back(v);
+          chunk.cols.push_back(neighbors[n]);
+        }
+      }
+    }
+  });
+  return num_vertices;
+}
+
+
+// Erdos-Renyi G(n, m) with m = ef * n edges whose endpoints are picked
+// uniformly at random.
+uint64_t generate_uniform(GeneratorSpec* spec,
+                          std::vector<EntryChunk>* chunks) {
+  const uint64_t num_vertices = generator_vertices(spec);
+  const uint64_t num_edges = generator_edges(spec, num_vertices);
+  const uint64_t seed = spec->get_uint("seed", 1);
+  spec->check_unused();
+
+  const uint64_t num_chunks = chunks->size();
+  run_parallel(num_chunks, [&](uint64_t id) {
+    EntryChunk& chunk = (*chunks)[id];
+    const uint64_t first = chunk_begin(num_edges, id, num_chunks);
+    const uint64_t last = chunk_begin(num_edges, id + 1, num_chunks);
+    chunk.rows.reserve(2 * (last - first));
+    chunk.cols.reserve(2 * (last - first));
+    for (uint64_t e = first; e < last; e++) {
+      CounterRandom random(seed, e);
+      const uint64_t from = random.next_below(num_vertices);
+      const uint64_t to = random.next_below(num_vertices);
+      add_undirected(&chunk, from, to);
+    }
+  });
+  return num_vertices;
+}
+
+
+// A random degree-regular (multi)graph: The union of degree random perfect
+// matchings, i.e., the number of vertices has to be even. Matching m pairs
+// vertices p_m(2i) and p_m(2i + 1) for a pseudorandom permutation p_m.
+uint64_t generate_regular(GeneratorSpec* spec,
+                          std::vector<EntryChunk>* chunks) {
+  const uint64_t num_vertices = generator_vertices(spec);
+  const uint64_t degree = spec->get_uint("degree", 16);
+  const uint64_t seed = spec->get_uint("seed", 1);
+  spec->check_unused();
+  if (((num_vertices % 2) != 0) || (degree == 0) ||
+      (degree > ((1UL << kMaxEdgesScale) / num_vertices))) {
+    invalid_generator_spec(__func__, spec->spec());
+  }
+  const uint64_t pairs = num_vertices / 2;
+  const uint64_t num_edges = degree * pairs;
+
+  const uint64_t num_chunks = chunks->size();
+  run_parallel(num_chunks, [&](uint64_t id) {
+    EntryChunk& chunk = (*chunks)[id];
+    const uint64_t first = chunk_begin(num_edges, id, num_chunks);
+    const uint64_t last = chunk_begin(num_edges, id + 1, num_chunks);
+    chunk.rows.reserve(2 * (last - first));
+    chunk.cols.reserve(2 * (last - first));
+    uint64_t e = first;
+    while (e < last) {
+      const uint64_t matching = e / pairs;
+      const RandomPermutation permutation(num_vertices,
+                                          mix(seed ^ mix(matching)));
+      const uint64_t matching_last = std::min(last, (matching + 1) * pairs);
+      for (; e < matching_last; e++) {
+        const uint64_t i = e % pairs;
+        add_undirected(&chunk, permutation(2 * i), permutation(2 * i + 1));
+      }
+    }
+  });
+  return num_vertices;
 }
 
 }  // namespace
 
+Graph::Graph()
+    : num_vertices_(0),
+      offsets_(NULL),
+      edges_(NULL),
+      distances_(NULL),
+      parents_(NULL) {
+}
+
+void Graph::init_vertex_data() {
+  distances_ = alloc_array(num_vertices_);
+  parents_ = alloc_array(num_vertices_);
+  reset();
+}
+
+uint64_t Graph::random_root() const {
+  uint64_t root = scal::pseudorand() % num_vertices_;
+  if (num_edges() == 0) {
+    return root;
+  }
+  while (offsets_[root] == offsets_[root + 1]) {
+    root = scal::pseudorand() % num_vertices_;
+  }
+  return root;
+}
+
+void Graph::reset() {
+  for (uint64_t i = 0; i < num_vertices_; i++) {
+    distances_[i] = Vertex::no_distance;
+    parents_[i] = Vertex::no_parent;
+  }
+}
+
 // We assume a correctly formated mtx file o type:
 // matrix coordinate pattern general
+//
+// The file is split into chunks that are parsed in parallel; see build_csr()
+// for how the entries are put in place.
 Graph* Graph::from_mtx_file(const char* graph_file) {
-  Graph *g = new Graph();
-  FILE* infile;
-  char line_buffer[BUFSIZ];
-
-  infile = fopen(graph_file, "rt");
-  if (!infile) {
-    fprintf(stderr, "%s: unable to open file %s\n", __func__, graph_file);
-    exit(EXIT_FAILURE);
+  const char* fn = __func__;
+  TextFile file(fn, graph_file);
+  const char* pos = file.begin();
+  // syntax of first line:
+  // #rows #cols #entries
+  // for our case it should be #rows=#cols
+  const std::vector<uint64_t> header = parse_header(&pos, file.end());
+  if (header.size() < 1) {
+    invalid_mtx_file(__func__);
   }
+  const uint64_t num_vertices = header[0];
 
-  bool firstline = true;
-  while (fgets(line_buffer, sizeof(line_buffer), infile)) {
-    std::string line(line_buffer);
-    line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
-    if (is_comment(line)) {
-      continue;
-    }
-    if (firstline) {
-      // syntax of first line:
-      // #rows #cols #entries
-      // for our case it should be #rows=#cols
-      firstline = false;
-      std::vector<uint64_t> tokens = tokenize(line, " ");
-      if (tokens.size() < 1) {
-        invalid_mtx_file(__func__);
+  std::vector<const char*> bounds;
+  split_lines(pos, file.end(), parse_threads(), &bounds);
+  const uint64_t num_chunks = bounds.size() - 1;
+  std::vector<EntryChunk> chunks(num_chunks);
+  run_parallel(num_chunks, [&](uint64_t id) {
+    EntryChunk& chunk = chunks[id];
+    const char* p = bounds[id];
+    const char* end = bounds[id + 1];
+    uint64_t row;
+    uint64_t col;
+    while (p < end) {
+      if (*p == '%') {
+        p = skip_line(p, end);
+        continue;
       }
-      g->vertices_ = new Vertex*[tokens[0]];
-      g->num_vertices_ = tokens[0];
-      for (uint64_t i = 0; i < tokens[0]; i++) {
-        g->vertices_[i] = scal::get<Vertex>(4 * 128);
-        g->vertices_[i]->distance = Vertex::no_distance;
-        g->vertices_[i]->parent = Vertex::no_parent;
+      if (next_number(&p, end, &row)) {
+        // We use zero based indices and node ids.
+        if (!next_number(&p, end, &col) ||
+            (row == 0) || (row > num_vertices) ||
+            (col == 0) || (col > num_vertices)) {
+          invalid_mtx_file(fn);
+        }
+        chunk.rows.push_back(row - 1);
+        chunk.cols.push_back(col - 1);
       }
-      continue;
+      p = skip_line(p, end);
     }
-    std::vector<uint64_t> tokens = tokenize(line, " ");
-    assert((tokens[0] - 1) < g->num_vertices_);
-    Vertex *v = g->vertices_[tokens[0] - 1];
-    v->neighbors.push_back(tokens[1] - 1);
-  }
+  });
 
-  fclose(infile);
+  uint64_t* offsets;
+  uint64_t* edges;
+  build_csr(num_vertices, &chunks, &offsets, &edges);
+
+  Graph *g = new Graph();
+  g->num_vertices_ = num_vertices;
+  g->offsets_ = offsets;
+  g->edges_ = edges;
+  g->init_vertex_data();
   return g;
 }
 
+// Line i after the header holds the neighbors of vertex i. The file is split
+// into chunks that are parsed in parallel into separate buffers, which are
+// then copied to their place in the edge array in parallel.
 Graph* Graph::from_graph_file(const char* graph_file) {
+  const char* fn = __func__;
+  TextFile file(fn, graph_file);
+  const char* pos = file.begin();
+  // syntax of first line:
+  // #vertices #edges ...
+  const std::vector<uint64_t> header = parse_header(&pos, file.end());
+  if (header.size() < 1) {
+    invalid_graph_file(__func__);
+  }
+  const uint64_t num_vertices = header[0];
+
+  std::vector<const char*> bounds;
+  split_lines(pos, file.end(), parse_threads(), &bounds);
+  const uint64_t num_chunks = bounds.size() - 1;
+  std::vector<AdjacencyChunk> chunks(num_chunks);
+  run_parallel(num_chunks, [&](uint64_t id) {
+    AdjacencyChunk& chunk = chunks[id];
+    const char* p = bounds[id];
+    const char* end = bounds[id + 1];
+    uint64_t neighbor;
+    while (p < end) {
+      if (*p == '%') {
+        p = skip_line(p, end);
+        continue;
+      }
+      uint64_t degree = 0;
+      while (next_number(&p, end, &neighbor)) {
+        // We use zero based indices and node ids.
+        if ((neighbor == 0) || (neighbor > num_vertices)) {
+          invalid_graph_file(fn);
+        }
+        chunk.edges.push_back(neighbor - 1);
+        degree++;
+      }
+      chunk.degrees.push_back(degree);
+      p = skip_line(p, end);
+    }
+  });
+
+  // First vertex and first edge of every chunk.
+  std::vector<uint64_t> first_vertex(num_chunks + 1, 0);
+  std::vector<uint64_t> first_edge(num_chunks + 1, 0);
+  for (uint64_t i = 0; i < num_chunks; i++) {
+    first_vertex[i + 1] = first_vertex[i] + chunks[i].degrees.size();
+    first_edge[i + 1] = first_edge[i] + chunks[i].edges.size();
+  }
+  if (first_vertex[num_chunks] > num_vertices) {
+    invalid_graph_file(__func__);
+  }
+
+  uint64_t* offsets = alloc_array(num_vertices + 1);
+  uint64_t* edges = alloc_array(first_edge[num_chunks]);
+  run_parallel(num_chunks, [&](uint64_t id) {
+    const AdjacencyChunk& chunk = chunks[id];
+    uint64_t offset = first_edge[id];
+    for (uint64_t i = 0; i < chunk.degrees.size(); i++) {
+      offsets[first_vertex[id] + i] = offset;
+      offset += chunk.degrees[i];
+    }
+    if (!chunk.edges.empty()) {
+      memcpy(&edges[first_edge[id]], &chunk.edges[0],
+             chunk.edges.size() * sizeof(uint64_t));
+    }
+  });
+  // Vertices without a line have no neighbors.
+  for (uint64_t id = first_vertex[num_chunks]; id <= num_vertices; id++) {
+    offsets[id] = first_edge[num_chunks];
+  }
+
   Graph *g = new Graph();
-  FILE* infile;
-  char line_buffer[BUFSIZ];
+  g->num_vertices_ = num_vertices;
+  g->offsets_ = offsets;
+  g->edges_ = edges;
+  g->init_vertex_data();
+  return g;
+}
 
-  infile = fopen(graph_file, "rt");
-  if (!infile) {
-    fprintf(stderr, "%s: unable to open file %s\n", __func__, graph_file);
+Graph* Graph::from_csr_file(const char* csr_file) {
+  const int fd = open(csr_file, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "%s: unable to open file %s\n", __func__, csr_file);
     exit(EXIT_FAILURE);
   }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) ||
+      (static_cast<size_t>(st.st_size) < sizeof(CsrHeader))) {
+    invalid_csr_file(__func__, csr_file);
+  }
+  void* mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                   fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    perror("mmap");
+    exit(EXIT_FAILURE);
+  }
+  const CsrHeader* header = static_cast<const CsrHeader*>(mem);
+  if ((header->magic != kCsrMagic) || (header->version != kCsrVersion) ||
+      (static_cast<uint64_t>(st.st_size) != sizeof(CsrHeader) +
+           (header->num_vertices + 1 + header->num_edges) * sizeof(uint64_t))) {
+    invalid_csr_file(__func__, csr_file);
+  }
+  Graph* g = new Graph();
+  g->num_vertices_ = header->num_vertices;
+  g->offsets_ = reinterpret_cast<const uint64_t*>(header + 1);
+  g->edges_ = g->offsets_ + header->num_vertices + 1;
+  if (g->offsets_[g->num_vertices_] != header->num_edges) {
+    invalid_csr_file(__func__, csr_file);
+  }
+  g->init_vertex_data();
+  return g;
+}
 
-  bool firstline = true;
-  uint64_t id = 0;
-  while (fgets(line_buffer, sizeof(line_buffer), infile)) {
-    std::string line(line_buffer);
-    line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
-    if (is_comment(line)) {
-      continue;
-    }
-    if (firstline) {
-      // syntax of first line:
-      // #vertices #edges ...
-      firstline = false;
-      std::vector<uint64_t> tokens = tokenize(line, " ");
-      if (tokens.size() < 1) {
-        invalid_graph_file(__func__);
-      }
-      tokens[0]++;  // first line is not based on 1...
-      g->vertices_ = new Vertex*[tokens[0]];
-      g->num_vertices_ = tokens[0];
-      for (uint64_t i = 0; i < tokens[0]; i++) {
-        g->vertices_[i] = scal::get<Vertex>(4 * 128);
-        g->vertices_[i]->distance = Vertex::no_distance;
-        g->vertices_[i]->parent = Vertex::no_parent;
-      }
-      continue;
-    } 
-    //std::vector<uint64_t> tokens = tokenize(line, " ");
-    Vertex *v = g->vertices_[id];
-    v->neighbors = tokenize(line, " ");
-
-    /*
-    if (tokens.size() > 0) {
-      v->neighbors = static_cast<uint64_t*>(calloc(
-          tokens.size(), sizeof(uint64_t)));
-      v->len_neighbors = tokens.size();
-      for (uint64_t i = 0; i < tokens.size(); i++) {
-        v->neighbors[i] = tokens[i];
-      }
-    } else {
-      v->len_neighbors = 0;
-      v->neighbors = NULL;
+bool Graph::write_csr_file(const char* csr_file) const {
+  // Write to a temporary file first, so that other runs never map a partially
+  // written file.
+  const std::string tmp_file = std::string(csr_file) + ".tmp";
+  FILE* outfile = fopen(tmp_file.c_str(), "wb");
+  if (!outfile) {
+    return false;
+  }
+  CsrHeader header;
+  header.magic = kCsrMagic;
+  header.version = kCsrVersion;
+  header.num_vertices = num_vertices_;
+  header.num_edges = num_edges();
+  bool ok = (fwrite(&header, sizeof(header), 1, outfile) == 1) &&
+      (fwrite(offsets_, sizeof(uint64_t), num_vertices_ + 1, outfile) ==
+           num_vertices_ + 1) &&
+      (fwrite(edges_, sizeof(uint64_t), num_edges(), outfile) == num_edges());
+  ok = (fclose(outfile) == 0) && ok;
+  if (!ok || (rename(tmp_file.c_str(), csr_file) != 0)) {
+    unlink(tmp_file.c_str());
+    return false;
+  }
+  return true;
+}
+
+Graph* Graph::from_file(const char* graph_file) {
+  if (ends_with(graph_file, ".csr")) {
+    return from_csr_file(graph_file);
+  }
+  const std::string csr_file = std::string(graph_file) + ".csr";
+  if (FLAGS_graph_cache) {
+    struct stat text_st;
+    struct stat csr_st;
+    if ((stat(graph_file, &text_st) == 0) &&
+        (stat(csr_file.c_str(), &csr_st) == 0) &&
+        (csr_st.st_mtime >= text_st.st_mtime)) {
+      return from_csr_file(csr_file.c_str());
     }
-    */
-    id++;
   }
+  Graph* g = ends_with(graph_file, ".mtx") ?
+      from_mtx_file(graph_file) : from_graph_file(graph_file);
+  if (FLAGS_graph_cache && !g->write_csr_file(csr_file.c_str())) {
+    fprintf(stderr, "%s: warning: unable to write %s\n", __func__,
+            csr_file.c_str());
+  }
+  return g;
+}
+
+Graph* Graph::from_generator(const char* spec) {
+  GeneratorSpec gen(spec);
+  std::vector<EntryChunk> chunks(parse_threads());
+  uint64_t num_vertices;
+  if (gen.name() == "rmat") {
+    num_vertices = generate_rmat(&gen, &chunks);
+  } else if (gen.name() == "grid") {
+    num_vertices = generate_grid(&gen, &chunks);
+  } else if (gen.name() == "uniform") {
+    num_vertices = generate_uniform(&gen, &chunks);
+  } else if (gen.name() == "regular") {
+    num_vertices = generate_regular(&gen, &chunks);
+  } else {
+    fprintf(stderr, "%s: unknown generator %s\n", __func__,
+            gen.name().c_str());
+    exit(EXIT_FAILURE);
+  }
+  uint64_t* offsets;
+  uint64_t* edges;
+  build_csr(num_vertices, &chunks, &offsets, &edges);
 
-  fclose(infile);
+  Graph *g = new Graph();
+  g->num_vertices_ = num_vertices;
+  g->offsets_ = offsets;
+  g->edges_ = edges;
+  g->init_vertex_data();
   return g;
 }
+
+Graph* Graph::from_flags(const char* graph_file) {
+  if (!FLAGS_gen.empty()) {
+    return from_generator(FLAGS_gen.c_str());
+  }
+  return from_file(graph_file);
+}
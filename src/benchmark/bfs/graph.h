@@ -5,43 +5,122 @@
 #ifndef SCAL_BENCHMARK_BFS_GRAPH_H
 #define SCAL_BENCHMARK_BFS_GRAPH_H
 
+#include <gflags/gflags.h>
 #include <inttypes.h>
+#include <stddef.h>
 
 #include <limits>
-#include <vector>
 
-struct Vertex {
+DECLARE_string(gen);
+
+// A view on a single vertex of a Graph. The neighbors point into the edge
+// array of the graph, distance and parent into its distance and parent
+// arrays, i.e., a Vertex is cheap to copy and writes go to the graph.
+class Vertex {
+ public:
   static const uint64_t no_distance = std::numeric_limits<uint64_t>::max();
   static const uint64_t no_parent = std::numeric_limits<uint64_t>::max();
 
-  std::vector<uint64_t> neighbors;
-  /*
-  uint64_t *neighbors;
-  uint64_t len_neighbors;
-  */
-  uint64_t distance;
-  uint64_t parent;
+  class NeighborList {
+   public:
+    NeighborList(const uint64_t* begin, const uint64_t* end)
+        : begin_(begin), end_(end) {}
+
+    inline uint64_t size() const { return end_ - begin_; }
+    inline uint64_t operator[](uint64_t i) const { return begin_[i]; }
+    inline const uint64_t* begin() const { return begin_; }
+    inline const uint64_t* end() const { return end_; }
+
+   private:
+    const uint64_t* begin_;
+    const uint64_t* end_;
+  };
+
+  Vertex(const uint64_t* neighbors_begin, const uint64_t* neighbors_end,
+         uint64_t* distance_ptr, uint64_t* parent_ptr)
+      : neighbors(neighbors_begin, neighbors_end),
+        distance(*distance_ptr),
+        parent(*parent_ptr) {}
+
+  NeighborList neighbors;
+  uint64_t& distance;
+  uint64_t& parent;
 };
 
+// A directed graph in compressed sparse row layout: The neighbors of vertex v
+// are edges()[offsets()[v]] to edges()[offsets()[v + 1] - 1]. Distances and
+// parents live in separate arrays that are initialized to
+// Vertex::no_distance and Vertex::no_parent.
+//
+// Parsed graphs can be stored in a binary file (write_csr_file()) that
+// later runs map into memory instead of parsing the text again. Synthetic
+// graphs are generated in memory (from_generator()).
 class Graph {
  public:
   static Graph* from_graph_file(const char* graph_file);
   static Graph* from_mtx_file(const char* graph_file);
-  
-  inline uint64_t size() {
+  static Graph* from_csr_file(const char* csr_file);
+
+  // Picks the parser by the extension (.csr, .mtx, METIS graph otherwise).
+  // With --graph_cache a text file is parsed only once: The graph is stored
+  // in <graph_file>.csr, which is used as long as it is newer than the text
+  // file.
+  static Graph* from_file(const char* graph_file);
+
+  // Generates an undirected graph, i.e., every edge is stored in both
+  // directions. The spec is <name>:<key>=<value>,... with the generators
+  //   rmat:scale=<s>[,ef=16,a=0.57,b=0.19,c=0.19,permute=1,seed=1]
+  //   grid:x=<x>,y=<y>[,z=1]
+  //   uniform:{scale=<s>|n=<n>}[,ef=16,seed=1]
+  //   regular:{scale=<s>|n=<n>}[,degree=16,seed=1]
+  // where ef is the number of undirected edges per vertex. The graph only
+  // depends on the spec, not on the number of threads generating it.
+  static Graph* from_generator(const char* spec);
+
+  // The graph described by --gen if set, and from_file(graph_file) otherwise.
+  static Graph* from_flags(const char* graph_file);
+
+  // Returns false if the file cannot be written.
+  bool write_csr_file(const char* csr_file) const;
+
+  inline uint64_t size() const {
     return num_vertices_;
   }
 
-  inline Vertex& get(uint64_t index) {
-    return *vertices_[index];
+  inline uint64_t num_edges() const {
+    return offsets_[num_vertices_];
+  }
+
+  inline Vertex get(uint64_t index) {
+    return Vertex(&edges_[offsets_[index]], &edges_[offsets_[index + 1]],
+                  &distances_[index], &parents_[index]);
   }
 
+  inline const uint64_t* offsets() const { return offsets_; }
+  inline const uint64_t* edges() const { return edges_; }
+  inline uint64_t* distances() { return distances_; }
+  inline uint64_t* parents() { return parents_; }
+
+  // Returns a pseudorandom vertex with at least one edge (any vertex if the
+  // graph has no edges), i.e., like Graph500 never an isolated vertex as root.
+  uint64_t random_root() const;
+
+  // Sets all distances and parents to Vertex::no_distance and
+  // Vertex::no_parent.
+  void reset();
+
  private:
-  Graph() {}
+  Graph();
   Graph(const Graph &cpy) {}
 
+  void init_vertex_data();
+
   uint64_t num_vertices_;
-  Vertex **vertices_;
+  // Either allocated or mapped from a csr file.
+  const uint64_t* offsets_;
+  const uint64_t* edges_;
+  uint64_t* distances_;
+  uint64_t* parents_;
 };
 
 #endif  // SCAL_BENCHMARK_BFS_GRAPH_H
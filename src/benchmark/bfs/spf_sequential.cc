@@ -15,8 +15,8 @@
 #include "util/scal-time.h"
 
 DEFINE_string(prealloc_size, "1g", "tread local space that is initialized");
-DEFINE_int64(root, -1, "root for BFS; -1: pseudorandom");
-DEFINE_int64(end, -1, "end node; -1: pseudorandom");
+DEFINE_int64(root, -1, "root for BFS; -1: pseudorandom vertex with edges");
+DEFINE_int64(end, -1, "end node; -1: pseudorandom vertex with edges");
 DEFINE_bool(description, false, "print description");
 DEFINE_bool(backtrace, false, "print backtrace");
 
@@ -26,9 +26,9 @@ void analyze(uint64_t root_index, uint64_t end_index, Graph *g, SingleList<uint6
   uint64_t start_time = get_utime();
   uint64_t vertex_index;
   while (q->dequeue(&vertex_index)) {
-    Vertex& cur_vertex = g->get(vertex_index);  
+    Vertex cur_vertex = g->get(vertex_index);
     for (uint64_t i = 0; i < cur_vertex.neighbors.size(); i++) {
-      Vertex& neighbor = g->get(cur_vertex.neighbors[i]);
+      Vertex neighbor = g->get(cur_vertex.neighbors[i]);
       if (neighbor.distance == Vertex::no_distance) {
         neighbor.distance = cur_vertex.distance + 1;
         neighbor.parent = vertex_index;
@@ -48,9 +48,9 @@ void performance(uint64_t root_index, uint64_t end_index, Graph *g, SingleList<u
   uint64_t start_time = get_utime();
   uint64_t vertex_index;
   while (q->dequeue(&vertex_index)) {
-    Vertex& cur_vertex = g->get(vertex_index);  
+    Vertex cur_vertex = g->get(vertex_index);
     for (uint64_t i = 0; i < cur_vertex.neighbors.size(); i++) {
-      Vertex& neighbor = g->get(cur_vertex.neighbors[i]);
+      Vertex neighbor = g->get(cur_vertex.neighbors[i]);
       if (neighbor.distance == Vertex::no_distance) {
         neighbor.distance = cur_vertex.distance + 1;
         if (cur_vertex.neighbors[i] == end_index) {
@@ -68,15 +68,16 @@ AFTER_LOOP_PERFORMANCE:
 }  // namespace
 
 int main(int argc, char **argv) {
-  std::string usage("sfp-analyzer [options] graph_file");
+  std::string usage("sfp-analyzer [options] {graph_file | --gen=<spec>}");
   google::SetUsageMessage(usage);
   uint32_t cmd_index = google::ParseCommandLineFlags(&
       argc, const_cast<char***>(&argv), true);
-  if (cmd_index >= static_cast<uint32_t>(argc)) {
+  const char *graph_file = (cmd_index < static_cast<uint32_t>(argc)) ?
+      argv[cmd_index] : NULL;
+  if ((graph_file == NULL) && FLAGS_gen.empty()) {
     google::ShowUsageWithFlags(google::GetArgv0());
     exit(EXIT_FAILURE);
   }
-  const char *graph_file = argv[cmd_index];
 
   uint64_t tlsize = scal::human_size_to_pages(
       FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
@@ -84,24 +85,24 @@ int main(int argc, char **argv) {
   scal::ThreadContext::prepare(1);
 
   SingleList<uint64_t> *q = new SingleList<uint64_t>();
-  Graph *g = Graph::from_graph_file(graph_file);
+  Graph *g = Graph::from_flags(graph_file);
 
   uint64_t root_index;
   uint64_t end_index;
   if (FLAGS_root < 0) {
-    root_index = scal::rand_range(0, g->size());
+    root_index = g->random_root();
   } else {
     root_index = static_cast<uint64_t>(FLAGS_root);
   }
   if (FLAGS_end < 0) {
-    end_index = scal::rand_range(0, g->size());
+    end_index = g->random_root();
   } else {
     end_index = static_cast<uint64_t>(FLAGS_end);
   }
 
-  Vertex& cur_vertex = g->get(root_index);
-  cur_vertex.distance = 0;
-  cur_vertex.parent = Vertex::no_parent;
+  Vertex root_vertex = g->get(root_index);
+  root_vertex.distance = 0;
+  root_vertex.parent = Vertex::no_parent;
   q->enqueue(root_index);
 
   uint64_t execution_time;
@@ -117,14 +118,15 @@ int main(int argc, char **argv) {
   printf("%10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %5" PRIu64 " %10" PRIu64 "\n",
       g->size(), root_index, end_index, g->get(end_index).distance, execution_time);
   if (FLAGS_backtrace) {
-    Vertex& cur_vertex = g->get(end_index);
+    uint64_t cur_index = end_index;
     printf("%lu ", end_index);
     while (true) {
-      printf("-> %lu ", cur_vertex.parent);
-      if (cur_vertex.parent == root_index) {
+      const uint64_t parent = g->get(cur_index).parent;
+      printf("-> %lu ", parent);
+      if (parent == root_index) {
         break;
       }
-      cur_vertex = g->get(cur_vertex.parent);
+      cur_index = parent;
     }
     printf("\n");
   }
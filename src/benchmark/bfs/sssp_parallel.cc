@@ -0,0 +1,434 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Parallel single-source shortest paths (delta-stepping) with the worklist
+// taken from the glue layer, i.e., any pool that provides ds_new().
+//
+// Tentative distances are updated with CAS. Vertices whose distance has
+// been lowered are put into the bucket of their new distance, where bucket i
+// holds distances [i * delta, (i + 1) * delta). All threads drain the lowest
+// non-empty bucket before moving on to the next one. Items in a bucket are
+// handled in whatever order the pool hands them out, so relaxed pools
+// trade scalability for wasted work: vertices get expanded with distances
+// that later turn out to be too large. With -delta=0 there is only a single
+// bucket, i.e., the pool's order alone decides how much work is wasted.
+//
+// An item carries the distance it has been put with, so priority queues
+// order the worklist by distance, and items that have been superseded by a
+// shorter distance are dropped without expanding the vertex again.
+//
+// A sequential Dijkstra on the same graph provides the reference distances
+// and runtime.
+
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <string>
+
+#include "benchmark/bfs/graph.h"
+#include "benchmark/bfs/weighted_graph.h"
+#include "benchmark/common.h"
+#include "benchmark/perf_counters.h"
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "benchmark/thread_placement.h"
+#include "datastructures/pool.h"
+#include "datastructures/sequential_heap.h"
+#include "util/allocation.h"
+#include "util/barrier.h"
+#include "util/platform.h"
+#include "util/random.h"
+#include "util/scal-time.h"
+#include "util/threadlocals.h"
+
+DEFINE_string(prealloc_size, "1g", "tread local space that is initialized");
+DEFINE_uint64(threads, 1, "number of threads");
+DEFINE_int64(root, -1, "source vertex; -1: pseudorandom vertex with edges");
+DEFINE_uint64(delta, 32, "bucket width; 0: a single bucket");
+DEFINE_uint64(max_weight, 100, "edge weights are drawn from [1, max_weight]");
+DEFINE_uint64(weight_seed, 0, "seed for the edge weights");
+DEFINE_bool(dijkstra, true, "run a sequential Dijkstra for reference "
+                            "distances and speedup");
+DEFINE_bool(print_summary, true, "print execution summary");
+
+namespace {
+
+// Items are (distance << kVertexBits) | (vertex + 1), so that they are
+// never 0 and priority queues order them by distance. Distances that do not
+// fit are saturated.
+const uint64_t kVertexBits = 32;
+const uint64_t kVertexMask = (1UL << kVertexBits) - 1;
+const uint64_t kMaxItemDistance = (1UL << (64 - kVertexBits)) - 1;
+
+inline uint64_t EncodeItem(uint64_t vertex, uint64_t distance) {
+  if (distance > kMaxItemDistance) {
+    distance = kMaxItemDistance;
+  }
+  return (distance << kVertexBits) | (vertex + 1);
+}
+
+
+inline uint64_t ItemVertex(uint64_t item) {
+  return (item & kVertexMask) - 1;
+}
+
+
+inline uint64_t ItemDistance(uint64_t item) {
+  return item >> kVertexBits;
+}
+
+
+struct SsspStats {
+  SsspStats() : runtime(0), expanded(0), stale(0), relaxations(0),
+                updates(0) {}
+
+  uint64_t runtime;
+  // Vertices taken from the worklist and expanded.
+  uint64_t expanded;
+  // Items dropped because the vertex has been reached on a shorter path.
+  uint64_t stale;
+  // Edges looked at.
+  uint64_t relaxations;
+  // Relaxations that lowered a distance.
+  uint64_t updates;
+};
+
+
+struct HeapEntry {
+  HeapEntry() {}
+  HeapEntry(uint64_t d, uint64_t v) : distance(d), vertex(v) {}
+
+  bool operator<(const HeapEntry& other) const {
+    return distance < other.distance;
+  }
+
+  uint64_t distance;
+  uint64_t vertex;
+};
+
+
+void Dijkstra(const WeightedGraph& g, uint64_t root, uint64_t* distances,
+              SsspStats* stats) {
+  for (uint64_t i = 0; i < g.size(); i++) {
+    distances[i] = Vertex::no_distance;
+  }
+  const uint64_t start_time = get_utime();
+  scal::SequentialHeap<HeapEntry> heap;
+  distances[root] = 0;
+  heap.insert(HeapEntry(0, root));
+  HeapEntry cur;
+  while (heap.delete_min(&cur)) {
+    if (cur.distance > distances[cur.vertex]) {
+      stats->stale++;
+      continue;
+    }
+    stats->expanded++;
+    for (uint64_t e = g.edges_begin(cur.vertex);
+         e < g.edges_end(cur.vertex); e++) {
+      stats->relaxations++;
+      const uint64_t distance = cur.distance + g.weight(e);
+      if (distance < distances[g.target(e)]) {
+        distances[g.target(e)] = distance;
+        stats->updates++;
+        heap.insert(HeapEntry(distance, g.target(e)));
+      }
+    }
+  }
+  stats->runtime = get_utime() - start_time;
+}
+
+
+struct Bucket {
+  Pool<uint64_t>* pool;
+  // Items put into the bucket that have not been fully expanded yet.
+  std::atomic<uint64_t> pending;
+  uint8_t pad[scal::kCachePrefetch - sizeof(Pool<uint64_t>*) -
+              sizeof(std::atomic<uint64_t>)];
+};
+
+}  // namespace
+
+class SsspBench : public scal::Benchmark {
+ public:
+  SsspBench(uint64_t num_threads,
+            uint64_t thread_prealloc_size,
+            const WeightedGraph* graph,
+            uint64_t delta,
+            Bucket* buckets,
+            uint64_t num_buckets,
+            std::atomic<uint64_t>* distances)
+      : Benchmark(num_threads, thread_prealloc_size, NULL),
+        graph_(graph),
+        delta_(delta),
+        buckets_(buckets),
+        num_buckets_(num_buckets),
+        distances_(distances),
+        barrier_(num_threads),
+        phases_(0) {
+  }
+
+  inline const SsspStats& stats() { return stats_; }
+  inline uint64_t phases() { return phases_; }
+
+ protected:
+  void bench_func(void);
+
+ private:
+  inline uint64_t BucketIndex(uint64_t distance) {
+    return (delta_ == 0) ? 0 : (distance / delta_) % num_buckets_;
+  }
+
+  void Put(uint64_t vertex, uint64_t distance);
+  void Expand(uint64_t item, SsspStats* stats);
+  void Drain(uint64_t bucket, SsspStats* stats);
+
+  const WeightedGraph* graph_;
+  const uint64_t delta_;
+  Bucket* buckets_;
+  const uint64_t num_buckets_;
+  std::atomic<uint64_t>* distances_;
+  SpinningBarrier barrier_;
+  uint64_t phases_;
+  SsspStats stats_;
+};
+
+uint64_t g_num_threads;
+
+int main(int argc, const char **argv) {
+  std::string usage("sssp-parallel [options] {graph_file | --gen=<spec>}");
+  google::SetUsageMessage(usage);
+  uint32_t cmd_index = google::ParseCommandLineFlags(
+      &argc, const_cast<char***>(&argv), true);
+  const char* graph_file = (cmd_index < static_cast<uint32_t>(argc)) ?
+      argv[cmd_index] : NULL;
+  if ((graph_file == NULL) && FLAGS_gen.empty()) {
+    google::ShowUsageWithFlags(google::GetArgv0());
+    exit(EXIT_FAILURE);
+  }
+  if (FLAGS_threads == 0) {
+    fprintf(stderr, "%s: error: at least one thread is required\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+
+  size_t tlsize = scal::HumanSizeToPages(
+      FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
+
+  g_num_threads = FLAGS_threads;
+  scal::ThreadLocalAllocator::Get().Init(tlsize, true);
+  scal::ThreadContext::prepare(g_num_threads + 1);
+  scal::ThreadContext::assign_context();
+
+  Graph* g = Graph::from_flags(graph_file);
+  WeightedGraph* wg = WeightedGraph::from_graph(
+      g, FLAGS_max_weight, FLAGS_weight_seed);
+  if ((wg->size() == 0) || (wg->size() >= kVertexMask)) {
+    fprintf(stderr, "%s: error: unsupported number of vertices: %" PRIu64
+                    "\n", __func__, wg->size());
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t root;
+  if (FLAGS_root < 0) {
+    root = g->random_root();
+  } else {
+    root = static_cast<uint64_t>(FLAGS_root);
+  }
+  if (root >= wg->size()) {
+    fprintf(stderr, "%s: error: root %" PRIu64 " out of range\n",
+            __func__, root);
+    exit(EXIT_FAILURE);
+  }
+
+  // A vertex in bucket i has a distance below (i + 1) * delta and only puts
+  // distances below (i + 1) * delta + max_weight, i.e., into buckets
+  // [i, i + max_weight / delta + 1]. These max_weight / delta + 2 buckets are
+  // reused cyclically.
+  const uint64_t num_buckets =
+      (FLAGS_delta == 0) ? 1 : FLAGS_max_weight / FLAGS_delta + 2;
+  Bucket* buckets = static_cast<Bucket*>(scal::MallocAligned(
+      num_buckets * sizeof(Bucket), scal::kCachePrefetch));
+  for (uint64_t i = 0; i < num_buckets; i++) {
+    buckets[i].pool = static_cast<Pool<uint64_t>*>(ds_new());
+    buckets[i].pending.store(0);
+  }
+
+  std::atomic<uint64_t>* distances = new std::atomic<uint64_t>[wg->size()];
+  for (uint64_t i = 0; i < wg->size(); i++) {
+    distances[i].store(Vertex::no_distance, std::memory_order_relaxed);
+  }
+  distances[root].store(0);
+  buckets[0].pending.store(1);
+  if (!buckets[0].pool->put(EncodeItem(root, 0))) {
+    fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+    abort();
+  }
+
+  SsspBench* benchmark = new SsspBench(
+      g_num_threads, tlsize, wg, FLAGS_delta, buckets, num_buckets,
+      distances);
+  benchmark->run();
+  const SsspStats& stats = benchmark->stats();
+  const uint64_t exec_time = benchmark->execution_time();
+
+  uint64_t reached = 0;
+  for (uint64_t i = 0; i < wg->size(); i++) {
+    if (distances[i].load() != Vertex::no_distance) {
+      reached++;
+    }
+  }
+
+  SsspStats reference;
+  if (FLAGS_dijkstra) {
+    uint64_t* expected = static_cast<uint64_t*>(
+        malloc(wg->size() * sizeof(uint64_t)));
+    Dijkstra(*wg, root, expected, &reference);
+    for (uint64_t i = 0; i < wg->size(); i++) {
+      if (distances[i].load() != expected[i]) {
+        fprintf(stderr, "%s: error: vertex %" PRIu64 " has distance %" PRIu64
+                        " instead of %" PRIu64 "\n",
+                __func__, i, distances[i].load(), expected[i]);
+        exit(EXIT_FAILURE);
+      }
+    }
+    free(expected);
+  }
+
+  if (FLAGS_print_summary) {
+    printf("{\"threads\": %" PRIu64 " ,\"vertices\": %" PRIu64
+           " ,\"edges\": %" PRIu64 " ,\"root\": %" PRIu64
+           " ,\"delta\": %" PRIu64 " ,\"max_weight\": %" PRIu64
+           " ,\"runtime\": %" PRIu64 " ,\"reached\": %" PRIu64
+           " ,\"phases\": %" PRIu64 " ,\"expanded\": %" PRIu64
+           " ,\"stale\": %" PRIu64 " ,\"relaxations\": %" PRIu64
+           " ,\"updates\": %" PRIu64,
+           g_num_threads,
+           wg->size(),
+           wg->num_edges(),
+           root,
+           FLAGS_delta,
+           FLAGS_max_weight,
+           exec_time,
+           reached,
+           benchmark->phases(),
+           stats.expanded,
+           stats.stale,
+           stats.relaxations,
+           stats.updates);
+    if (FLAGS_dijkstra) {
+      printf(" ,\"dijkstra\": {\"runtime\": %" PRIu64
+             " ,\"relaxations\": %" PRIu64 " ,\"updates\": %" PRIu64 "}"
+             " ,\"speedup\": %.2f ,\"work_ratio\": %.2f",
+             reference.runtime,
+             reference.relaxations,
+             reference.updates,
+             (exec_time == 0) ? 0.0 :
+                 static_cast<double>(reference.runtime) / exec_time,
+             (reference.relaxations == 0) ? 0.0 :
+                 static_cast<double>(stats.relaxations) /
+                     reference.relaxations);
+    }
+    char *ds_stats = ds_get_stats();
+    if (ds_stats != NULL) {
+      printf(" %s", ds_stats);
+    }
+    if (benchmark->placement() != NULL) {
+      benchmark->placement()->PrintJson(stdout);
+    }
+    if (benchmark->perf_counters() != NULL) {
+      benchmark->perf_counters()->PrintJson(stdout, stats.relaxations);
+    }
+    printf("}\n");
+  }
+  return EXIT_SUCCESS;
+}
+
+
+void SsspBench::Put(uint64_t vertex, uint64_t distance) {
+  Bucket& bucket = buckets_[BucketIndex(distance)];
+  bucket.pending.fetch_add(1);
+  if (!bucket.pool->put(EncodeItem(vertex, distance))) {
+    fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+    abort();
+  }
+}
+
+
+void SsspBench::Expand(uint64_t item, SsspStats* stats) {
+  const uint64_t vertex = ItemVertex(item);
+  const uint64_t distance = distances_[vertex].load();
+  if ((ItemDistance(item) != kMaxItemDistance) &&
+      (ItemDistance(item) > distance)) {
+    stats->stale++;
+    return;
+  }
+  stats->expanded++;
+  for (uint64_t e = graph_->edges_begin(vertex);
+       e < graph_->edges_end(vertex); e++) {
+    stats->relaxations++;
+    const uint64_t target = graph_->target(e);
+    const uint64_t new_distance = distance + graph_->weight(e);
+    uint64_t old_distance = distances_[target].load();
+    while (new_distance < old_distance) {
+      if (distances_[target].compare_exchange_weak(
+              old_distance, new_distance)) {
+        stats->updates++;
+        Put(target, new_distance);
+        break;
+      }
+    }
+  }
+}
+
+
+void SsspBench::Drain(uint64_t bucket, SsspStats* stats) {
+  Bucket& b = buckets_[bucket];
+  uint64_t item;
+  while (true) {
+    if (b.pool->get(&item)) {
+      Expand(item, stats);
+      b.pending.fetch_sub(1);
+    } else if (b.pending.load() == 0) {
+      // Items are only put into the current bucket while expanding an item
+      // of it, i.e., before its pending count drops.
+      return;
+    }
+  }
+}
+
+
+void SsspBench::bench_func(void) {
+  SsspStats stats;
+  uint64_t bucket = BucketIndex(0);
+  uint64_t phases = 0;
+  while (true) {
+    Drain(bucket, &stats);
+    phases++;
+    barrier_.wait();
+    // All threads are done with the bucket, so every thread finds the same
+    // next bucket.
+    uint64_t next = num_buckets_;
+    for (uint64_t i = 1; i <= num_buckets_; i++) {
+      const uint64_t candidate = (bucket + i) % num_buckets_;
+      if (buckets_[candidate].pending.load() > 0) {
+        next = candidate;
+        break;
+      }
+    }
+    // Wait for all threads to pick the bucket before anyone puts again.
+    barrier_.wait();
+    if (next == num_buckets_) {
+      break;
+    }
+    bucket = next;
+  }
+  __sync_fetch_and_add(&stats_.expanded, stats.expanded);
+  __sync_fetch_and_add(&stats_.stale, stats.stale);
+  __sync_fetch_and_add(&stats_.relaxations, stats.relaxations);
+  __sync_fetch_and_add(&stats_.updates, stats.updates);
+  if (scal::ThreadContext::get().thread_id() == 1) {
+    phases_ = phases;
+  }
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include "benchmark/bfs/weighted_graph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+// SplitMix64 finalizer.
+inline uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9UL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebUL;
+  return x ^ (x >> 31);
+}
+
+
+inline uint64_t edge_weight(uint64_t from, uint64_t to,
+                            uint64_t max_weight, uint64_t seed) {
+  const uint64_t lo = (from < to) ? from : to;
+  const uint64_t hi = (from < to) ? to : from;
+  return mix(mix(lo ^ seed) ^ hi) % max_weight + 1;
+}
+
+}  // namespace
+
+WeightedGraph* WeightedGraph::from_graph(Graph* g, uint64_t max_weight,
+                                         uint64_t seed) {
+  if (max_weight == 0) {
+    fprintf(stderr, "%s: max_weight has to be positive\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+  WeightedGraph* wg = new WeightedGraph();
+  wg->num_vertices_ = g->size();
+  wg->offsets_ = g->offsets();
+  wg->targets_ = g->edges();
+  wg->weights_ = static_cast<uint64_t*>(
+      malloc((g->num_edges() + 1) * sizeof(uint64_t)));
+  if (wg->weights_ == NULL) {
+    fprintf(stderr, "%s: unable to allocate %" PRIu64 " weights\n",
+            __func__, g->num_edges());
+    exit(EXIT_FAILURE);
+  }
+  for (uint64_t i = 0; i < g->size(); i++) {
+    for (uint64_t e = wg->offsets_[i]; e < wg->offsets_[i + 1]; e++) {
+      wg->weights_[e] = edge_weight(i, wg->targets_[e], max_weight, seed);
+    }
+  }
+  return wg;
+}
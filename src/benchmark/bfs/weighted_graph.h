@@ -0,0 +1,58 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A directed graph with positive edge weights in compressed sparse row layout:
+// The edges of vertex v are [edges_begin(v), edges_end(v)).
+
+#ifndef SCAL_BENCHMARK_BFS_WEIGHTED_GRAPH_H
+#define SCAL_BENCHMARK_BFS_WEIGHTED_GRAPH_H
+
+#include <inttypes.h>
+
+#include "benchmark/bfs/graph.h"
+
+class WeightedGraph {
+ public:
+  // Takes the edges of g and assigns them pseudorandom weights in
+  // [1, max_weight]. The weight only depends on the two endpoints and the
+  // seed, i.e., both directions of an undirected edge get the same weight.
+  static WeightedGraph* from_graph(Graph* g, uint64_t max_weight,
+                                   uint64_t seed);
+
+  inline uint64_t size() const {
+    return num_vertices_;
+  }
+
+  inline uint64_t num_edges() const {
+    return offsets_[num_vertices_];
+  }
+
+  inline uint64_t edges_begin(uint64_t vertex) const {
+    return offsets_[vertex];
+  }
+
+  inline uint64_t edges_end(uint64_t vertex) const {
+    return offsets_[vertex + 1];
+  }
+
+  inline uint64_t target(uint64_t edge) const {
+    return targets_[edge];
+  }
+
+  inline uint64_t weight(uint64_t edge) const {
+    return weights_[edge];
+  }
+
+ private:
+  WeightedGraph() {}
+  WeightedGraph(const WeightedGraph &cpy) {}
+
+  uint64_t num_vertices_;
+  // Shared with the graph the weighted graph has been created from.
+  const uint64_t* offsets_;
+  const uint64_t* targets_;
+  uint64_t* weights_;
+};
+
+#endif  // SCAL_BENCHMARK_BFS_WEIGHTED_GRAPH_H
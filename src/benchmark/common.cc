@@ -8,6 +8,8 @@
 #include <pthread.h>
 #include <sched.h>
 
+#include "benchmark/perf_counters.h"
+#include "benchmark/thread_placement.h"
 #include "util/allocation.h"
 #include "util/malloc-compat.h"
 #include "util/platform.h"
@@ -16,6 +18,12 @@
 
 DEFINE_bool(set_rt_priority, true,
             "try to set the program to RT priority (needs root)");
+DEFINE_string(placement, "none",
+              "thread placement: none, compact, scatter, smt-first, "
+              "socket-fill, or list:<cpus> (e.g. list:0-3,8)");
+DEFINE_bool(perf_counters, false,
+            "count cpu events (perf_event_open) per thread during the "
+            "measured phase");
 
 namespace scal {
 
@@ -25,6 +33,8 @@ Benchmark::Benchmark(uint64_t num_threads,
   num_threads_ = num_threads;
   data_ = data;
   thread_prealloc_size_ = thread_prealloc_size;
+  placement_ = NULL;
+  perf_counters_ = NULL;
   if (pthread_barrier_init(&start_barrier_, NULL, num_threads_)) {
     fprintf(stderr, "%s: error: Unable to init start barrier.\n", __func__);
     abort();
@@ -48,6 +58,14 @@ void Benchmark::run(void) {
     pattr = NULL;
   }
 
+  if ((placement_ == NULL) && (FLAGS_placement != "none")) {
+    placement_ = new ThreadPlacement(num_threads_);
+    placement_->AssignAll(FLAGS_placement);
+  }
+  if (FLAGS_perf_counters) {
+    perf_counters_ = new PerfCounters(num_threads_);
+  }
+
   global_start_time_ = 0;
   for (uint64_t i = 0; i < num_threads_; i++) {
     s = pthread_create(&threads_[i],
@@ -113,35 +131,27 @@ bool Benchmark::can_modify_sched() {
 }
 
 void Benchmark::set_core_affinity() {
-  uint64_t thread_id = scal::ThreadContext::get().thread_id();
-  uint64_t cores = (uint64_t)scal::number_of_cores();
-  if (num_threads_ > cores) {
+  if (placement_ == NULL) {
     return;
   }
-  uint64_t id;
-  if (cores == num_threads_) {
-    id = thread_id - 1;
-  } else {
-    double mult = (static_cast<double>(cores)) / num_threads_;
-    id = (uint64_t)(thread_id * mult) - (uint64_t)mult;
-  }
-  cpu_set_t cpuset;
-  CPU_ZERO(&cpuset);
-  CPU_SET((uint64_t)id, &cpuset);
-  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
-    fprintf(stderr, "warning: could not set thread cpu affinity\n");
-  }
+  // Placement uses 0-based indices.
+  placement_->Pin(scal::ThreadContext::get().thread_id() - 1);
 }
 
 void Benchmark::startup_thread() {
-  scal::ThreadLocalAllocator::Get().Init(thread_prealloc_size_, true);
-  //set_core_affinity();
   uint64_t thread_id = scal::ThreadContext::get().thread_id();
   if (thread_id == 0) {
     fprintf(stderr, "%s: error: thread_id should be main thread. "
                     "Did you forged to init the main thread?\n", __func__);
     abort();
   }
+  // Pin before touching the thread-local memory so that it is allocated on
+  // the right node.
+  set_core_affinity();
+  scal::ThreadLocalAllocator::Get().Init(thread_prealloc_size_, true);
+  if (perf_counters_ != NULL) {
+    perf_counters_->Open(thread_id - 1);
+  }
   int rc = pthread_barrier_wait(&start_barrier_);
   if (rc != 0 && rc != PTHREAD_BARRIER_SERIAL_THREAD) {
     fprintf(stderr, "%s: pthread_barrier_wait failed.\n", __func__);
@@ -150,7 +160,14 @@ void Benchmark::startup_thread() {
   if (rc == PTHREAD_BARRIER_SERIAL_THREAD) {
     __sync_bool_compare_and_swap(&global_start_time_, 0, get_utime());
   }
+  if (perf_counters_ != NULL) {
+    perf_counters_->Enable(thread_id - 1);
+  }
   bench_func();
+  if (perf_counters_ != NULL) {
+    perf_counters_->Disable(thread_id - 1);
+  }
+  scal::ThreadLocalAllocator::Get().FlushRemoteFrees();
 }
 
 uint64_t Benchmark::thread_id(void) {
@@ -13,6 +13,9 @@
 
 namespace scal {
 
+class PerfCounters;
+class ThreadPlacement;
+
 class Benchmark {
  public:
   Benchmark(uint64_t num_threads,
@@ -24,6 +27,22 @@ class Benchmark {
     return global_end_time_ - global_start_time_;
   }
 
+  // Overrides the placement given by --placement. Must be set before run().
+  inline void set_placement(ThreadPlacement* placement) {
+    placement_ = placement;
+  }
+
+  // Returns the placement of the threads, or NULL if they are not pinned.
+  inline ThreadPlacement* placement() {
+    return placement_;
+  }
+
+  // Returns the counters collected around bench_func() with
+  // --perf_counters, or NULL.
+  inline PerfCounters* perf_counters() {
+    return perf_counters_;
+  }
+
  protected:
   virtual ~Benchmark() {}
 
@@ -52,6 +71,8 @@ class Benchmark {
   uint64_t num_threads_;
   uint64_t global_end_time_;
   uint64_t thread_prealloc_size_;
+  ThreadPlacement* placement_;
+  PerfCounters* perf_counters_;
 
   void startup_thread(void);
   void set_core_affinity();
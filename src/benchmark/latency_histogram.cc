@@ -0,0 +1,157 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include "benchmark/latency_histogram.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <new>
+
+#include "util/allocation.h"
+#include "util/scal-time.h"
+
+namespace {
+
+// Time spent for calibrating the TSC against the monotonic clock.
+const uint64_t kCalibrationNs = 20 * 1000 * 1000;
+
+inline uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+}  // namespace
+
+namespace scal {
+
+void LatencyHistogram::Reset() {
+  memset(counts_, 0, sizeof(counts_));
+  count_ = 0;
+  sum_ = 0;
+  min_ = ~0UL;
+  max_ = 0;
+}
+
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (uint64_t i = 0; i < kNumBuckets; i++) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  if (other.min_ < min_) {
+    min_ = other.min_;
+  }
+  if (other.max_ > max_) {
+    max_ = other.max_;
+  }
+}
+
+
+uint64_t LatencyHistogram::HighestEquivalentValue(uint64_t bucket) {
+  if (bucket < 2 * kSubBuckets) {
+    return bucket;
+  }
+  const uint64_t shift = bucket / kSubBuckets - 1;
+  const uint64_t sub = bucket - shift * kSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(q * count_ + 0.5);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (uint64_t i = 0; i < kNumBuckets; i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      // Never report more than what has actually been observed.
+      const uint64_t value = HighestEquivalentValue(i);
+      return (value > max_) ? max_ : value;
+    }
+  }
+  return max_;
+}
+
+
+LatencyRecorder::LatencyRecorder(uint64_t num_threads)
+    : num_threads_(num_threads) {
+  cycles_per_ns_ = CalibrateTsc();
+  // Thread ids are 1-based for workers, 0 is the main thread.
+  histograms_ = static_cast<ThreadHistograms*>(MallocAligned(
+      (num_threads_ + 1) * sizeof(ThreadHistograms), kCachePrefetch));
+  for (uint64_t i = 0; i <= num_threads_; i++) {
+    new(&histograms_[i]) ThreadHistograms();
+  }
+}
+
+
+double LatencyRecorder::CalibrateTsc() {
+  const uint64_t start_ns = MonotonicNs();
+  const uint64_t start_cycles = get_hwptime();
+  uint64_t now_ns;
+  do {
+    now_ns = MonotonicNs();
+  } while ((now_ns - start_ns) < kCalibrationNs);
+  const uint64_t cycles = get_hwptime() - start_cycles;
+  return static_cast<double>(cycles) / (now_ns - start_ns);
+}
+
+
+void LatencyRecorder::Merge() {
+  put_.Reset();
+  get_.Reset();
+  sojourn_.Reset();
+  wakeup_.Reset();
+  for (uint64_t i = 0; i <= num_threads_; i++) {
+    put_.Merge(histograms_[i].put);
+    get_.Merge(histograms_[i].get);
+    sojourn_.Merge(histograms_[i].sojourn);
+    wakeup_.Merge(histograms_[i].wakeup);
+  }
+}
+
+
+void LatencyRecorder::PrintHistogramJson(FILE* fp,
+                                         const char* name,
+                                         const LatencyHistogram& histogram) {
+  if (histogram.count() == 0) {
+    return;
+  }
+  const double mean =
+      static_cast<double>(histogram.sum()) / histogram.count();
+  fprintf(fp, " ,\"%s\": {\"count\": %" PRIu64 " ,\"mean\": %" PRIu64
+              " ,\"min\": %" PRIu64 " ,\"p50\": %" PRIu64 " ,\"p99\": %" PRIu64
+              " ,\"p999\": %" PRIu64 " ,\"max\": %" PRIu64 "}",
+          name,
+          histogram.count(),
+          static_cast<uint64_t>(mean / cycles_per_ns_),
+          static_cast<uint64_t>(histogram.min() / cycles_per_ns_),
+          static_cast<uint64_t>(histogram.Percentile(0.5) / cycles_per_ns_),
+          static_cast<uint64_t>(histogram.Percentile(0.99) / cycles_per_ns_),
+          static_cast<uint64_t>(histogram.Percentile(0.999) / cycles_per_ns_),
+          static_cast<uint64_t>(histogram.max() / cycles_per_ns_));
+}
+
+
+void LatencyRecorder::PrintJson(FILE* fp) {
+  fprintf(fp, " ,\"tsc_ghz\": %.3f", cycles_per_ns_);
+  PrintHistogramJson(fp, "put_latency_ns", put_);
+  PrintHistogramJson(fp, "get_latency_ns", get_);
+  PrintHistogramJson(fp, "sojourn_ns", sojourn_);
+  PrintHistogramJson(fp, "wakeup_ns", wakeup_);
+}
+
+}  // namespace scal
@@ -0,0 +1,135 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_LATENCY_HISTOGRAM_H_
+#define SCAL_BENCHMARK_LATENCY_HISTOGRAM_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "util/platform.h"
+
+namespace scal {
+
+// Log-linear (HDR-style) histogram over 64 bit values. Every power of two is
+// split into kSubBuckets linear buckets, bounding the relative error of a
+// reported value by 1/kSubBuckets.
+//
+// Not thread-safe: a histogram is meant to be owned by a single thread and
+// merged into others after that thread has finished.
+class LatencyHistogram {
+ public:
+  static const uint64_t kSubBucketBits = 5;
+  static const uint64_t kSubBuckets = 1UL << kSubBucketBits;
+  static const uint64_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram() { Reset(); }
+
+  void Reset();
+
+  _always_inline void Record(uint64_t value) {
+    counts_[BucketOf(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_) {
+      min_ = value;
+    }
+    if (value > max_) {
+      max_ = value;
+    }
+  }
+
+  void Merge(const LatencyHistogram& other);
+
+  // Returns the highest value equivalent to the bucket holding the q-quantile
+  // (0 <= q <= 1), or 0 for an empty histogram.
+  uint64_t Percentile(double q) const;
+
+  inline uint64_t count() const { return count_; }
+  inline uint64_t sum() const { return sum_; }
+  inline uint64_t min() const { return (count_ == 0) ? 0 : min_; }
+  inline uint64_t max() const { return max_; }
+
+  static _always_inline uint64_t BucketOf(uint64_t value) {
+    if (value < kSubBuckets) {
+      return value;
+    }
+    const uint64_t shift = (63 - __builtin_clzl(value)) - kSubBucketBits;
+    return shift * kSubBuckets + (value >> shift);
+  }
+
+  static uint64_t HighestEquivalentValue(uint64_t bucket);
+
+ private:
+  uint64_t counts_[kNumBuckets];
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+
+// Per-thread put/get latency, sojourn time (put to get of the same item), and
+// wake up latency (put to a parked consumer running again) histograms for the
+// benchmark harness. Latencies are recorded in TSC cycles (get_hwtime()) and
+// converted to nanoseconds using a calibration done at construction time.
+class LatencyRecorder {
+ public:
+  explicit LatencyRecorder(uint64_t num_threads);
+
+  _always_inline void RecordPut(uint64_t thread_id, uint64_t cycles) {
+    histograms_[thread_id].put.Record(cycles);
+  }
+
+  _always_inline void RecordGet(uint64_t thread_id, uint64_t cycles) {
+    histograms_[thread_id].get.Record(cycles);
+  }
+
+  _always_inline void RecordSojourn(uint64_t thread_id, uint64_t cycles) {
+    histograms_[thread_id].sojourn.Record(cycles);
+  }
+
+  _always_inline void RecordWakeup(uint64_t thread_id, uint64_t cycles) {
+    histograms_[thread_id].wakeup.Record(cycles);
+  }
+
+  // Merges the per-thread histograms. Must only be called after all worker
+  // threads have been joined.
+  void Merge();
+
+  // Prints the merged non-empty histograms (in ns) as JSON members (starting
+  // with " ,"), ready to be appended to a benchmark summary.
+  void PrintJson(FILE* fp);
+
+  inline double cycles_per_ns() { return cycles_per_ns_; }
+
+  // Measures the TSC frequency in cycles per ns.
+  static double CalibrateTsc();
+
+ private:
+  struct ThreadHistograms {
+    LatencyHistogram put;
+    LatencyHistogram get;
+    LatencyHistogram sojourn;
+    LatencyHistogram wakeup;
+    // Separates the histograms of neighbouring threads.
+    uint8_t pad[kCachePrefetch];
+  };
+
+  void PrintHistogramJson(FILE* fp,
+                          const char* name,
+                          const LatencyHistogram& histogram);
+
+  uint64_t num_threads_;
+  double cycles_per_ns_;
+  ThreadHistograms* histograms_;
+  LatencyHistogram put_;
+  LatencyHistogram get_;
+  LatencyHistogram sojourn_;
+  LatencyHistogram wakeup_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_LATENCY_HISTOGRAM_H_
@@ -2,14 +2,40 @@
 // Please see the AUTHORS file for details.  Use of this source code is governed
 // by a BSD license that can be found in the LICENSE file.
 
+// Allocator benchmark. Every thread allocates --operations objects per
+// strategy and object size and frees them again, either itself after they
+// have been live for a while (--pattern=local) or by handing them to a
+// consumer thread that frees them (--pattern=prodcon, like nodes of a queue
+// that are allocated by producers and reclaimed by consumers).
+//
+// Strategies:
+//   bump       thread-local allocator, objects are never freed
+//   recycling  thread-local allocator, objects are recycled through its size
+//              classes (remote frees are returned to their owner in batches)
+//   malloc     posix_memalign()/free() of the linked malloc (glibc)
+//   tcmalloc   tc_memalign()/tc_free() (mm-harness-tcmalloc only, where
+//              tcmalloc also replaces malloc)
+
 #include <gflags/gflags.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#ifdef SCAL_HAVE_TCMALLOC
+#include <gperftools/tcmalloc.h>
+#endif  // SCAL_HAVE_TCMALLOC
 
 #include "benchmark/common.h"
-#include "datastructures/ms_queue.h"
+#include "util/allocation.h"
+#include "util/platform.h"
 #include "util/threadlocals.h"
 #include "util/scal-time.h"
 #include "util/workloads.h"
@@ -19,14 +45,216 @@ DEFINE_uint64(threads, 1, "number of threads");
 DEFINE_uint64(operations, 1000, "number of operations per producer");
 DEFINE_uint64(c, 5000, "computational workload");
 DEFINE_bool(use_rdtsc_load, true, "use rdtsc wait for computational load");
+DEFINE_string(strategy, "recycling", "comma separated list of allocation "
+                                     "strategies: bump, recycling, malloc, "
+                                     "tcmalloc");
+DEFINE_string(sizes, "64,128,512", "comma separated list of object sizes");
+DEFINE_uint64(alignment, 64, "object alignment");
+DEFINE_string(pattern, "local", "local (threads free their own objects) or "
+                                "prodcon (even threads allocate, odd threads "
+                                "free)");
+DEFINE_uint64(live, 1024, "local: objects a thread keeps before freeing the "
+                          "oldest one; prodcon: capacity of the channel "
+                          "between a producer and its consumer");
+
+namespace {
+
+enum Strategy {
+  kBump = 0,
+  kRecycling,
+  kMalloc,
+  kTcmalloc,
+  kNumStrategies
+};
+
+const char* kStrategyNames[kNumStrategies] = {
+  "bump", "recycling", "malloc", "tcmalloc"
+};
+
+
+struct Run {
+  Strategy strategy;
+  uint64_t size;
+  uint64_t runtime;
+  // Resident set size at the end of the run and its growth during the run.
+  int64_t rss_bytes;
+  int64_t rss_growth_bytes;
+  // Blocks returned to the thread-local allocator during the run and the
+  // growth of the bytes it considers live, i.e., a recycling run that does
+  // not free anything or keeps growing shows up here.
+  uint64_t tla_frees;
+  int64_t tla_live_growth_bytes;
+};
+
+
+template<Strategy S>
+struct Allocator;
+
+template<>
+struct Allocator<kBump> {
+  static _always_inline void* Alloc(size_t size, size_t alignment) {
+    return scal::ThreadLocalAllocator::Get().MallocAligned(size, alignment);
+  }
+  static _always_inline void Free(void* object) {}
+};
+
+template<>
+struct Allocator<kRecycling> {
+  static _always_inline void* Alloc(size_t size, size_t alignment) {
+    return scal::ThreadLocalAllocator::Get().MallocAligned(size, alignment);
+  }
+  static _always_inline void Free(void* object) {
+    scal::ThreadLocalAllocator::Free(object);
+  }
+};
+
+template<>
+struct Allocator<kMalloc> {
+  static _always_inline void* Alloc(size_t size, size_t alignment) {
+    void* object;
+    if (posix_memalign(&object, alignment, size) != 0) {
+      return NULL;
+    }
+    return object;
+  }
+  static _always_inline void Free(void* object) {
+    free(object);
+  }
+};
+
+#ifdef SCAL_HAVE_TCMALLOC
+template<>
+struct Allocator<kTcmalloc> {
+  static _always_inline void* Alloc(size_t size, size_t alignment) {
+    return tc_memalign(alignment, size);
+  }
+  static _always_inline void Free(void* object) {
+    tc_free(object);
+  }
+};
+#endif  // SCAL_HAVE_TCMALLOC
+
+
+// Single-producer/single-consumer channel for --pattern=prodcon.
+class Channel {
+ public:
+  explicit Channel(uint64_t capacity)
+      : capacity_(capacity), head_(0), tail_(0) {
+    slots_ = static_cast<void**>(scal::MallocAligned(
+        capacity_ * sizeof(void*), scal::kCachePrefetch));
+  }
+
+  _always_inline void Put(void* object) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    while ((tail - head_.load(std::memory_order_acquire)) == capacity_) {
+      __asm__ __volatile__("pause");
+    }
+    slots_[tail % capacity_] = object;
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  _always_inline void* Get() {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    while (tail_.load(std::memory_order_acquire) == head) {
+      __asm__ __volatile__("pause");
+    }
+    void* object = slots_[head % capacity_];
+    head_.store(head + 1, std::memory_order_release);
+    return object;
+  }
+
+ private:
+  void** slots_;
+  uint64_t capacity_;
+  uint8_t pad1_[scal::kCachePrefetch - sizeof(void**) - sizeof(uint64_t)];
+  std::atomic<uint64_t> head_;
+  uint8_t pad2_[scal::kCachePrefetch - sizeof(uint64_t)];
+  std::atomic<uint64_t> tail_;
+  uint8_t pad3_[scal::kCachePrefetch - sizeof(uint64_t)];
+};
+
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    items.push_back(list.substr(start, end - start));
+    start = end + 1;
+  }
+  return items;
+}
+
+
+Strategy ParseStrategy(const std::string& name) {
+  for (int i = 0; i < kNumStrategies; i++) {
+    if (name == kStrategyNames[i]) {
+#ifndef SCAL_HAVE_TCMALLOC
+      if (i == kTcmalloc) {
+        fprintf(stderr, "error: tcmalloc is only available in "
+                        "mm-harness-tcmalloc\n");
+        exit(EXIT_FAILURE);
+      }
+#endif  // SCAL_HAVE_TCMALLOC
+      return static_cast<Strategy>(i);
+    }
+  }
+  fprintf(stderr, "error: unknown strategy '%s'\n", name.c_str());
+  exit(EXIT_FAILURE);
+}
+
+
+int64_t ResidentBytes() {
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == NULL) {
+    return -1;
+  }
+  uint64_t size;
+  uint64_t resident;
+  const int n = fscanf(fp, "%" SCNu64 " %" SCNu64, &size, &resident);
+  fclose(fp);
+  if (n != 2) {
+    return -1;
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+}  // namespace
 
 
 class MMBench : public scal::Benchmark {
  public:
-  MMBench(uint64_t num_threads, uint64_t thread_prealloc_size);
+  MMBench(uint64_t num_threads,
+          uint64_t thread_prealloc_size,
+          const std::vector<Run>& runs);
+
+  inline const std::vector<Run>& runs() { return runs_; }
 
  protected:
   void bench_func();
+
+ private:
+  // Returns true for the one thread that passed the barrier as serial thread.
+  bool Wait();
+
+  template<Strategy S>
+  void Local(uint64_t size);
+  template<Strategy S>
+  void Producer(Channel* channel, uint64_t size);
+  template<Strategy S>
+  void Consumer(Channel* channel);
+  template<Strategy S>
+  void Dispatch(uint64_t thread_idx, uint64_t size);
+
+  std::vector<Run> runs_;
+  std::vector<Channel*> channels_;
+  uint64_t run_start_time_;
+  int64_t run_start_rss_;
+  scal::ThreadLocalAllocator::Usage run_start_usage_;
+  pthread_barrier_t run_barrier_;
 };
 
 
@@ -39,6 +267,40 @@ int main(int argc, const char **argv) {
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, const_cast<char***>(&argv), true);
 
+  const bool prodcon = FLAGS_pattern == "prodcon";
+  if (!prodcon && (FLAGS_pattern != "local")) {
+    fprintf(stderr, "error: unknown pattern '%s'\n", FLAGS_pattern.c_str());
+    exit(EXIT_FAILURE);
+  }
+  if (prodcon && ((FLAGS_threads % 2) != 0)) {
+    fprintf(stderr, "error: --pattern=prodcon needs an even number of "
+                    "threads\n");
+    exit(EXIT_FAILURE);
+  }
+  if ((FLAGS_live == 0) || (FLAGS_alignment == 0) ||
+      ((FLAGS_alignment & (FLAGS_alignment - 1)) != 0) ||
+      (FLAGS_alignment < sizeof(void*))) {
+    fprintf(stderr, "error: --live has to be positive and --alignment a "
+                    "power of two of at least %zu\n", sizeof(void*));
+    exit(EXIT_FAILURE);
+  }
+  std::vector<Run> runs;
+  const std::vector<std::string> strategies = SplitList(FLAGS_strategy);
+  const std::vector<std::string> sizes = SplitList(FLAGS_sizes);
+  for (size_t i = 0; i < strategies.size(); i++) {
+    for (size_t j = 0; j < sizes.size(); j++) {
+      Run run;
+      memset(&run, 0, sizeof(run));
+      run.strategy = ParseStrategy(strategies[i]);
+      run.size = strtoul(sizes[j].c_str(), NULL, 10);
+      if (run.size < sizeof(void*)) {
+        fprintf(stderr, "error: invalid object size '%s'\n", sizes[j].c_str());
+        exit(EXIT_FAILURE);
+      }
+      runs.push_back(run);
+    }
+  }
+
   const size_t tlsize = scal::HumanSizeToPages(
       FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
   g_num_threads = FLAGS_threads;
@@ -52,31 +314,190 @@ int main(int argc, const char **argv) {
     computation = reinterpret_cast<LoadFunc>(scal::ComputePi);
   }
 
-  MMBench benchmark(g_num_threads, tlsize);
+  MMBench benchmark(g_num_threads, tlsize, runs);
   benchmark.run();
+  struct rusage usage_stats;
+  getrusage(RUSAGE_SELF, &usage_stats);
   printf("{ \"c\": %lu "
          ",\"operations\": %lu "
          ",\"threads\": %lu "
          ",\"time\": %lu "
-         "}\n",
-         FLAGS_c, FLAGS_operations, FLAGS_threads, benchmark.execution_time());
+         ",\"pattern\": \"%s\" "
+         ",\"alignment\": %lu "
+         ",\"live\": %lu "
+         ",\"max_rss_kb\": %ld",
+         FLAGS_c, FLAGS_operations, FLAGS_threads, benchmark.execution_time(),
+         FLAGS_pattern.c_str(), FLAGS_alignment, FLAGS_live,
+         usage_stats.ru_maxrss);
+  // Every object is allocated and freed once (freeing is skipped by bump).
+  const uint64_t num_allocations =
+      prodcon ? (FLAGS_threads / 2) * FLAGS_operations
+              : FLAGS_threads * FLAGS_operations;
+  printf(" ,\"results\": [");
+  for (size_t i = 0; i < benchmark.runs().size(); i++) {
+    const Run& run = benchmark.runs()[i];
+    printf("%s{\"strategy\": \"%s\" ,\"size\": %" PRIu64
+           " ,\"runtime\": %" PRIu64 " ,\"throughput\": %" PRIu64
+           " ,\"rss_bytes\": %" PRId64 " ,\"rss_growth_bytes\": %" PRId64
+           " ,\"tla_frees\": %" PRIu64 " ,\"tla_live_growth_bytes\": %" PRId64
+           "}",
+           (i == 0) ? "" : ", ",
+           kStrategyNames[run.strategy],
+           run.size,
+           run.runtime,
+           (uint64_t)(num_allocations /
+               (static_cast<double>(run.runtime) / 1000)),
+           run.rss_bytes,
+           run.rss_growth_bytes,
+           run.tla_frees,
+           run.tla_live_growth_bytes);
+  }
+  printf("]");
+  scal::ThreadLocalAllocator::PrintMemoryJson(stdout);
+  scal::ThreadLocalAllocator::PrintArenaJson(stdout);
+  printf("}\n");
   return EXIT_SUCCESS;
 }
 
 
 MMBench::MMBench(
-    uint64_t num_threads, uint64_t thread_prealloc_size)
-        : Benchmark(num_threads, thread_prealloc_size, NULL) {
+    uint64_t num_threads,
+    uint64_t thread_prealloc_size,
+    const std::vector<Run>& runs)
+        : Benchmark(num_threads, thread_prealloc_size, NULL),
+          runs_(runs),
+          run_start_time_(0),
+          run_start_rss_(0) {
+  memset(&run_start_usage_, 0, sizeof(run_start_usage_));
+  if (pthread_barrier_init(&run_barrier_, NULL, num_threads)) {
+    fprintf(stderr, "%s: error: Unable to init run barrier.\n", __func__);
+    abort();
+  }
+  if (FLAGS_pattern == "prodcon") {
+    for (uint64_t i = 0; i < num_threads / 2; i++) {
+      channels_.push_back(new Channel(FLAGS_live));
+    }
+  }
 }
 
 
-void MMBench::bench_func() {
-  scal::detail::Node<uint64_t>* node;
-  for(uint64_t i = 0; i < FLAGS_operations; i++) {
-    node = new scal::detail::Node<uint64_t>(i);
-    if (node == NULL) {
-      fprintf(stderr, "node alllocation failed\n"); 
+bool MMBench::Wait() {
+  int rc = pthread_barrier_wait(&run_barrier_);
+  if (rc != 0 && rc != PTHREAD_BARRIER_SERIAL_THREAD) {
+    fprintf(stderr, "%s: pthread_barrier_wait failed.\n", __func__);
+    abort();
+  }
+  return rc == PTHREAD_BARRIER_SERIAL_THREAD;
+}
+
+
+template<Strategy S>
+void MMBench::Local(uint64_t size) {
+  // Objects are freed in allocation order once --live of them exist.
+  std::vector<void*> window(FLAGS_live, NULL);
+  for (uint64_t i = 0; i < FLAGS_operations; i++) {
+    void*& slot = window[i % FLAGS_live];
+    Allocator<S>::Free(slot);
+    slot = Allocator<S>::Alloc(size, FLAGS_alignment);
+    if (slot == NULL) {
+      fprintf(stderr, "%s: allocation failed\n", __func__);
+      abort();
     }
+    *static_cast<uint64_t*>(slot) = i;
     computation(FLAGS_c);
   }
+  for (uint64_t i = 0; i < FLAGS_live; i++) {
+    Allocator<S>::Free(window[i]);
+  }
+}
+
+
+template<Strategy S>
+void MMBench::Producer(Channel* channel, uint64_t size) {
+  for (uint64_t i = 0; i < FLAGS_operations; i++) {
+    void* object = Allocator<S>::Alloc(size, FLAGS_alignment);
+    if (object == NULL) {
+      fprintf(stderr, "%s: allocation failed\n", __func__);
+      abort();
+    }
+    *static_cast<uint64_t*>(object) = i;
+    channel->Put(object);
+    computation(FLAGS_c);
+  }
+}
+
+
+template<Strategy S>
+void MMBench::Consumer(Channel* channel) {
+  for (uint64_t i = 0; i < FLAGS_operations; i++) {
+    void* object = channel->Get();
+    if (*static_cast<uint64_t*>(object) != i) {
+      fprintf(stderr, "%s: corrupted object\n", __func__);
+      abort();
+    }
+    Allocator<S>::Free(object);
+    computation(FLAGS_c);
+  }
+}
+
+
+template<Strategy S>
+void MMBench::Dispatch(uint64_t thread_idx, uint64_t size) {
+  if (channels_.empty()) {
+    Local<S>(size);
+  } else if ((thread_idx % 2) == 0) {
+    Producer<S>(channels_[thread_idx / 2], size);
+  } else {
+    Consumer<S>(channels_[thread_idx / 2]);
+  }
+}
+
+
+void MMBench::bench_func() {
+  // We need 0-based idx.
+  const uint64_t thread_idx = scal::ThreadContext::get().thread_id() - 1;
+  for (size_t i = 0; i < runs_.size(); i++) {
+    Run& run = runs_[i];
+    if (Wait()) {
+      run_start_rss_ = ResidentBytes();
+      run_start_usage_ = scal::ThreadLocalAllocator::TotalUsage();
+      run_start_time_ = get_utime();
+    }
+    Wait();
+    switch (run.strategy) {
+      case kBump:
+        Dispatch<kBump>(thread_idx, run.size);
+        break;
+      case kRecycling:
+        Dispatch<kRecycling>(thread_idx, run.size);
+        break;
+      case kMalloc:
+        Dispatch<kMalloc>(thread_idx, run.size);
+        break;
+#ifdef SCAL_HAVE_TCMALLOC
+      case kTcmalloc:
+        Dispatch<kTcmalloc>(thread_idx, run.size);
+        break;
+#endif  // SCAL_HAVE_TCMALLOC
+      default:
+        abort();
+    }
+    // Blocks freed by other threads only count as freed once their owner
+    // picked them up.
+    scal::ThreadLocalAllocator& tla = scal::ThreadLocalAllocator::Get();
+    tla.FlushRemoteFrees();
+    if (Wait()) {
+      run.runtime = get_utime() - run_start_time_;
+      run.rss_bytes = ResidentBytes();
+      run.rss_growth_bytes = run.rss_bytes - run_start_rss_;
+    }
+    tla.DrainRemoteFrees();
+    if (Wait()) {
+      const scal::ThreadLocalAllocator::Usage usage =
+          scal::ThreadLocalAllocator::TotalUsage();
+      run.tla_frees = usage.frees - run_start_usage_.frees;
+      run.tla_live_growth_bytes =
+          usage.live_bytes - run_start_usage_.live_bytes;
+    }
+  }
 }
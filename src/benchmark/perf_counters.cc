@@ -0,0 +1,224 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include "benchmark/perf_counters.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <new>
+
+#include "util/allocation.h"
+
+namespace {
+
+struct EventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+// Indexed by scal::PerfCounters::Event.
+const EventConfig kEventConfigs[] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+
+int PerfEventOpen(const EventConfig& event, int group_fd, bool user_only) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = (group_fd == -1) ? 1 : 0;
+  attr.exclude_kernel = user_only ? 1 : 0;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP |
+                     PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // Count the calling thread on any cpu.
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+}  // namespace
+
+namespace scal {
+
+const char* const PerfCounters::kEventNames[kNumEvents] = {
+  "cycles",
+  "instructions",
+  "llc_misses",
+  "l1d_misses",
+  "branch_misses",
+  "context_switches",
+};
+
+
+PerfCounters::PerfCounters(uint64_t num_threads)
+    : num_threads_(num_threads),
+      open_errno_(0) {
+  counters_ = static_cast<ThreadCounters*>(MallocAligned(
+      num_threads_ * sizeof(ThreadCounters), kCachePrefetch));
+  for (uint64_t i = 0; i < num_threads_; i++) {
+    new(&counters_[i]) ThreadCounters();
+    counters_[i].leader = -1;
+    for (int j = 0; j < kNumEvents; j++) {
+      counters_[i].fds[j] = -1;
+    }
+  }
+}
+
+
+void PerfCounters::Open(uint64_t thread_idx) {
+  ThreadCounters& counters = counters_[thread_idx];
+  for (int i = 0; i < kNumEvents; i++) {
+    // Prefer counting user space only, which is permitted more often.
+    // Context switches happen in the kernel and are thus never seen in user
+    // space only.
+    const bool user_only = i != kContextSwitches;
+    int fd = PerfEventOpen(kEventConfigs[i], counters.leader, user_only);
+    if ((fd < 0) && !user_only) {
+      fd = PerfEventOpen(kEventConfigs[i], counters.leader, true);
+    }
+    if (fd < 0) {
+      __sync_bool_compare_and_swap(&open_errno_, 0, errno);
+      continue;
+    }
+    counters.fds[i] = fd;
+    if (counters.leader == -1) {
+      counters.leader = fd;
+    }
+  }
+}
+
+
+void PerfCounters::Enable(uint64_t thread_idx) {
+  const int leader = counters_[thread_idx].leader;
+  if (leader == -1) {
+    return;
+  }
+  ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+
+void PerfCounters::Disable(uint64_t thread_idx) {
+  ThreadCounters& counters = counters_[thread_idx];
+  if (counters.leader == -1) {
+    return;
+  }
+  ioctl(counters.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  // Layout for PERF_FORMAT_GROUP: number of events, time enabled, time
+  // running, and the values in the order the events were added to the group.
+  uint64_t data[3 + kNumEvents];
+  if (read(counters.leader, data, sizeof(data)) < 0) {
+    fprintf(stderr, "warning: unable to read perf counters: %s\n",
+            strerror(errno));
+    return;
+  }
+  const uint64_t enabled = data[1];
+  const uint64_t running = data[2];
+  uint64_t next = 3;
+  for (int i = 0; i < kNumEvents; i++) {
+    if (counters.fds[i] == -1) {
+      continue;
+    }
+    double value = static_cast<double>(data[next++]);
+    if ((running > 0) && (running < enabled)) {
+      value = value * enabled / running;
+    }
+    counters.values[i] = static_cast<uint64_t>(value);
+  }
+  for (int i = 0; i < kNumEvents; i++) {
+    if (counters.fds[i] != -1) {
+      close(counters.fds[i]);
+    }
+  }
+}
+
+
+bool PerfCounters::Available(Event event) {
+  for (uint64_t i = 0; i < num_threads_; i++) {
+    if (counters_[i].fds[event] == -1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+void PerfCounters::PrintJson(FILE* fp, uint64_t num_operations) {
+  bool any = false;
+  for (int i = 0; i < kNumEvents; i++) {
+    any |= Available(static_cast<Event>(i));
+  }
+  if (!any) {
+    fprintf(fp, " ,\"perf\": {\"available\": false ,\"error\": \"%s\"}",
+            strerror(open_errno_));
+    return;
+  }
+
+  uint64_t totals[kNumEvents] = {0};
+  for (uint64_t i = 0; i < num_threads_; i++) {
+    for (int j = 0; j < kNumEvents; j++) {
+      totals[j] += counters_[i].values[j];
+    }
+  }
+  fprintf(fp, " ,\"perf\": {\"available\": true ,\"unavailable\": [");
+  bool first = true;
+  for (int i = 0; i < kNumEvents; i++) {
+    if (!Available(static_cast<Event>(i))) {
+      fprintf(fp, "%s\"%s\"", first ? "" : ", ", kEventNames[i]);
+      first = false;
+    }
+  }
+  fprintf(fp, "] ,\"total\": {");
+  first = true;
+  for (int i = 0; i < kNumEvents; i++) {
+    if (Available(static_cast<Event>(i))) {
+      fprintf(fp, "%s\"%s\": %" PRIu64, first ? "" : " ,", kEventNames[i],
+              totals[i]);
+      first = false;
+    }
+  }
+  fprintf(fp, "}");
+  if (num_operations > 0) {
+    fprintf(fp, " ,\"per_op\": {");
+    first = true;
+    for (int i = 0; i < kNumEvents; i++) {
+      if (Available(static_cast<Event>(i))) {
+        fprintf(fp, "%s\"%s\": %.3f", first ? "" : " ,", kEventNames[i],
+                static_cast<double>(totals[i]) / num_operations);
+        first = false;
+      }
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, " ,\"threads\": [");
+  for (uint64_t i = 0; i < num_threads_; i++) {
+    fprintf(fp, "%s{\"thread\": %" PRIu64, (i == 0) ? "" : ", ", i);
+    for (int j = 0; j < kNumEvents; j++) {
+      if (Available(static_cast<Event>(j))) {
+        fprintf(fp, " ,\"%s\": %" PRIu64, kEventNames[j],
+                counters_[i].values[j]);
+      }
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "]}");
+}
+
+}  // namespace scal
@@ -0,0 +1,67 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_PERF_COUNTERS_H_
+#define SCAL_BENCHMARK_PERF_COUNTERS_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "util/platform.h"
+
+namespace scal {
+
+// Per-thread hardware and software event counters (perf_event_open), counted
+// in one event group per thread.
+//
+// Events that cannot be opened (missing permissions, no PMU in a VM, ...) are
+// reported as unavailable instead of failing the benchmark.
+class PerfCounters {
+ public:
+  enum Event {
+    kCycles = 0,
+    kInstructions,
+    kLlcMisses,
+    kL1dMisses,
+    kBranchMisses,
+    kContextSwitches,
+    kNumEvents
+  };
+
+  explicit PerfCounters(uint64_t num_threads);
+
+  // The following are called by the worker thread with the given (0-based)
+  // index.
+  void Open(uint64_t thread_idx);
+  void Enable(uint64_t thread_idx);
+  // Stops counting and reads the counter values.
+  void Disable(uint64_t thread_idx);
+
+  // Prints per-thread and aggregate values as JSON member (starting with
+  // " ,"). If num_operations is not 0, aggregate values per operation are
+  // added.
+  void PrintJson(FILE* fp, uint64_t num_operations);
+
+ private:
+  struct ThreadCounters {
+    int fds[kNumEvents];
+    int leader;
+    // Values scaled by time_enabled/time_running in case of multiplexing.
+    uint64_t values[kNumEvents];
+    uint8_t pad[kCachePrefetch];
+  };
+
+  static const char* const kEventNames[kNumEvents];
+
+  bool Available(Event event);
+
+  uint64_t num_threads_;
+  ThreadCounters* counters_;
+  // First error encountered when opening an event, 0 if none.
+  int open_errno_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_PERF_COUNTERS_H_
@@ -0,0 +1,358 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Producer/consumer benchmark for priority queues. Producers insert items with
+// random priorities (the items themselves), consumers remove them. Besides the
+// throughput, the rank error of every delete_min is reported, i.e., the number
+// of items with a smaller priority that were in the priority queue when the
+// item was removed (0 for a strict priority queue).
+//
+// Rank errors are computed after the run by replaying all operations in the
+// order of their response timestamps. A delete that is replayed before the
+// insert of its item (the operations overlapped) takes the item right away and
+// the insert is skipped later. Concurrent operations (and threads preempted
+// between an operation and taking its timestamp) may thus overestimate the
+// rank error.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include <gflags/gflags.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchmark/common.h"
+#include "benchmark/latency_histogram.h"
+#include "benchmark/perf_counters.h"
+#include "benchmark/thread_placement.h"
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/pool.h"
+#include "util/allocation.h"
+#include "util/random.h"
+#include "util/threadlocals.h"
+#include "util/scal-time.h"
+#include "util/workloads.h"
+
+DEFINE_string(prealloc_size, "1g", "tread local space that is initialized");
+DEFINE_uint64(producers, 1, "number of producers");
+DEFINE_uint64(consumers, 1, "number of consumers");
+DEFINE_uint64(operations, 1000, "number of inserts per producer");
+DEFINE_uint64(prefill, 0, "number of items inserted before the run");
+DEFINE_uint64(key_range, 1 << 20, "priorities are drawn uniformly from "
+                                  "[1, key_range]");
+DEFINE_uint64(c, 5000, "computational workload");
+DEFINE_bool(rank_error, true, "record all operations and report the rank "
+                              "error of the deletes");
+DEFINE_bool(print_summary, true, "print execution summary");
+
+namespace {
+
+// Deletes are marked in the top bit of the item.
+const uint64_t kDeleteBit = 1UL << 63;
+
+struct Event {
+  uint64_t time;
+  uint64_t item;
+};
+
+
+struct EventLog {
+  Event* events;
+  uint64_t size;
+  uint8_t pad[scal::kCachePrefetch - sizeof(Event*) - sizeof(uint64_t)];
+};
+
+
+// Counts of items per priority, indexed by rank among the distinct
+// priorities (a Fenwick tree).
+class RankCounter {
+ public:
+  explicit RankCounter(uint64_t size) : counts_(size + 1, 0) {}
+
+  void Add(uint64_t index, int64_t delta) {
+    for (uint64_t i = index + 1; i < counts_.size(); i += i & (~i + 1)) {
+      counts_[i] += delta;
+    }
+  }
+
+  // Number of items with an index smaller than index.
+  int64_t CountBelow(uint64_t index) const {
+    int64_t sum = 0;
+    for (uint64_t i = index; i > 0; i -= i & (~i + 1)) {
+      sum += counts_[i];
+    }
+    return sum;
+  }
+
+ private:
+  std::vector<int64_t> counts_;
+};
+
+
+inline bool EventBefore(const Event& a, const Event& b) {
+  return a.time < b.time;
+}
+
+}  // namespace
+
+class ProdConPqBench : public scal::Benchmark {
+ public:
+  ProdConPqBench(uint64_t num_threads,
+                 uint64_t thread_prealloc_size,
+                 void *data,
+                 EventLog* logs)
+      : Benchmark(num_threads, thread_prealloc_size, data),
+        logs_(logs),
+        empty_gets_(0) {
+  }
+
+  inline uint64_t empty_gets() { return empty_gets_; }
+
+ protected:
+  void bench_func(void);
+
+ private:
+  void producer(void);
+  void consumer(void);
+
+  _always_inline void Record(uint64_t thread_id, uint64_t time,
+                             uint64_t item) {
+    if (logs_ != NULL) {
+      EventLog& log = logs_[thread_id];
+      log.events[log.size].time = time;
+      log.events[log.size].item = item;
+      log.size++;
+    }
+  }
+
+  EventLog* logs_;
+  uint64_t empty_gets_;
+};
+
+uint64_t g_num_threads;
+
+void PrintRankErrors(EventLog* logs, uint64_t num_logs);
+
+int main(int argc, const char **argv) {
+  std::string usage("Producer/consumer benchmark for priority queues.");
+  google::SetUsageMessage(usage);
+  google::ParseCommandLineFlags(&argc, const_cast<char***>(&argv), true);
+
+  if ((FLAGS_producers == 0) || (FLAGS_consumers == 0)) {
+    fprintf(stderr, "%s: error: at least one producer and one consumer are "
+                    "required\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+  if ((FLAGS_key_range == 0) || (FLAGS_key_range > scal::kRandMax)) {
+    fprintf(stderr, "%s: error: --key_range has to be in [1, %" PRIu32 "]\n",
+            __func__, scal::kRandMax);
+    exit(EXIT_FAILURE);
+  }
+
+  size_t tlsize = scal::HumanSizeToPages(
+      FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
+
+  g_num_threads = FLAGS_producers + FLAGS_consumers;
+  scal::ThreadLocalAllocator::Get().Init(tlsize, true);
+  scal::ThreadContext::prepare(g_num_threads + 1);
+  scal::ThreadContext::assign_context();
+
+  // Log 0 holds the prefill, logs 1..n the operations of thread i.
+  EventLog* logs = NULL;
+  if (FLAGS_rank_error) {
+    const uint64_t deletes =
+        FLAGS_producers * FLAGS_operations / FLAGS_consumers;
+    logs = static_cast<EventLog*>(scal::MallocAligned(
+        (g_num_threads + 1) * sizeof(EventLog), scal::kCachePrefetch));
+    for (uint64_t i = 0; i <= g_num_threads; i++) {
+      const uint64_t events = (i == 0) ? FLAGS_prefill :
+          ((i <= FLAGS_producers) ? FLAGS_operations : deletes);
+      logs[i].events = static_cast<Event*>(malloc(
+          (events + 1) * sizeof(Event)));
+      logs[i].size = 0;
+    }
+  }
+
+  Pool<uint64_t>* ds = static_cast<Pool<uint64_t>*>(ds_new());
+  for (uint64_t i = 0; i < FLAGS_prefill; i++) {
+    const uint64_t item = scal::pseudorand() % FLAGS_key_range + 1;
+    if (!ds->put(item)) {
+      fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+      abort();
+    }
+    if (logs != NULL) {
+      logs[0].events[logs[0].size].time = 0;
+      logs[0].events[logs[0].size].item = item;
+      logs[0].size++;
+    }
+  }
+
+  ProdConPqBench *benchmark = new ProdConPqBench(
+      g_num_threads,
+      tlsize,
+      ds,
+      logs);
+  benchmark->run();
+
+  if (FLAGS_print_summary) {
+    const uint64_t exec_time = benchmark->execution_time();
+    const uint64_t num_operations = 2 * FLAGS_producers * FLAGS_operations;
+    printf("{\"threads\": %" PRIu64 " ,\"producers\": %" PRIu64
+           " ,\"consumers\": %" PRIu64 " ,\"runtime\": %" PRIu64
+           " ,\"operations\": %" PRIu64 " ,\"prefill\": %" PRIu64
+           " ,\"key_range\": %" PRIu64 " ,\"c\": %" PRIu64
+           " ,\"throughput\": %" PRIu64 " ,\"empty_gets\": %" PRIu64,
+           g_num_threads,
+           FLAGS_producers,
+           FLAGS_consumers,
+           exec_time,
+           FLAGS_operations,
+           FLAGS_prefill,
+           FLAGS_key_range,
+           FLAGS_c,
+           (uint64_t)(num_operations /
+                      (static_cast<double>(exec_time) / 1000)),
+           benchmark->empty_gets());
+    char *ds_stats = ds_get_stats();
+    if (ds_stats != NULL) {
+      printf(" %s", ds_stats);
+    }
+    if (benchmark->placement() != NULL) {
+      benchmark->placement()->PrintJson(stdout);
+    }
+    scal::ThreadLocalAllocator::PrintMemoryJson(stdout);
+    if (benchmark->perf_counters() != NULL) {
+      benchmark->perf_counters()->PrintJson(stdout, num_operations);
+    }
+    if (logs != NULL) {
+      PrintRankErrors(logs, g_num_threads + 1);
+    }
+    printf("}\n");
+  }
+  return EXIT_SUCCESS;
+}
+
+
+void ProdConPqBench::producer(void) {
+  Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
+  const uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  for (uint64_t i = 0; i < FLAGS_operations; i++) {
+    // Do not use 0 as value, since there may be datastructures that do not
+    // support it.
+    const uint64_t item = scal::pseudorand() % FLAGS_key_range + 1;
+    if (!ds->put(item)) {
+      fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+      abort();
+    }
+    Record(thread_id, get_hwtime(), item);
+    scal::RdtscWait(FLAGS_c);
+  }
+}
+
+
+void ProdConPqBench::consumer(void) {
+  Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
+  const uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  const uint64_t operations =
+      FLAGS_producers * FLAGS_operations / FLAGS_consumers;
+  uint64_t empty_gets = 0;
+  uint64_t item;
+  uint64_t j = 0;
+  while (j < operations) {
+    const bool ok = ds->get(&item);
+    if (ok) {
+      Record(thread_id, get_hwtime(), item | kDeleteBit);
+      j++;
+    } else {
+      empty_gets++;
+    }
+    scal::RdtscWait(FLAGS_c);
+  }
+  __sync_fetch_and_add(&empty_gets_, empty_gets);
+}
+
+
+void ProdConPqBench::bench_func(void) {
+  // Thread ids start at 1.
+  if (scal::ThreadContext::get().thread_id() <= FLAGS_producers) {
+    producer();
+  } else {
+    consumer();
+  }
+}
+
+
+void PrintRankErrors(EventLog* logs, uint64_t num_logs) {
+  std::vector<Event> events;
+  for (uint64_t i = 0; i < num_logs; i++) {
+    events.insert(events.end(), logs[i].events,
+                  logs[i].events + logs[i].size);
+  }
+  std::stable_sort(events.begin(), events.end(), EventBefore);
+
+  std::vector<uint64_t> priorities;
+  priorities.reserve(events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    priorities.push_back(events[i].item & ~kDeleteBit);
+  }
+  std::sort(priorities.begin(), priorities.end());
+  priorities.erase(std::unique(priorities.begin(), priorities.end()),
+                   priorities.end());
+
+  // Power-of-two buckets: [0], [1], [2, 3], [4, 7], ...
+  uint64_t buckets[65] = { 0 };
+  uint64_t num_buckets = 1;
+  scal::LatencyHistogram ranks;
+  RankCounter counter(priorities.size());
+  // Deletes per priority that have been replayed before their inserts.
+  std::vector<uint64_t> early(priorities.size(), 0);
+  for (size_t i = 0; i < events.size(); i++) {
+    const uint64_t priority = events[i].item & ~kDeleteBit;
+    const uint64_t index = std::lower_bound(
+        priorities.begin(), priorities.end(), priority) - priorities.begin();
+    if ((events[i].item & kDeleteBit) == 0) {
+      if (early[index] > 0) {
+        early[index]--;
+      } else {
+        counter.Add(index, 1);
+      }
+      continue;
+    }
+    if (counter.CountBelow(index + 1) == counter.CountBelow(index)) {
+      early[index]++;
+    } else {
+      counter.Add(index, -1);
+    }
+    const uint64_t rank = counter.CountBelow(index);
+    ranks.Record(rank);
+    const uint64_t bucket = (rank == 0) ? 0 : 64 - __builtin_clzl(rank);
+    buckets[bucket]++;
+    if (bucket + 1 > num_buckets) {
+      num_buckets = bucket + 1;
+    }
+  }
+
+  // Deletes of items that have never been inserted.
+  uint64_t unmatched = 0;
+  for (size_t i = 0; i < early.size(); i++) {
+    unmatched += early[i];
+  }
+  printf(" ,\"rank_error\": {\"deletes\": %" PRIu64 " ,\"unmatched\": %" PRIu64
+         " ,\"mean\": %.2f ,\"p50\": %" PRIu64 " ,\"p99\": %" PRIu64
+         " ,\"max\": %" PRIu64 " ,\"histogram\": [",
+         ranks.count(), unmatched,
+         (ranks.count() == 0) ? 0.0 :
+             static_cast<double>(ranks.sum()) / ranks.count(),
+         ranks.Percentile(0.5), ranks.Percentile(0.99), ranks.max());
+  for (uint64_t i = 0; i < num_buckets; i++) {
+    printf("%s{\"max_rank\": %" PRIu64 " ,\"count\": %" PRIu64 "}",
+           (i == 0) ? "" : ", ", (i == 0) ? 0 : (1UL << i) - 1, buckets[i]);
+  }
+  printf("]}");
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_PRODCON_ARRIVAL_PROCESS_H_
+#define SCAL_BENCHMARK_PRODCON_ARRIVAL_PROCESS_H_
+
+#include <inttypes.h>
+
+#include <random>
+
+namespace scal {
+
+// Arrival schedule of an open-loop producer in TSC cycles.
+class ArrivalProcess {
+ public:
+  ArrivalProcess(uint64_t start, double mean_cycles)
+      : next_(static_cast<double>(start))
+      , mean_cycles_(mean_cycles) {}
+
+  virtual ~ArrivalProcess() {}
+
+  // Returns the time of the next arrival.
+  virtual uint64_t Next() = 0;
+
+ protected:
+  double next_;
+  double mean_cycles_;
+};
+
+
+// Arrivals at a fixed rate.
+class FixedArrivalProcess : public ArrivalProcess {
+ public:
+  FixedArrivalProcess(uint64_t start, double mean_cycles)
+      : ArrivalProcess(start, mean_cycles) {}
+
+  virtual uint64_t Next() {
+    next_ += mean_cycles_;
+    return static_cast<uint64_t>(next_);
+  }
+};
+
+
+// Poisson arrivals, i.e., exponentially distributed inter-arrival times.
+class PoissonArrivalProcess : public ArrivalProcess {
+ public:
+  PoissonArrivalProcess(uint64_t start, double mean_cycles, uint64_t seed)
+      : ArrivalProcess(start, mean_cycles)
+      , rng_(seed)
+      , dist_(1.0 / mean_cycles) {}
+
+  virtual uint64_t Next() {
+    next_ += dist_(rng_);
+    return static_cast<uint64_t>(next_);
+  }
+
+ private:
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> dist_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_PRODCON_ARRIVAL_PROCESS_H_
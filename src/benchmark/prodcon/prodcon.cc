@@ -5,6 +5,7 @@
 #define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
 
 #include <gflags/gflags.h>
+#include <malloc.h>
 #include <pthread.h>
 #include <inttypes.h>
 #include <stdio.h>
@@ -12,14 +13,24 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+
 #include "benchmark/common.h"
+#include "benchmark/latency_histogram.h"
+#include "benchmark/perf_counters.h"
+#include "benchmark/thread_placement.h"
+#include "benchmark/prodcon/arrival_process.h"
 #include "benchmark/prodcon/prodcon_distribution.h"
 #include "benchmark/std_glue/std_pipe_api.h"
+#include "benchmark/sweep.h"
+#include "benchmark/throughput_sampler.h"
+#include "datastructures/blocking_pool.h"
 #include "datastructures/pool.h"
 #include "util/allocation.h"
 #include "util/malloc-compat.h"
 #include "util/operation_logger.h"
 #include "util/random.h"
+#include "util/reclamation.h"
 #include "util/threadlocals.h"
 #include "util/scal-time.h"
 #include "util/workloads.h"
@@ -32,18 +43,112 @@ DEFINE_uint64(c, 5000, "computational workload");
 DEFINE_bool(print_summary, true, "print execution summary");
 DEFINE_bool(log_operations, false, "log invocation/response/linearization "
                                    "of all operations");
+DEFINE_string(log_file, "", "stream the operation log in binary form to "
+                            "<log_file>.<thread id> (see scal-analyze)");
 DEFINE_bool(barrier, false, "uses a barrier between the enqueues and "
     "dequeues such that first all elements are enqueued, then all elements"
     "are dequeued");
 DEFINE_bool(shuffle_threads, false, "shuffle producers and consumers");
+DEFINE_uint64(duration_ms, 0, "run for the given time instead of a fixed "
+                              "number of operations (0: disabled)");
+DEFINE_uint64(sample_interval_ms, 0, "report a throughput time series with "
+                                     "the given sample interval "
+                                     "(0: disabled)");
+DEFINE_string(producer_placement, "", "placement policy for producers "
+                                      "(default: --placement)");
+DEFINE_string(consumer_placement, "", "placement policy for consumers "
+                                      "(default: --placement)");
+DEFINE_bool(latency, false, "report put/get latency percentiles (only "
+                            "successful gets are recorded)");
+DEFINE_string(arrival, "closed", "producer arrivals: closed (back-to-back "
+                                 "puts), or open loop with fixed or poisson "
+                                 "inter-arrival times (c then only applies "
+                                 "to consumers)");
+DEFINE_uint64(rate, 0, "open loop: puts per second per producer");
+DEFINE_bool(blocking, false, "consumers park on an empty data structure "
+                             "instead of polling");
+DEFINE_uint64(spin, 1000, "blocking: failed gets before a consumer parks");
+DEFINE_bool(idle_stats, false, "report CPU time of consumers and (with "
+                               "--blocking) parks, wake ups, and wake up "
+                               "latency");
+DEFINE_uint64(batch, 1, "items per put_batch/get_batch (1: single item "
+                        "put/get)");
+DEFINE_double(footprint, 0, "prefill the data structure with the given "
+                            "number of million items from a single thread, "
+                            "report bytes per element, and exit");
+
+DECLARE_string(placement);
 
 using scal::Benchmark;
 
+namespace {
+
+// Item ids in duration mode: thread id in the upper bits.
+const uint64_t kItemIdBits = 40;
+const uint64_t kItemIdMask = (1UL << kItemIdBits) - 1;
+
+// Blocking consumers in duration mode check for the end of the run at least
+// this often (us).
+const uint64_t kTimedWaitUs = 1000;
+
+
+uint64_t ThreadCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+
+// Bytes allocated through the thread-local allocators and through malloc
+// (which also backs MallocAligned()).
+uint64_t AllocatedBytes() {
+  const struct mallinfo2 info = mallinfo2();
+  return scal::ThreadLocalAllocator::TotalUsage().live_bytes +
+         info.uordblks + info.hblkhd;
+}
+
+
+// Implements --footprint.
+void PrintFootprint() {
+  const uint64_t items = FLAGS_footprint * 1000000;
+  const uint64_t before = AllocatedBytes();
+  Pool<uint64_t>* ds = static_cast<Pool<uint64_t>*>(ds_new());
+  const uint64_t construction = AllocatedBytes() - before;
+  uint64_t stored = 0;
+  while ((stored < items) && ds->put(stored + 1)) {
+    stored++;
+  }
+  // Preallocating structures pay for all of their elements at construction,
+  // so the per-element numbers are reported with and without construction.
+  const uint64_t bytes = AllocatedBytes() - before;
+  const double per_element = (stored > 0) ? 1.0 / stored : 0.0;
+  printf("{\"footprint_items\": %" PRIu64 " ,\"construction_bytes\": %" PRIu64
+         " ,\"bytes\": %" PRIu64 " ,\"bytes_per_element\": %.2f"
+         " ,\"growth_bytes_per_element\": %.2f",
+         stored, construction, bytes, bytes * per_element,
+         (bytes - construction) * per_element);
+  char *ds_stats = ds_get_stats();
+  if (ds_stats != NULL) {
+    printf(" %s", ds_stats);
+  }
+  scal::ThreadLocalAllocator::PrintMemoryJson(stdout);
+  scal::ThreadLocalAllocator::PrintArenaJson(stdout);
+  printf("}\n");
+}
+
+}  // namespace
+
 
 class ProdConBench : public Benchmark {
  public:
-  ProdConBench(
-      uint64_t num_threads, uint64_t thread_prealloc_size, void *data);
+  ProdConBench(uint64_t num_threads,
+               uint64_t thread_prealloc_size,
+               void *data,
+               scal::ThroughputSampler* sampler,
+               scal::LatencyRecorder* latency);
+
+  inline uint64_t consumer_cpu_ns() { return consumer_cpu_ns_; }
+  inline uint64_t parks() { return parks_; }
 
  protected:
   void bench_func();
@@ -51,8 +156,21 @@ class ProdConBench : public Benchmark {
  private:
   void producer();
   void consumer();
+  void batch_producer();
+  void batch_consumer();
 
   scal::ProdConDistribution* prodcon_distribution_;
+  scal::ThroughputSampler* sampler_;
+  scal::LatencyRecorder* latency_;
+  // Open loop only: scheduled arrival time (TSC) of every item, indexed by
+  // the item itself.
+  uint64_t* enqueue_times_;
+  double cycles_per_put_;
+  // Set with --blocking: data_ wrapped into a pool with parking consumers.
+  scal::BlockingPool<uint64_t>* blocking_;
+  // Summed up over all consumers.
+  uint64_t consumer_cpu_ns_;
+  uint64_t parks_;
   pthread_barrier_t prod_con_barrier_;
 };
 
@@ -63,6 +181,56 @@ int main(int argc, const char **argv) {
   std::string usage("Producer/consumer micro benchmark.");
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, const_cast<char***>(&argv), true);
+  if (scal::Sweep::Requested()) {
+    return scal::Sweep::RunFromFlags("throughput");
+  }
+
+  if ((FLAGS_duration_ms > 0) && FLAGS_barrier) {
+    fprintf(stderr, "%s: error: --duration_ms cannot be combined with "
+                    "--barrier\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+  const bool open_loop = FLAGS_arrival != "closed";
+  if (open_loop) {
+    if ((FLAGS_arrival != "fixed") && (FLAGS_arrival != "poisson")) {
+      fprintf(stderr, "%s: error: unknown arrival process '%s'\n",
+              __func__, FLAGS_arrival.c_str());
+      exit(EXIT_FAILURE);
+    }
+    if (FLAGS_rate == 0) {
+      fprintf(stderr, "%s: error: open loop arrivals require --rate\n",
+              __func__);
+      exit(EXIT_FAILURE);
+    }
+    if ((FLAGS_duration_ms > 0) || FLAGS_barrier) {
+      fprintf(stderr, "%s: error: open loop arrivals cannot be combined "
+                      "with --duration_ms or --barrier\n", __func__);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (FLAGS_blocking && (FLAGS_batch > 1)) {
+    fprintf(stderr, "%s: error: --blocking cannot be combined with --batch\n",
+            __func__);
+    exit(EXIT_FAILURE);
+  }
+  if (FLAGS_batch == 0) {
+    fprintf(stderr, "%s: error: --batch must be at least 1\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+  if ((FLAGS_batch > 1) && (open_loop || FLAGS_latency ||
+                            FLAGS_log_operations ||
+                            !FLAGS_log_file.empty())) {
+    fprintf(stderr, "%s: error: --batch cannot be combined with open loop "
+                    "arrivals, --latency, or operation logging\n", __func__);
+    exit(EXIT_FAILURE);
+  }
+  if ((!FLAGS_producer_placement.empty() ||
+       !FLAGS_consumer_placement.empty()) && FLAGS_barrier) {
+    // With a barrier threads act as both, producers and consumers.
+    fprintf(stderr, "%s: error: --producer_placement and --consumer_placement "
+                    "cannot be combined with --barrier\n", __func__);
+    exit(EXIT_FAILURE);
+  }
 
   size_t tlsize = scal::HumanSizeToPages(
       FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
@@ -83,20 +251,46 @@ int main(int argc, const char **argv) {
   scal::ThreadContext::prepare(g_num_threads + 1);
   scal::ThreadContext::assign_context();
 
-  if (FLAGS_log_operations) {
+  if (!FLAGS_log_file.empty()) {
+    scal::StdOperationLogger::prepare_binary(g_num_threads + 1,
+                                             FLAGS_operations +100000,
+                                             FLAGS_log_file.c_str());
+  } else if (FLAGS_log_operations) {
     scal::StdOperationLogger::prepare(g_num_threads + 1,
                                       FLAGS_operations +100000);
   }
 
+  if (FLAGS_footprint > 0) {
+    PrintFootprint();
+    return EXIT_SUCCESS;
+  }
+
   void *ds = ds_new();
+  if (FLAGS_blocking) {
+    ds = new scal::BlockingPool<uint64_t>(
+        static_cast<Pool<uint64_t>*>(ds), FLAGS_spin);
+  }
 
+  scal::ThroughputSampler sampler(
+      g_num_threads, FLAGS_sample_interval_ms, FLAGS_duration_ms);
+  scal::LatencyRecorder* latency = NULL;
+  if (FLAGS_latency || open_loop || (FLAGS_blocking && FLAGS_idle_stats)) {
+    latency = new scal::LatencyRecorder(g_num_threads);
+  }
   ProdConBench *benchmark = new ProdConBench(
       g_num_threads,
       tlsize,
-      ds);
+      ds,
+      &sampler,
+      latency);
+  sampler.Start();
   benchmark->run();
+  sampler.Finish();
+  if (latency != NULL) {
+    latency->Merge();
+  }
 
-  if (FLAGS_log_operations) {
+  if (FLAGS_log_operations || !FLAGS_log_file.empty()) {
     scal::StdOperationLogger::print_summary();
   }
 
@@ -105,7 +299,10 @@ int main(int argc, const char **argv) {
 
     uint64_t num_operations;
     
-    if (FLAGS_barrier) {
+    if (FLAGS_duration_ms > 0) {
+      // Every successful put and get has been counted.
+      num_operations = sampler.TotalOperations();
+    } else if (FLAGS_barrier) {
       // We only measure the time needed for the all consuming operations
       // which is the same as the number of all produced elements.
       num_operations = FLAGS_operations * FLAGS_producers;
@@ -124,32 +321,89 @@ int main(int argc, const char **argv) {
         FLAGS_producers,
         FLAGS_consumers,
         exec_time,
-        FLAGS_operations,
+        (FLAGS_duration_ms > 0) ? num_operations : FLAGS_operations,
         FLAGS_c,
         (uint64_t)(num_operations / (static_cast<double>(exec_time) / 1000)));
     if (n != strlen(buffer)) {
       fprintf(stderr, "%s: error: failed to create summary string\n", __func__);
       abort();
     }
+    printf("%s", buffer);
+    if (FLAGS_batch > 1) {
+      printf(" ,\"batch\": %" PRIu64, FLAGS_batch);
+    }
     char *ds_stats = ds_get_stats();
     if (ds_stats != NULL) {
-      if (n + strlen(ds_stats) >= 1023) {  // separating space + '\0'
-        fprintf(stderr, "%s: error: strings too long\n", __func__);
-        abort();
+      printf(" %s", ds_stats);
+    }
+    scal::Reclamation::PrintJson(stdout);
+    if (benchmark->placement() != NULL) {
+      benchmark->placement()->PrintJson(stdout);
+    }
+    scal::ThreadLocalAllocator::PrintMemoryJson(stdout);
+    scal::ThreadLocalAllocator::PrintArenaJson(stdout);
+    if (benchmark->perf_counters() != NULL) {
+      benchmark->perf_counters()->PrintJson(stdout, num_operations);
+    }
+    sampler.PrintJson(stdout);
+    if (FLAGS_idle_stats && (FLAGS_consumers > 0)) {
+      const double cpu_ms = benchmark->consumer_cpu_ns() / 1e6;
+      printf(" ,\"idle\": {\"consumer_cpu_ms\": %.3f"
+             " ,\"consumer_cpu_utilization\": %.3f",
+             cpu_ms,
+             cpu_ms * 1000 / (FLAGS_consumers * exec_time));
+      if (FLAGS_blocking) {
+        printf(" ,\"parks\": %" PRIu64 " ,\"wakeups\": %" PRIu64,
+               benchmark->parks(),
+               static_cast<scal::BlockingPool<uint64_t>*>(
+                   static_cast<Pool<uint64_t>*>(ds))->wakeups());
       }
-      strcat(buffer, " ");
-      strcat(buffer, ds_stats);
-      strcat(buffer, "}");
+      printf("}");
+    }
+    if (open_loop) {
+      printf(" ,\"arrival\": \"%s\" ,\"offered_rate\": %" PRIu64
+             " ,\"achieved_rate\": %" PRIu64,
+             FLAGS_arrival.c_str(),
+             FLAGS_rate * FLAGS_producers,
+             (uint64_t)(FLAGS_operations * FLAGS_producers /
+                 (static_cast<double>(exec_time) / 1000000)));
     }
-    printf("%s\n", buffer);
+    if (latency != NULL) {
+      latency->PrintJson(stdout);
+    }
+    printf("}\n");
   }
   return EXIT_SUCCESS;
 }
 
 
-ProdConBench::ProdConBench(
-    uint64_t num_threads, uint64_t thread_prealloc_size, void* data)
-        : Benchmark(num_threads, thread_prealloc_size, data) {
+ProdConBench::ProdConBench(uint64_t num_threads,
+                           uint64_t thread_prealloc_size,
+                           void* data,
+                           scal::ThroughputSampler* sampler,
+                           scal::LatencyRecorder* latency)
+    : Benchmark(num_threads, thread_prealloc_size, data),
+      sampler_(sampler),
+      latency_(latency),
+      enqueue_times_(NULL),
+      cycles_per_put_(0),
+      blocking_(NULL),
+      consumer_cpu_ns_(0),
+      parks_(0) {
+  if (FLAGS_blocking) {
+    blocking_ = static_cast<scal::BlockingPool<uint64_t>*>(
+        static_cast<Pool<uint64_t>*>(data));
+  }
+  if (FLAGS_arrival != "closed") {
+    // Item ids are at most (producers + consumers + 1) * operations.
+    enqueue_times_ = static_cast<uint64_t*>(
+        calloc((num_threads + 1) * FLAGS_operations + 1, sizeof(uint64_t)));
+    if (enqueue_times_ == NULL) {
+      perror("calloc");
+      abort();
+    }
+    cycles_per_put_ = latency_->cycles_per_ns() * 1e9 / FLAGS_rate;
+  }
   if (FLAGS_shuffle_threads) {
     prodcon_distribution_ = new scal::RandomProdConDistribution(
         FLAGS_producers, FLAGS_consumers);
@@ -157,6 +411,17 @@ ProdConBench::ProdConBench(
     prodcon_distribution_ = new scal::DefaultProdConDistribution(
         FLAGS_producers, FLAGS_consumers);
   }
+  if (!FLAGS_producer_placement.empty() ||
+      !FLAGS_consumer_placement.empty()) {
+    scal::ThreadPlacement* placement = new scal::ThreadPlacement(num_threads);
+    prodcon_distribution_->Place(
+        placement,
+        FLAGS_producer_placement.empty() ?
+            FLAGS_placement : FLAGS_producer_placement,
+        FLAGS_consumer_placement.empty() ?
+            FLAGS_placement : FLAGS_consumer_placement);
+    set_placement(placement);
+  }
   if (pthread_barrier_init(&prod_con_barrier_, NULL, num_threads)) {
     fprintf(stderr, "%s: error: Unable to init start barrier.\n", __func__);
     abort();
@@ -165,26 +430,77 @@ ProdConBench::ProdConBench(
 
 
 void ProdConBench::producer() {
+  if (FLAGS_batch > 1) {
+    batch_producer();
+    return;
+  }
   Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
   uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  const bool timed = FLAGS_duration_ms > 0;
+  const bool count = sampler_->active();
+  const bool record_latency = FLAGS_latency;
+  scal::ArrivalProcess* arrivals = NULL;
+  if (enqueue_times_ != NULL) {
+    if (FLAGS_arrival == "poisson") {
+      arrivals = new scal::PoissonArrivalProcess(
+          get_hwtime(), cycles_per_put_, scal::hwrand() + thread_id);
+    } else {
+      arrivals = new scal::FixedArrivalProcess(get_hwtime(), cycles_per_put_);
+    }
+  }
   uint64_t item;
+  uint64_t start = 0;
   // Do not use 0 as value, since there may be datastructures that do not
   // support it.
-  for (uint64_t i = 1; i <= FLAGS_operations; i++) {
-    item = thread_id * FLAGS_operations + i;
+  for (uint64_t i = 1; timed || (i <= FLAGS_operations); i++) {
+    if (timed) {
+      if (sampler_->stopped()) {
+        break;
+      }
+      // Keep items unique and within 48 bits (tagged values) without
+      // knowing the number of operations upfront.
+      item = (thread_id << kItemIdBits) | (i & kItemIdMask);
+    } else {
+      item = thread_id * FLAGS_operations + i;
+    }
+    if (arrivals != NULL) {
+      // The sojourn time starts at the scheduled arrival, so that a producer
+      // falling behind its schedule does not hide queueing delay.
+      const uint64_t arrival = arrivals->Next();
+      while (get_hwtime() < arrival) {
+        __asm__ __volatile__("pause");
+      }
+      enqueue_times_[item] = arrival;
+    }
     scal::StdOperationLogger::get().invoke(scal::LogType::kEnqueue);
+    if (record_latency) {
+      start = get_hwtime();
+    }
     if (!ds->put(item)) {
       // We should always be able to insert an item.
       fprintf(stderr, "%s: error: put operation failed.\n", __func__);
       abort();
     }
+    if (record_latency) {
+      latency_->RecordPut(thread_id, get_hwtime() - start);
+    }
     scal::StdOperationLogger::get().response(true, item);
-    scal::RdtscWait(FLAGS_c);
+    if (count) {
+      sampler_->Count(thread_id);
+    }
+    if (arrivals == NULL) {
+      scal::RdtscWait(FLAGS_c);
+    }
   }
+  delete arrivals;
 }
 
 
 void ProdConBench::consumer() {
+  if (FLAGS_batch > 1) {
+    batch_consumer();
+    return;
+  }
   Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
   //const uint64_t thread_id = scal::ThreadContext::get().thread_id();
   // Calculate the items each consumer has to collect.
@@ -197,23 +513,129 @@ void ProdConBench::consumer() {
   }
   */
 
+  const uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  const bool timed = FLAGS_duration_ms > 0;
+  const bool count = sampler_->active();
+  const bool record_latency = FLAGS_latency;
+  const uint64_t cpu_start = ThreadCpuNs();
   uint64_t j = 0;
   uint64_t ret;
+  uint64_t start = 0;
+  uint64_t parks = 0;
   bool ok;
-  while (j < operations) {
+  while (timed || (j < operations)) {
+    if (timed && sampler_->stopped()) {
+      break;
+    }
     scal::StdOperationLogger::get().invoke(scal::LogType::kDequeue);
-    ok = ds->get(&ret);
+    if (record_latency) {
+      start = get_hwtime();
+    }
+    if (blocking_ != NULL) {
+      scal::BlockingPool<uint64_t>::WaitInfo info = { 0, 0 };
+      ok = blocking_->get_wait(
+          &ret, timed ? kTimedWaitUs : Pool<uint64_t>::kWaitForever, &info);
+      parks += info.parks;
+      if ((info.wakeup_cycles > 0) && (latency_ != NULL)) {
+        latency_->RecordWakeup(thread_id, info.wakeup_cycles);
+      }
+    } else {
+      ok = ds->get(&ret);
+    }
+    if (ok && (record_latency || (enqueue_times_ != NULL))) {
+      const uint64_t now = get_hwtime();
+      if (record_latency) {
+        latency_->RecordGet(thread_id, now - start);
+      }
+      if (enqueue_times_ != NULL) {
+        latency_->RecordSojourn(thread_id, now - enqueue_times_[ret]);
+      }
+    }
     scal::StdOperationLogger::get().response(ok, ret);
     scal::RdtscWait(FLAGS_c);
     if (!ok) {
       continue;
     }
+    if (count) {
+      sampler_->Count(thread_id);
+    }
     j++;
   }
+  __sync_fetch_and_add(&consumer_cpu_ns_, ThreadCpuNs() - cpu_start);
+  __sync_fetch_and_add(&parks_, parks);
+}
+
+
+// Same items and termination as producer(), but FLAGS_batch items are put at
+// once. The computational workload is applied between batches.
+void ProdConBench::batch_producer() {
+  Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
+  const uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  const bool timed = FLAGS_duration_ms > 0;
+  const bool count = sampler_->active();
+  uint64_t* items = static_cast<uint64_t*>(
+      malloc(FLAGS_batch * sizeof(uint64_t)));
+  uint64_t i = 1;
+  while (timed || (i <= FLAGS_operations)) {
+    if (timed && sampler_->stopped()) {
+      break;
+    }
+    size_t num = 0;
+    for (; (num < FLAGS_batch) && (timed || (i <= FLAGS_operations));
+         num++, i++) {
+      if (timed) {
+        items[num] = (thread_id << kItemIdBits) | (i & kItemIdMask);
+      } else {
+        items[num] = thread_id * FLAGS_operations + i;
+      }
+    }
+    if (!ds->put_batch(items, num)) {
+      fprintf(stderr, "%s: error: put_batch operation failed.\n", __func__);
+      abort();
+    }
+    if (count) {
+      sampler_->Count(thread_id, num);
+    }
+    scal::RdtscWait(FLAGS_c);
+  }
+  free(items);
+}
+
+
+void ProdConBench::batch_consumer() {
+  Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
+  const uint64_t operations = FLAGS_producers * FLAGS_operations /
+                              FLAGS_consumers;
+  const uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  const bool timed = FLAGS_duration_ms > 0;
+  const bool count = sampler_->active();
+  const uint64_t cpu_start = ThreadCpuNs();
+  uint64_t* items = static_cast<uint64_t*>(
+      malloc(FLAGS_batch * sizeof(uint64_t)));
+  uint64_t j = 0;
+  while (timed || (j < operations)) {
+    if (timed && sampler_->stopped()) {
+      break;
+    }
+    const size_t max = timed ? FLAGS_batch
+                             : std::min(FLAGS_batch, operations - j);
+    const size_t num = ds->get_batch(items, max);
+    scal::RdtscWait(FLAGS_c);
+    if (num == 0) {
+      continue;
+    }
+    if (count) {
+      sampler_->Count(thread_id, num);
+    }
+    j += num;
+  }
+  free(items);
+  __sync_fetch_and_add(&consumer_cpu_ns_, ThreadCpuNs() - cpu_start);
 }
 
 
 void ProdConBench::bench_func() {
+  sampler_->Arm();
   // We need 0-based idx.
   const uint64_t thread_id = scal::ThreadContext::get().thread_id() - 1;
   if (FLAGS_barrier) {
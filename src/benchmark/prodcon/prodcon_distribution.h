@@ -4,6 +4,10 @@
 #include <gflags/gflags.h>
 #include <inttypes.h>
 
+#include <string>
+#include <vector>
+
+#include <benchmark/thread_placement.h>
 #include <util/random.h>
 
 DEFINE_uint64(shuffle_threads_seed, 0, "seed for thread_shuffle");
@@ -19,6 +23,24 @@ class ProdConDistribution {
 
   virtual bool IsProducer(size_t thread_id) = 0;
 
+  // Places producers and consumers separately. Consumers avoid the cpus
+  // already taken by producers, unless an explicit list is given.
+  void Place(ThreadPlacement* placement,
+             const std::string& producer_policy,
+             const std::string& consumer_policy) {
+    std::vector<uint64_t> producers;
+    std::vector<uint64_t> consumers;
+    for (size_t i = 0; i < num_threads(); i++) {
+      if (IsProducer(i)) {
+        producers.push_back(i);
+      } else {
+        consumers.push_back(i);
+      }
+    }
+    placement->Assign(producers, producer_policy, "producers");
+    placement->Assign(consumers, consumer_policy, "consumers");
+  }
+
  protected:
   size_t num_threads() {
     return producer_ + consumer_;
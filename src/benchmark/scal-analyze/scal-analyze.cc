@@ -0,0 +1,343 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Offline analysis of binary operation logs (see --log_file of prodcon and
+// seqalt).
+//
+// For every successful get the relaxation distance of the returned element e
+// is computed, i.e., how far the get deviates from strict order:
+// * fifo: the number of elements put before e that are still present when e
+//   is removed.
+// * lifo: the number of elements put after e (but before the get) that are
+//   still present when e is removed.
+// Operations are ordered by a single timestamp per operation (--timestamp).
+// Both orders are computed in O(n log n) using a Fenwick tree over the ranks
+// of puts; sorting and matching run on --threads threads.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/binary_log.h"
+#include "util/operation_logger.h"
+
+DEFINE_string(order, "fifo", "reference order: fifo or lifo");
+DEFINE_string(timestamp, "invocation", "timestamp used to order operations: "
+                                       "invocation, response, or midpoint");
+DEFINE_uint64(threads, 0, "number of analysis threads (0: number of cpus)");
+DEFINE_bool(histogram, true, "print a histogram of distances (power of two "
+                             "buckets)");
+
+namespace {
+
+const uint64_t kUnmatched = ~0UL;
+
+struct Event {
+  uint64_t time;
+  uint64_t item;
+
+  bool operator<(const Event& other) const {
+    return (time < other.time) || ((time == other.time) && (item < other.item));
+  }
+};
+
+struct ItemRank {
+  uint64_t item;
+  uint64_t rank;
+
+  bool operator<(const ItemRank& other) const {
+    return item < other.item;
+  }
+};
+
+
+uint64_t num_threads;
+
+
+// Calls func(begin, end) for num_threads consecutive chunks of [0, n).
+template<typename F>
+void ParallelFor(uint64_t n, F func) {
+  std::vector<std::thread> threads;
+  const uint64_t chunk = (n + num_threads - 1) / num_threads;
+  for (uint64_t begin = 0; begin < n; begin += chunk) {
+    const uint64_t end = std::min(n, begin + chunk);
+    threads.push_back(std::thread(func, begin, end));
+  }
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+}
+
+
+// Sorts chunks in parallel and merges them pairwise, also in parallel.
+template<typename T>
+void ParallelSort(std::vector<T>* v) {
+  const uint64_t n = v->size();
+  if (n == 0) {
+    return;
+  }
+  const uint64_t chunk = (n + num_threads - 1) / num_threads;
+  ParallelFor(n, [v](uint64_t begin, uint64_t end) {
+    std::sort(v->begin() + begin, v->begin() + end);
+  });
+  for (uint64_t width = chunk; width < n; width *= 2) {
+    std::vector<std::thread> threads;
+    for (uint64_t begin = 0; begin + width < n; begin += 2 * width) {
+      const uint64_t mid = begin + width;
+      const uint64_t end = std::min(n, begin + 2 * width);
+      threads.push_back(std::thread([v, begin, mid, end]() {
+        std::inplace_merge(
+            v->begin() + begin, v->begin() + mid, v->begin() + end);
+      }));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+      threads[i].join();
+    }
+  }
+}
+
+
+class FenwickTree {
+ public:
+  explicit FenwickTree(uint64_t size) : tree_(size + 1, 0) {}
+
+  void Add(uint64_t index) {
+    for (uint64_t i = index + 1; i < tree_.size(); i += i & (~i + 1)) {
+      tree_[i]++;
+    }
+  }
+
+  // Returns the number of added indices smaller than index.
+  uint64_t Count(uint64_t index) const {
+    uint64_t sum = 0;
+    for (uint64_t i = index; i > 0; i -= i & (~i + 1)) {
+      sum += tree_[i];
+    }
+    return sum;
+  }
+
+ private:
+  std::vector<uint64_t> tree_;
+};
+
+
+inline uint64_t Timestamp(const scal::BinaryLogRecord& record) {
+  if (FLAGS_timestamp == "response") {
+    return record.invocation + record.duration;
+  } else if (FLAGS_timestamp == "midpoint") {
+    return record.invocation + record.duration / 2;
+  }
+  return record.invocation;
+}
+
+
+void PrintDistances(std::vector<uint64_t>* distances) {
+  const uint64_t n = distances->size();
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    sum += (*distances)[i];
+  }
+  ParallelSort(distances);
+  const double kPercentiles[] = { 50, 90, 99, 99.9 };
+  const char* const kPercentileNames[] = { "p50", "p90", "p99", "p999" };
+  printf(" ,\"distance\": {\"mean\": %.3f ,\"max\": %" PRIu64,
+         (n > 0) ? static_cast<double>(sum) / n : 0.0,
+         (n > 0) ? distances->back() : 0);
+  for (size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]); i++) {
+    const uint64_t index = static_cast<uint64_t>(kPercentiles[i] * n / 100);
+    printf(" ,\"%s\": %" PRIu64, kPercentileNames[i],
+           (n > 0) ? (*distances)[std::min(index, n - 1)] : 0);
+  }
+  printf("}");
+  if (!FLAGS_histogram) {
+    return;
+  }
+  // Bucket 0 holds distance 0, bucket i > 0 holds [2^(i-1), 2^i).
+  std::vector<uint64_t> buckets;
+  for (uint64_t i = 0; i < n; i++) {
+    const uint64_t d = (*distances)[i];
+    const size_t bucket = (d == 0) ? 0 : 64 - __builtin_clzl(d);
+    if (bucket >= buckets.size()) {
+      buckets.resize(bucket + 1, 0);
+    }
+    buckets[bucket]++;
+  }
+  printf(" ,\"histogram\": [");
+  for (size_t i = 0; i < buckets.size(); i++) {
+    printf("%s[%" PRIu64 ", %" PRIu64 "]", (i == 0) ? "" : ", ",
+           (i == 0) ? 0 : (1UL << (i - 1)), buckets[i]);
+  }
+  printf("]");
+}
+
+}  // namespace
+
+
+int main(int argc, char** argv) {
+  std::string usage("scal-analyze [options] log_file...");
+  google::SetUsageMessage(usage);
+  uint32_t cmd_index = google::ParseCommandLineFlags(
+      &argc, const_cast<char***>(&argv), true);
+  if (cmd_index >= static_cast<uint32_t>(argc)) {
+    google::ShowUsageWithFlags(google::GetArgv0());
+    exit(EXIT_FAILURE);
+  }
+  const bool lifo = FLAGS_order == "lifo";
+  if (!lifo && (FLAGS_order != "fifo")) {
+    fprintf(stderr, "unknown order: %s\n", FLAGS_order.c_str());
+    exit(EXIT_FAILURE);
+  }
+  if ((FLAGS_timestamp != "invocation") && (FLAGS_timestamp != "response") &&
+      (FLAGS_timestamp != "midpoint")) {
+    fprintf(stderr, "unknown timestamp: %s\n", FLAGS_timestamp.c_str());
+    exit(EXIT_FAILURE);
+  }
+  num_threads = FLAGS_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  const uint64_t num_logs = argc - cmd_index;
+  std::vector<scal::BinaryLogReader> logs(num_logs);
+  for (uint64_t i = 0; i < num_logs; i++) {
+    logs[i].Open(argv[cmd_index + i]);
+  }
+
+  // Count puts and successful gets per log to find the offsets at which every
+  // log is copied into the global arrays.
+  std::vector<uint64_t> put_offsets(num_logs + 1, 0);
+  std::vector<uint64_t> get_offsets(num_logs + 1, 0);
+  uint64_t operations = 0;
+  for (uint64_t i = 0; i < num_logs; i++) {
+    uint64_t puts = 0;
+    uint64_t gets = 0;
+    const scal::BinaryLogRecord* records = logs[i].records();
+    for (uint64_t j = 0; j < logs[i].num_records(); j++) {
+      if (records[j].op_type == scal::kEnqueue) {
+        puts++;
+      } else if (records[j].success) {
+        gets++;
+      }
+    }
+    put_offsets[i + 1] = put_offsets[i] + puts;
+    get_offsets[i + 1] = get_offsets[i] + gets;
+    operations += logs[i].num_records();
+  }
+  const uint64_t num_puts = put_offsets[num_logs];
+  const uint64_t num_gets = get_offsets[num_logs];
+
+  std::vector<Event> puts(num_puts);
+  std::vector<Event> gets(num_gets);
+  std::vector<std::thread> readers;
+  for (uint64_t i = 0; i < num_logs; i++) {
+    readers.push_back(std::thread([&, i]() {
+      uint64_t put = put_offsets[i];
+      uint64_t get = get_offsets[i];
+      const scal::BinaryLogRecord* records = logs[i].records();
+      for (uint64_t j = 0; j < logs[i].num_records(); j++) {
+        const Event event = { Timestamp(records[j]), records[j].item };
+        if (records[j].op_type == scal::kEnqueue) {
+          puts[put++] = event;
+        } else if (records[j].success) {
+          gets[get++] = event;
+        }
+      }
+    }));
+  }
+  for (size_t i = 0; i < readers.size(); i++) {
+    readers[i].join();
+  }
+  for (uint64_t i = 0; i < num_logs; i++) {
+    logs[i].Close();
+  }
+
+  ParallelSort(&puts);
+  ParallelSort(&gets);
+
+  // Rank of every put in put order, looked up by item.
+  std::vector<ItemRank> ranks(num_puts);
+  ParallelFor(num_puts, [&](uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      ranks[i].item = puts[i].item;
+      ranks[i].rank = i;
+    }
+  });
+  ParallelSort(&ranks);
+  for (uint64_t i = 1; i < num_puts; i++) {
+    if (ranks[i].item == ranks[i - 1].item) {
+      fprintf(stderr, "error: item %" PRIu64 " has been put more than once\n",
+              ranks[i].item);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // For every get: the rank of its element, and (lifo) the number of puts
+  // preceding it.
+  std::vector<uint64_t> get_ranks(num_gets);
+  std::vector<uint64_t> preceding_puts(lifo ? num_gets : 0);
+  ParallelFor(num_gets, [&](uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      const ItemRank key = { gets[i].item, 0 };
+      std::vector<ItemRank>::const_iterator it =
+          std::lower_bound(ranks.begin(), ranks.end(), key);
+      get_ranks[i] = ((it != ranks.end()) && (it->item == gets[i].item))
+                     ? it->rank : kUnmatched;
+      if (lifo) {
+        const Event bound = { gets[i].time, ~0UL };
+        preceding_puts[i] =
+            std::upper_bound(puts.begin(), puts.end(), bound) - puts.begin();
+      }
+    }
+  });
+  std::vector<Event>().swap(puts);
+  std::vector<ItemRank>().swap(ranks);
+
+  FenwickTree removed(num_puts);
+  std::vector<uint64_t> distances;
+  distances.reserve(num_gets);
+  uint64_t unmatched = 0;
+  for (uint64_t i = 0; i < num_gets; i++) {
+    const uint64_t rank = get_ranks[i];
+    if (rank == kUnmatched) {
+      unmatched++;
+      continue;
+    }
+    uint64_t distance;
+    if (!lifo) {
+      distance = rank - removed.Count(rank);
+    } else {
+      const uint64_t upper = preceding_puts[i];
+      if (upper <= rank + 1) {
+        distance = 0;
+      } else {
+        distance = (upper - rank - 1) -
+                   (removed.Count(upper) - removed.Count(rank + 1));
+      }
+    }
+    distances.push_back(distance);
+    removed.Add(rank);
+  }
+
+  printf("{\"logs\": %" PRIu64 " ,\"operations\": %" PRIu64
+         " ,\"puts\": %" PRIu64 " ,\"gets\": %" PRIu64
+         " ,\"failed_gets\": %" PRIu64 " ,\"unmatched_gets\": %" PRIu64
+         " ,\"remaining\": %" PRIu64 " ,\"order\": \"%s\""
+         " ,\"timestamp\": \"%s\"",
+         num_logs, operations, num_puts, num_gets,
+         operations - num_puts - num_gets, unmatched,
+         num_puts - (num_gets - unmatched), FLAGS_order.c_str(),
+         FLAGS_timestamp.c_str());
+  PrintDistances(&distances);
+  printf("}\n");
+  return EXIT_SUCCESS;
+}
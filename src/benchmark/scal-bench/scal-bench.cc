@@ -0,0 +1,254 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Producer/consumer benchmark over several data structures in a single
+// process. Structures are taken from the registry (see ds_registry.h) and run
+// back to back on the same threads and thread-local memory.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include <gflags/gflags.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "benchmark/common.h"
+#include "benchmark/thread_placement.h"
+#include "benchmark/std_glue/ds_registry.h"
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/pool.h"
+#include "util/allocation.h"
+#include "util/ds_stats.h"
+#include "util/threadlocals.h"
+#include "util/scal-time.h"
+#include "util/workloads.h"
+
+DEFINE_string(ds, "", "comma separated list of data structures to run "
+                      "(empty: list the available ones)");
+DEFINE_string(prealloc_size, "1g", "tread local space that is initialized");
+DEFINE_uint64(producers, 1, "number of producers");
+DEFINE_uint64(consumers, 1, "number of consumers");
+DEFINE_uint64(operations, 1000, "number of operations per producer");
+DEFINE_uint64(c, 5000, "computational workload");
+DEFINE_bool(print_summary, true, "print execution summary");
+
+using scal::Benchmark;
+
+namespace {
+
+struct Result {
+  uint64_t runtime;
+  char* ds_stats;
+};
+
+
+std::vector<const scal::DsRegistry::Entry*> ParseDsList(
+    const std::string& list) {
+  std::vector<const scal::DsRegistry::Entry*> entries;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    const std::string name = list.substr(start, end - start);
+    const scal::DsRegistry::Entry* entry = scal::DsRegistry::Find(name);
+    if (entry == NULL) {
+      fprintf(stderr, "error: unknown data structure '%s', available: ",
+              name.c_str());
+      scal::DsRegistry::PrintNames(stderr);
+      fprintf(stderr, "\n");
+      exit(EXIT_FAILURE);
+    }
+    entries.push_back(entry);
+    start = end + 1;
+  }
+  return entries;
+}
+
+}  // namespace
+
+
+class ScalBench : public Benchmark {
+ public:
+  ScalBench(uint64_t num_threads,
+            uint64_t thread_prealloc_size,
+            const std::vector<const scal::DsRegistry::Entry*>& entries);
+
+  inline const std::vector<Result>& results() {
+    return results_;
+  }
+
+ protected:
+  void bench_func();
+
+ private:
+  // Returns true for the one thread that passed the barrier as serial thread.
+  bool Wait();
+  void producer(Pool<uint64_t>* ds);
+  void consumer(Pool<uint64_t>* ds);
+
+  std::vector<const scal::DsRegistry::Entry*> entries_;
+  std::vector<Result> results_;
+  Pool<uint64_t>* ds_;
+  uint64_t run_start_time_;
+  pthread_barrier_t run_barrier_;
+};
+
+
+uint64_t g_num_threads;
+
+int main(int argc, const char **argv) {
+  std::string usage("Producer/consumer micro benchmark over several data "
+                    "structures.");
+  google::SetUsageMessage(usage);
+  google::ParseCommandLineFlags(&argc, const_cast<char***>(&argv), true);
+
+  if (FLAGS_ds.empty()) {
+    scal::DsRegistry::PrintNames(stdout);
+    printf("\n");
+    return EXIT_SUCCESS;
+  }
+  std::vector<const scal::DsRegistry::Entry*> entries = ParseDsList(FLAGS_ds);
+
+  size_t tlsize = scal::HumanSizeToPages(
+      FLAGS_prealloc_size.c_str(), FLAGS_prealloc_size.size());
+
+  g_num_threads = FLAGS_producers + FLAGS_consumers;
+  scal::ThreadLocalAllocator::Get().Init(tlsize, true);
+  scal::ThreadContext::prepare(g_num_threads + 1);
+  scal::ThreadContext::assign_context();
+
+  ScalBench *benchmark = new ScalBench(g_num_threads, tlsize, entries);
+  benchmark->run();
+
+  if (FLAGS_print_summary) {
+    uint64_t num_operations;
+    if (FLAGS_consumers == 0) {
+      num_operations = FLAGS_operations * FLAGS_producers;
+    } else {
+      num_operations = FLAGS_operations * FLAGS_producers * 2;
+    }
+    printf("{\"threads\": %" PRIu64 " ,\"producers\": %" PRIu64
+           " ,\"consumers\": %" PRIu64 " ,\"operations\": %" PRIu64
+           " ,\"c\": %" PRIu64,
+           g_num_threads,
+           FLAGS_producers,
+           FLAGS_consumers,
+           FLAGS_operations,
+           FLAGS_c);
+    if (benchmark->placement() != NULL) {
+      benchmark->placement()->PrintJson(stdout);
+    }
+    scal::ThreadLocalAllocator::PrintMemoryJson(stdout);
+    scal::ThreadLocalAllocator::PrintArenaJson(stdout);
+    printf(" ,\"results\": [");
+    for (size_t i = 0; i < entries.size(); i++) {
+      const Result& result = benchmark->results()[i];
+      printf("%s{\"ds\": \"%s\" ,\"runtime\": %" PRIu64
+             " ,\"throughput\": %" PRIu64,
+             (i == 0) ? "" : ", ",
+             entries[i]->name,
+             result.runtime,
+             (uint64_t)(num_operations /
+                 (static_cast<double>(result.runtime) / 1000)));
+      if (result.ds_stats != NULL) {
+        printf(" %s", result.ds_stats);
+      }
+      printf("}");
+    }
+    printf("]}\n");
+  }
+  return EXIT_SUCCESS;
+}
+
+
+ScalBench::ScalBench(
+    uint64_t num_threads,
+    uint64_t thread_prealloc_size,
+    const std::vector<const scal::DsRegistry::Entry*>& entries)
+    : Benchmark(num_threads, thread_prealloc_size, NULL),
+      entries_(entries),
+      results_(entries.size()),
+      ds_(NULL),
+      run_start_time_(0) {
+  if (pthread_barrier_init(&run_barrier_, NULL, num_threads)) {
+    fprintf(stderr, "%s: error: Unable to init run barrier.\n", __func__);
+    abort();
+  }
+}
+
+
+bool ScalBench::Wait() {
+  int rc = pthread_barrier_wait(&run_barrier_);
+  if (rc != 0 && rc != PTHREAD_BARRIER_SERIAL_THREAD) {
+    fprintf(stderr, "%s: pthread_barrier_wait failed.\n", __func__);
+    abort();
+  }
+  return rc == PTHREAD_BARRIER_SERIAL_THREAD;
+}
+
+
+void ScalBench::producer(Pool<uint64_t>* ds) {
+  uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  uint64_t item;
+  // Do not use 0 as value, since there may be datastructures that do not
+  // support it.
+  for (uint64_t i = 1; i <= FLAGS_operations; i++) {
+    item = thread_id * FLAGS_operations + i;
+    if (!ds->put(item)) {
+      // We should always be able to insert an item.
+      fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+      abort();
+    }
+    scal::RdtscWait(FLAGS_c);
+  }
+}
+
+
+void ScalBench::consumer(Pool<uint64_t>* ds) {
+  const uint64_t operations =
+      FLAGS_producers * FLAGS_operations / FLAGS_consumers;
+  uint64_t j = 0;
+  uint64_t ret;
+  while (j < operations) {
+    const bool ok = ds->get(&ret);
+    scal::RdtscWait(FLAGS_c);
+    if (ok) {
+      j++;
+    }
+  }
+}
+
+
+void ScalBench::bench_func() {
+  // We need 0-based idx.
+  const uint64_t thread_idx = scal::ThreadContext::get().thread_id() - 1;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    // Structures of the previous run are dead at this point. Hand out their
+    // memory again and drop per-thread state they may have left behind.
+    scal::ThreadLocalAllocator::Get().Reset();
+    scal::ThreadContext::get().set_data(NULL);
+    if (Wait()) {
+      scal::DsStats::Reset();
+      ds_ = static_cast<Pool<uint64_t>*>(entries_[i]->ds_new());
+    }
+    if (Wait()) {
+      run_start_time_ = get_utime();
+    }
+    if (thread_idx < FLAGS_producers) {
+      producer(ds_);
+    } else {
+      consumer(ds_);
+    }
+    if (Wait()) {
+      results_[i].runtime = get_utime() - run_start_time_;
+      results_[i].ds_stats = entries_[i]->ds_get_stats();
+    }
+  }
+}
@@ -12,8 +12,14 @@
 #include <time.h>
 
 #include "benchmark/common.h"
+#include "benchmark/latency_histogram.h"
+#include "benchmark/perf_counters.h"
+#include "benchmark/thread_placement.h"
 #include "benchmark/std_glue/std_pipe_api.h"
+#include "benchmark/sweep.h"
+#include "benchmark/throughput_sampler.h"
 #include "datastructures/pool.h"
+#include "util/allocation.h"
 #include "util/malloc.h"
 #include "util/operation_logger.h"
 #include "util/random.h"
@@ -30,22 +36,47 @@ DEFINE_uint64(c, 5000, "computational workload");
 DEFINE_bool(print_summary, true, "print execution summary");
 DEFINE_bool(log_operations, false, "log invocation/response/linearization "
                                    "of all operations");
+DEFINE_string(log_file, "", "stream the operation log in binary form to "
+                            "<log_file>.<thread id> (see scal-analyze)");
 DEFINE_bool(allow_empty_returns, false, "does not stop the execution at an "
                                    "empty-dequeue");
+DEFINE_uint64(duration_ms, 0, "run for the given time instead of a fixed "
+                              "number of elements (0: disabled)");
+DEFINE_uint64(sample_interval_ms, 0, "report a throughput time series with "
+                                     "the given sample interval "
+                                     "(0: disabled)");
+DEFINE_bool(latency, false, "report put/get latency percentiles (only "
+                            "successful gets are recorded)");
+
+namespace {
+
+// Item ids in duration mode: thread id in the upper bits.
+const uint64_t kItemIdBits = 40;
+const uint64_t kItemIdMask = (1UL << kItemIdBits) - 1;
+
+}  // namespace
 
 class SeqAltBench : public scal::Benchmark {
  public:
   SeqAltBench(uint64_t num_threads,
                uint64_t thread_prealloc_size,
-               void *data)
+               void *data,
+               scal::ThroughputSampler* sampler,
+               scal::LatencyRecorder* latency)
                    : Benchmark(num_threads,
                                thread_prealloc_size,
-                               data) {
+                               data),
+                     sampler_(sampler),
+                     latency_(latency) {
   }
  protected:
   void bench_func(void);
 
  private:
+  void timed_bench_func(void);
+
+  scal::ThroughputSampler* sampler_;
+  scal::LatencyRecorder* latency_;
 };
 
 uint64_t g_num_threads;
@@ -54,6 +85,9 @@ int main(int argc, const char **argv) {
   std::string usage("SeqAlt micro benchmark.");
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, const_cast<char***>(&argv), true);
+  if (scal::Sweep::Requested()) {
+    return scal::Sweep::RunFromFlags("aggr");
+  }
 
   uint64_t tlsize = scal::human_size_to_pages(FLAGS_prealloc_size.c_str(),
                                               FLAGS_prealloc_size.size());
@@ -66,81 +100,185 @@ int main(int argc, const char **argv) {
   scal::ThreadContext::prepare(g_num_threads + 1);
   scal::ThreadContext::assign_context();
 
-  if (FLAGS_log_operations) {
+  if (!FLAGS_log_file.empty()) {
+    scal::StdOperationLogger::prepare_binary(g_num_threads + 1,
+                                             2 * FLAGS_elements,
+                                             FLAGS_log_file.c_str());
+  } else if (FLAGS_log_operations) {
     scal::StdOperationLogger::prepare(g_num_threads + 1,
                                       2 * FLAGS_elements);
   }
 
   void *ds = ds_new();
 
+  scal::ThroughputSampler sampler(
+      g_num_threads, FLAGS_sample_interval_ms, FLAGS_duration_ms);
+  scal::LatencyRecorder* latency = NULL;
+  if (FLAGS_latency) {
+    latency = new scal::LatencyRecorder(g_num_threads);
+  }
   SeqAltBench *benchmark = new SeqAltBench(
       g_num_threads,
       tlsize,
-      ds);
+      ds,
+      &sampler,
+      latency);
+  sampler.Start();
   benchmark->run();
+  sampler.Finish();
+  if (latency != NULL) {
+    latency->Merge();
+  }
 
-  if (FLAGS_log_operations) {
+  if (FLAGS_log_operations || !FLAGS_log_file.empty()) {
     scal::StdOperationLogger::print_summary();
   }
 
   if (FLAGS_print_summary) {
     uint64_t exec_time = benchmark->execution_time();
+    uint64_t num_operations;
+    uint64_t elements;
+    if (FLAGS_duration_ms > 0) {
+      num_operations = sampler.TotalOperations();
+      elements = num_operations / 2;
+    } else {
+      num_operations = FLAGS_elements * 2 * FLAGS_threads;
+      elements = FLAGS_elements;
+    }
     char buffer[1024] = {0};
     uint32_t n = snprintf(buffer, sizeof(buffer), "{\"threads\": %" PRIu64 " ,\"runtime\": %" PRIu64 " ,\"operations\": %" PRIu64 " ,\"c\": %" PRIu64 " ,\"aggr\": %" PRIu64 "",
         FLAGS_threads,
         exec_time,
-        FLAGS_elements,
+        elements,
         FLAGS_c,
-        (uint64_t)((FLAGS_elements * 2 * FLAGS_threads) / (static_cast<double>(exec_time) / 1000)));
+        (uint64_t)(num_operations / (static_cast<double>(exec_time) / 1000)));
     if (n != strlen(buffer)) {
       fprintf(stderr, "%s: error: failed to create summary string\n", __func__);
       abort();
     }
+    printf("%s", buffer);
     char *ds_stats = ds_get_stats();
     if (ds_stats != NULL) {
-      if (n + strlen(ds_stats) >= 1023) {  // separating space + '\0'
-        fprintf(stderr, "%s: error: strings too long\n", __func__);
-        abort();
-      }
-      strcat(buffer, " ");
-      strcat(buffer, ds_stats);
-      strcat(buffer, "}");
+      printf(" %s", ds_stats);
     }
-    printf("%s\n", buffer);
+    if (benchmark->placement() != NULL) {
+      benchmark->placement()->PrintJson(stdout);
+    }
+    scal::ThreadLocalAllocator::PrintMemoryJson(stdout);
+    scal::ThreadLocalAllocator::PrintArenaJson(stdout);
+    if (benchmark->perf_counters() != NULL) {
+      benchmark->perf_counters()->PrintJson(stdout, num_operations);
+    }
+    sampler.PrintJson(stdout);
+    if (latency != NULL) {
+      latency->PrintJson(stdout);
+    }
+    printf("}\n");
   }
   return EXIT_SUCCESS;
 }
 
 void SeqAltBench::bench_func(void) {
+  sampler_->Arm();
+  if (FLAGS_duration_ms > 0) {
+    timed_bench_func();
+    return;
+  }
 
+  const bool count = sampler_->active();
   Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
   uint64_t thread_id = scal::ThreadContext::get().thread_id();
   uint64_t item;
+  uint64_t start = 0;
   // Do not use 0 as value, since there may be datastructures that do not
   // support it.
   for (uint64_t i = 1; i <= FLAGS_elements + FLAGS_prefill - 1; i++) {
     if (i <= FLAGS_elements) {
       item = thread_id * FLAGS_elements + i;
       scal::StdOperationLogger::get().invoke(scal::LogType::kEnqueue);
+      if (latency_ != NULL) {
+        start = get_hwtime();
+      }
       if (!ds->put(item)) {
         // We should always be able to insert an item.
         fprintf(stderr, "%s: error: put operation failed.\n", __func__);
         abort();
       }
+      if (latency_ != NULL) {
+        latency_->RecordPut(thread_id, get_hwtime() - start);
+      }
       scal::StdOperationLogger::get().response(true, item);
+      if (count) {
+        sampler_->Count(thread_id);
+      }
       scal::RdtscWait(FLAGS_c);
     }
     
     if (i >= FLAGS_prefill) {
       scal::StdOperationLogger::get().invoke(scal::LogType::kDequeue);
+      if (latency_ != NULL) {
+        start = get_hwtime();
+      }
       if (!ds->get(&item)) {
         if (!FLAGS_allow_empty_returns) {
           // We should always be able to get an item.
           fprintf(stderr, "%s: error: get operation failed.\n", __func__);
           abort();
         }
+      } else if (latency_ != NULL) {
+        latency_->RecordGet(thread_id, get_hwtime() - start);
       }
       scal::StdOperationLogger::get().response(true, item);
+      if (count) {
+        sampler_->Count(thread_id);
+      }
+      scal::RdtscWait(FLAGS_c);
+    }
+  }
+}
+
+
+// Same alternating pattern as bench_func, but without a bound on the number of
+// elements. Only successful operations are counted.
+void SeqAltBench::timed_bench_func(void) {
+  Pool<uint64_t> *ds = static_cast<Pool<uint64_t>*>(data_);
+  uint64_t thread_id = scal::ThreadContext::get().thread_id();
+  uint64_t item;
+  uint64_t start = 0;
+  for (uint64_t i = 1; !sampler_->stopped(); i++) {
+    item = (thread_id << kItemIdBits) | (i & kItemIdMask);
+    scal::StdOperationLogger::get().invoke(scal::LogType::kEnqueue);
+    if (latency_ != NULL) {
+      start = get_hwtime();
+    }
+    if (!ds->put(item)) {
+      fprintf(stderr, "%s: error: put operation failed.\n", __func__);
+      abort();
+    }
+    if (latency_ != NULL) {
+      latency_->RecordPut(thread_id, get_hwtime() - start);
+    }
+    scal::StdOperationLogger::get().response(true, item);
+    sampler_->Count(thread_id);
+    scal::RdtscWait(FLAGS_c);
+
+    if (i >= FLAGS_prefill) {
+      scal::StdOperationLogger::get().invoke(scal::LogType::kDequeue);
+      if (latency_ != NULL) {
+        start = get_hwtime();
+      }
+      const bool ok = ds->get(&item);
+      if (ok && (latency_ != NULL)) {
+        latency_->RecordGet(thread_id, get_hwtime() - start);
+      }
+      if (!ok && !FLAGS_allow_empty_returns) {
+        fprintf(stderr, "%s: error: get operation failed.\n", __func__);
+        abort();
+      }
+      scal::StdOperationLogger::get().response(ok, item);
+      if (ok) {
+        sampler_->Count(thread_id);
+      }
       scal::RdtscWait(FLAGS_c);
     }
   }
@@ -0,0 +1,66 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include "benchmark/std_glue/ds_registry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+bool CompareNames(const scal::DsRegistry::Entry& a,
+                  const scal::DsRegistry::Entry& b) {
+  return strcmp(a.name, b.name) < 0;
+}
+
+}  // namespace
+
+namespace scal {
+
+std::vector<DsRegistry::Entry>& DsRegistry::entries() {
+  static std::vector<Entry> entries;
+  return entries;
+}
+
+
+bool DsRegistry::Register(const char* name,
+                          DsNewFunc ds_new,
+                          DsGetStatsFunc ds_get_stats) {
+  if (Find(name) != NULL) {
+    fprintf(stderr, "%s: error: data structure '%s' registered twice\n",
+            __func__, name);
+    abort();
+  }
+  Entry entry;
+  entry.name = name;
+  entry.ds_new = ds_new;
+  entry.ds_get_stats = ds_get_stats;
+  entries().push_back(entry);
+  return true;
+}
+
+
+const DsRegistry::Entry* DsRegistry::Find(const std::string& name) {
+  std::vector<Entry>& all = entries();
+  for (size_t i = 0; i < all.size(); i++) {
+    if (name == all[i].name) {
+      return &all[i];
+    }
+  }
+  return NULL;
+}
+
+
+void DsRegistry::PrintNames(FILE* fp) {
+  std::vector<Entry> sorted = entries();
+  std::sort(sorted.begin(), sorted.end(), CompareNames);
+  for (size_t i = 0; i < sorted.size(); i++) {
+    fprintf(fp, "%s%s", (i == 0) ? "" : ",", sorted[i].name);
+  }
+}
+
+}  // namespace scal
@@ -0,0 +1,48 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_STD_GLUE_DS_REGISTRY_H_
+#define SCAL_BENCHMARK_STD_GLUE_DS_REGISTRY_H_
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace scal {
+
+typedef void* (*DsNewFunc)(void);
+typedef char* (*DsGetStatsFunc)(void);
+
+// Named data structure factories, registered by glue files at static
+// initialization time (see REGISTER_DS in std_pipe_api.h).
+class DsRegistry {
+ public:
+  struct Entry {
+    const char* name;
+    DsNewFunc ds_new;
+    DsGetStatsFunc ds_get_stats;
+  };
+
+  // Always returns true, which allows to call it from a static initializer.
+  static bool Register(const char* name,
+                       DsNewFunc ds_new,
+                       DsGetStatsFunc ds_get_stats);
+
+  // Returns NULL for unknown names.
+  static const Entry* Find(const std::string& name);
+
+  // Prints the names of all registered data structures, sorted and separated
+  // by commas.
+  static void PrintNames(FILE* fp);
+
+ private:
+  // Function-local static to not depend on the order of static
+  // initialization across translation units.
+  static std::vector<Entry>& entries();
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_STD_GLUE_DS_REGISTRY_H_
@@ -7,16 +7,22 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/boundedsize_kfifo.h"
 
-DEFINE_uint64(k, 80, "k-segment size");
+GLUE_DEFINE_uint64(k, 80, "k-segment size");
 DEFINE_uint64(num_segments, 100000, "number of k-segments in the "
                                      "bounded-size version");
 
-void* ds_new() {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::BoundedSizeKFifo<uint64_t>(FLAGS_k, FLAGS_num_segments));
 }
 
 
-char* ds_get_stats(void) {
-  return NULL;
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("bs-kfifo", DsNew, DsGetStats);
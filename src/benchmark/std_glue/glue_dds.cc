@@ -9,19 +9,25 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/distributed_data_structure.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
 
 #define T uint64_t
 
 #if   defined(BACKEND_MS_QUEUE)
 
 #include "datastructures/ms_queue.h"
+#include "datastructures/spmc_queue.h"
 #define BACKEND() scal::MSQueue<uint64_t>
+#define SPMC_BACKEND() scal::SpmcQueue<uint64_t>
+#define BACKEND_NAME "ms"
 
 #elif defined(BACKEND_TREIBER)
 
+#include "datastructures/spmc_stack.h"
 #include "datastructures/treiber_stack.h"
 #define BACKEND() scal::TreiberStack<uint64_t>
+#define SPMC_BACKEND() scal::SpmcStack<uint64_t>
+#define BACKEND_NAME "treiber"
 
 #else
 
@@ -32,16 +38,20 @@ DEFINE_uint64(p, 80, "number of partial queues");
 #if   defined(BALANCER_1RANDOM)
 
 #include "datastructures/balancer_1random.h"
-DEFINE_bool(hw_random, false, "use hardware random generator instead "
-                              "of pseudo");
+GLUE_DEFINE_bool(hw_random, false, "use hardware random generator instead "
+                                   "of pseudo");
 #define GENERATE_BALANCER() (new scal::Balancer1Random(FLAGS_hw_random))
 #define BALANCER_T() scal::Balancer1Random
+#define BALANCER_NAME "dds-1random-"
 
 #elif defined(BALANCER_LL)
 
 #include "datastructures/balancer_local_linearizability.h"
+GLUE_DEFINE_bool(spmc, true, "use single-producer backends if every backend "
+                             "has a single producer");
 #define GENERATE_BALANCER() (new scal::BalancerLocalLinearizability(FLAGS_p))
 #define BALANCER_T() scal::BalancerLocalLinearizability
+#define BALANCER_NAME "ll-dds-"
 
 #else
 
@@ -49,11 +59,30 @@ DEFINE_bool(hw_random, false, "use hardware random generator instead "
 
 #endif  // BALANCER_*
 
-void* ds_new() {
+#ifdef NON_LINEARIZABLE_EMPTY
+#define EMPTY_NAME "-nonlinempty"
+#else
+#define EMPTY_NAME ""
+#endif  // NON_LINEARIZABLE_EMPTY
+
+namespace {
+
+void* DsNew() {
+#ifdef BALANCER_LL
+  if (FLAGS_spmc) {
+    return static_cast<void*>(
+        scal::NewDistributedDataStructure<T, BACKEND(), SPMC_BACKEND() >(
+            FLAGS_p, g_num_threads + 1, GENERATE_BALANCER()));
+  }
+#endif  // BALANCER_LL
   return static_cast<void*>(
       new scal::DistributedDataStructure<T, BACKEND(), BALANCER_T() >(
           FLAGS_p, g_num_threads + 1, GENERATE_BALANCER()));
 }
 
 
-char* ds_get_stats() { return NULL; }
+char* DsGetStats() { return scal::DsStats::ds_get_stats(); }
+
+}  // namespace
+
+REGISTER_DS(BALANCER_NAME BACKEND_NAME EMPTY_NAME, DsNew, DsGetStats);
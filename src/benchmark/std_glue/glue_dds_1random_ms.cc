@@ -13,12 +13,13 @@
 #include "datastructures/distributed_data_structure.h"
 #include "datastructures/ms_queue.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
-DEFINE_bool(hw_random, false, "use hardware random generator instead "
-                              "of pseudo");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_bool(hw_random, false, "use hardware random generator instead "
+                                   "of pseudo");
 
+namespace {
 
-void* ds_new(void) {
+void* DsNew() {
   return static_cast<void*>(
       new scal::DistributedDataStructure<uint64_t, scal::MSQueue<uint64_t>, scal::Balancer1Random>(
           FLAGS_p,
@@ -27,7 +28,7 @@ void* ds_new(void) {
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   char buffer[255] = { 0 };
   uint32_t n = snprintf(buffer,
                         sizeof(buffer),
@@ -42,3 +43,7 @@ char* ds_get_stats(void) {
       strlen(buffer) + 1, sizeof(*newbuf)));
   return strncpy(newbuf, buffer, strlen(buffer));
 }
+
+}  // namespace
+
+REGISTER_DS("dds-1random-ms", DsNew, DsGetStats);
@@ -11,11 +11,13 @@
 #include "datastructures/distributed_data_structure.h"
 #include "datastructures/treiber_stack.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
-DEFINE_bool(hw_random, false, "use hardware random generator instead "
-                              "of pseudo");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_bool(hw_random, false, "use hardware random generator instead "
+                                   "of pseudo");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
 	return static_cast<void*>
       new scal::DistributedDataStructure<uint64_t, scal::TreiberStack<uint64_t, scal::Balancer1Random> >(
           FLAGS_p, 
@@ -23,6 +25,10 @@ void* ds_new(void) {
           new scal::Balancer1Random(FLAGS_hw_random));
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("dds-1random-tstack", DsNew, DsGetStats);
@@ -16,9 +16,11 @@
 #include "datastructures/treiber_stack.h"
 #include "util/malloc.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>
       new scal::DistributedDataStructure<uint64_t, scal::TreiberStack<uint64_t>, scal::BalancerId>(
           FLAGS_p,
@@ -26,6 +28,10 @@ void* ds_new(void) {
           new scal::BalancerId());
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("dds-id-tstack", DsNew, DsGetStats);
@@ -13,10 +13,12 @@
 #include "datastructures/distributed_data_structure.h"
 #include "datastructures/ms_queue.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
-DEFINE_uint64(partitions, 1, "number of round robin partitions");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(partitions, 1, "number of round robin partitions");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::DistributedDataStructure<uint64_t, scal::MSQueue<uint64_t>, scal::BalancerPartitionedRoundRobin>(
           FLAGS_p,
@@ -24,7 +26,7 @@ void* ds_new(void) {
           new scal::BalancerPartitionedRoundRobin(FLAGS_partitions, FLAGS_p)));
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   char buffer[255] = { 0 };
   uint32_t n = snprintf(buffer,
                         sizeof(buffer),
@@ -39,3 +41,7 @@ char* ds_get_stats(void) {
       strlen(buffer) + 1, sizeof(*newbuf)));
   return strncpy(newbuf, buffer, strlen(buffer));
 }
+
+}  // namespace
+
+REGISTER_DS("dds-partrr-ms", DsNew, DsGetStats);
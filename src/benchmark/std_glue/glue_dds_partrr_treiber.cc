@@ -13,10 +13,12 @@
 #include "datastructures/distributed_data_structure.h"
 #include "datastructures/treiber_stack.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
-DEFINE_uint64(partitions, 1, "number of round robin partitions");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(partitions, 1, "number of round robin partitions");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::DistributedDataStructure<uint64_t, scal::TreiberStack<uint64_t>, scal::BalancerPartitionedRoundRobin>(
           FLAGS_p,
@@ -24,6 +26,10 @@ void* ds_new(void) {
           new scal::BalancerPartitionedRoundRobin(FLAGS_partitions, FLAGS_p)));
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("dds-partrr-treiber", DsNew, DsGetStats);
@@ -10,15 +10,24 @@
 
 #define T uint64_t
 
+GLUE_DEFINE_bool(spmc, true, "use single-producer backends if every backend "
+                             "has a single producer");
+
 #if   defined(BACKEND_MS_QUEUE)
 
 #include "datastructures/ms_queue.h"
+#include "datastructures/spmc_queue.h"
 #define BACKEND() scal::MSQueue<uint64_t>
+#define SPMC_BACKEND() scal::SpmcQueue<uint64_t>
+#define BACKEND_NAME "ms"
 
 #elif defined(BACKEND_TREIBER)
 
+#include "datastructures/spmc_stack.h"
 #include "datastructures/treiber_stack.h"
 #define BACKEND() scal::TreiberStack<uint64_t>
+#define SPMC_BACKEND() scal::SpmcStack<uint64_t>
+#define BACKEND_NAME "treiber"
 
 #else
 
@@ -26,10 +35,27 @@
 
 #endif  // BACKEND_*
 
-void* ds_new() {
+#ifdef NON_LINEARIZABLE_EMPTY
+#define EMPTY_NAME "-nonlinempty"
+#else
+#define EMPTY_NAME ""
+#endif  // NON_LINEARIZABLE_EMPTY
+
+namespace {
+
+void* DsNew() {
+  // Every thread puts into its own backend.
+  if (FLAGS_spmc) {
+    return static_cast<void*>(
+        new scal::DynamicDistributedDataStructure<T, SPMC_BACKEND() >(1024));
+  }
   return static_cast<void*>(
       new scal::DynamicDistributedDataStructure<T, BACKEND() >(1024));
 }
 
 
-char* ds_get_stats() { return NULL; }
+char* DsGetStats() { return scal::DsStats::ds_get_stats(); }
+
+}  // namespace
+
+REGISTER_DS("ll-dyn-dds-" BACKEND_NAME EMPTY_NAME, DsNew, DsGetStats);
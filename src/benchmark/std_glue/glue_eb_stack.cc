@@ -10,12 +10,13 @@
 #include "datastructures/elimination_backoff_stack.h"
 
 DEFINE_uint64(collision, 0, "size of the collision array");
-DEFINE_uint64(delay, 15000, "time waiting in the collision array");
+GLUE_DEFINE_uint64(delay, 15000, "time waiting in the collision array");
 
+namespace {
 
 scal::EliminationBackoffStack<uint64_t> *ebs;
 
-void* ds_new() {
+void* DsNew() {
   uint64_t size_collision = (g_num_threads + 1)/10;
   if (FLAGS_collision != 0) {
     size_collision = FLAGS_collision;
@@ -29,6 +30,10 @@ void* ds_new() {
   return static_cast<void*>(ebs);
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return ebs->ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("eb-stack", DsNew, DsGetStats);
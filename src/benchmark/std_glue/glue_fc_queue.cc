@@ -9,12 +9,18 @@
 
 DEFINE_uint64(array_size, 100, "operations array size");
 
-void* ds_new() {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::FlatCombiningQueue<uint64_t>(FLAGS_array_size));
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("fc", DsNew, DsGetStats);
@@ -0,0 +1,21 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Flags shared by several glue files, only used in builds that define
+// SCAL_DS_REGISTRY. Single data structure builds define them in the glue file
+// itself (see GLUE_DEFINE_* in std_pipe_api.h).
+
+#include <gflags/gflags.h>
+
+DEFINE_uint64(delay, 0, "delay in the insert operation; eb-stack uses it as "
+                        "time waiting in the collision array");
+DEFINE_bool(hw_random, false, "use hardware random generator instead "
+                              "of pseudo");
+DEFINE_uint64(k, 80, "k-segment size");
+DEFINE_uint64(max_retries, 10, "maximum number of retries");
+DEFINE_uint64(p, 80, "number of partial queues");
+DEFINE_uint64(partitions, 1, "number of round robin partitions");
+DEFINE_uint64(quasi_factor, 80, "random dequeue quasi factor");
+DEFINE_bool(spmc, true, "use single-producer backends if every backend has a "
+                        "single producer");
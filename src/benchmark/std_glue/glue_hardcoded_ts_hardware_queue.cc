@@ -9,17 +9,23 @@
 #include "datastructures/ts_queue_buffer.h"
 #include "datastructures/ts_queue.h"
 
-DEFINE_uint64(delay, 0, "delay in the insert operation");
+GLUE_DEFINE_uint64(delay, 0, "delay in the insert operation");
 
 #define TS_DS TSQueue<uint64_t, TSQueueBuffer<uint64_t, HardwareTimestamp>, HardwareTimestamp>
 
+namespace {
+
 TS_DS *ts_;
 
-void* ds_new() {
+void* DsNew() {
   ts_ = new TS_DS(g_num_threads + 1, FLAGS_delay);
   return static_cast<void*>(ts_);
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return ts_->ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("hc-ts-hardware-queue", DsNew, DsGetStats);
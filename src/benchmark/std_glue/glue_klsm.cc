@@ -0,0 +1,26 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include <gflags/gflags.h>
+
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/klsm.h"
+
+GLUE_DEFINE_uint64(k, 80, "k-segment size");
+
+namespace {
+
+void* DsNew() {
+  return static_cast<void*>(
+      new scal::KLsm<uint64_t>(FLAGS_k, g_num_threads + 1));
+}
+
+
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
+}
+
+}  // namespace
+
+REGISTER_DS("klsm", DsNew, DsGetStats);
@@ -8,14 +8,20 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/kstack.h"
 
-DEFINE_uint64(k, 80, "k-segment size");
+GLUE_DEFINE_uint64(k, 80, "k-segment size");
 
-void* ds_new() {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::KStack<uint64_t>(FLAGS_k, g_num_threads + 1));
 }
 
 
-char* ds_get_stats(void) {
-  return NULL;
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("kstack", DsNew, DsGetStats);
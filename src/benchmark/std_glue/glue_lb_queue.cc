@@ -11,12 +11,18 @@ DEFINE_uint64(dequeue_mode, 0, "different APIs for empty dequeue: "
                                "non-blocking (0), blocking (1), timeout (2)");
 DEFINE_uint64(dequeue_timeout, 100, "dequeue timeout in ms");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   LockBasedQueue<uint64_t> *lbq =
       new LockBasedQueue<uint64_t>(FLAGS_dequeue_mode, FLAGS_dequeue_timeout);
   return static_cast<void*>(lbq);
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("lb-queue", DsNew, DsGetStats);
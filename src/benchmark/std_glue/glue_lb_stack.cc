@@ -7,11 +7,17 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/lockbased_stack.h"
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(new scal::LockBasedStack<uint64_t>());
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("lb-stack", DsNew, DsGetStats);
@@ -7,12 +7,17 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/lcrq.h"
 
+namespace {
 
-void* ds_new(void) {
+void* DsNew() {
   return static_cast<void*>(new scal::LCRQ<uint64_t>());
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("lcrq", DsNew, DsGetStats);
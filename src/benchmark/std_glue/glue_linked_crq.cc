@@ -0,0 +1,26 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include <gflags/gflags.h>
+
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/linked_crq.h"
+
+DEFINE_uint64(ring_pow, 12, "rings of the linked CRQ have 2^ring_pow cells "
+                            "(upstream LCRQ: 17)");
+
+namespace {
+
+void* DsNew() {
+  return static_cast<void*>(new scal::LinkedCRQ<uint64_t>(FLAGS_ring_pow));
+}
+
+
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
+}
+
+}  // namespace
+
+REGISTER_DS("linked-crq", DsNew, DsGetStats);
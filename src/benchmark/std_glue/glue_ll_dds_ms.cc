@@ -14,17 +14,33 @@
 #include "datastructures/balancer_local_linearizability.h"
 #include "datastructures/distributed_data_structure.h"
 #include "datastructures/ms_queue.h"
+#include "datastructures/spmc_queue.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_bool(spmc, true, "use single-producer backends if every backend "
+                             "has a single producer");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
+  scal::BalancerLocalLinearizability* balancer =
+      new scal::BalancerLocalLinearizability(FLAGS_p);
+  if (FLAGS_spmc) {
+    return static_cast<void*>(scal::NewDistributedDataStructure<
+        uint64_t, scal::MSQueue<uint64_t>, scal::SpmcQueue<uint64_t> >(
+            FLAGS_p, g_num_threads + 1, balancer));
+  }
   return static_cast<void*>(
       new scal::DistributedDataStructure
-        <uint64_t, scal::MSQueue<uint64_t>, 
+        <uint64_t, scal::MSQueue<uint64_t>,
         scal::BalancerLocalLinearizability>(
           FLAGS_p,
           g_num_threads + 1,
-          new scal::BalancerLocalLinearizability(FLAGS_p)));
+          balancer));
 }
 
-char* ds_get_stats(void) { return NULL; }
+char* DsGetStats() { return scal::DsStats::ds_get_stats(); }
+
+}  // namespace
+
+REGISTER_DS("ll-dds-ms", DsNew, DsGetStats);
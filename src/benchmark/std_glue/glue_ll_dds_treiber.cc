@@ -11,18 +11,31 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/balancer_local_linearizability.h"
 #include "datastructures/distributed_data_structure.h"
+#include "datastructures/spmc_stack.h"
 #include "datastructures/treiber_stack.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_bool(spmc, true, "use single-producer backends if every backend "
+                             "has a single producer");
 
+namespace {
 
-void* ds_new(void) {
+void* DsNew() {
+  scal::BalancerLocalLinearizability* balancer =
+      new scal::BalancerLocalLinearizability(FLAGS_p);
+  if (FLAGS_spmc) {
+    return static_cast<void*>(scal::NewDistributedDataStructure<
+        uint64_t, scal::TreiberStack<uint64_t>, scal::SpmcStack<uint64_t> >(
+            FLAGS_p, g_num_threads + 1, balancer));
+  }
   return static_cast<void*>(
       new scal::DistributedDataStructure<uint64_t, scal::TreiberStack<uint64_t>, scal::BalancerLocalLinearizability>(
-          FLAGS_p,
-          g_num_threads + 1,
-          new scal::BalancerLocalLinearizability(FLAGS_p)));
+          FLAGS_p, g_num_threads + 1, balancer));
 }
 
 
-char* ds_get_stats(void) { return NULL; }
+char* DsGetStats() { return scal::DsStats::ds_get_stats(); }
+
+}  // namespace
+
+REGISTER_DS("ll-dds-treiber", DsNew, DsGetStats);
@@ -4,16 +4,35 @@
 
 #define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
 
+#include <gflags/gflags.h>
+
+#include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/dyn_distributed_data_structure.h"
 #include "datastructures/ms_queue.h"
+#include "datastructures/spmc_queue.h"
+
+GLUE_DEFINE_bool(spmc, true, "use single-producer backends if every backend "
+                             "has a single producer");
+
+namespace {
 
-void* ds_new() {
+void* DsNew() {
+  // Every thread puts into its own backend.
+  if (FLAGS_spmc) {
     return static_cast<void*>(
-        new scal::DynamicDistributedDataStructure<uint64_t, scal::MSQueue<uint64_t>>(
+        new scal::DynamicDistributedDataStructure<uint64_t, scal::SpmcQueue<uint64_t>>(
             1024));
+  }
+  return static_cast<void*>(
+      new scal::DynamicDistributedDataStructure<uint64_t, scal::MSQueue<uint64_t>>(
+          1024));
 }
 
 
-char* ds_get_stats(void) {
-  return NULL;
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("ll-dyn-dds-ms", DsNew, DsGetStats);
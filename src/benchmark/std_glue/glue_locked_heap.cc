@@ -0,0 +1,22 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/locked_heap.h"
+#include "util/ds_stats.h"
+
+namespace {
+
+void* DsNew() {
+  return static_cast<void*>(new scal::LockedHeap<uint64_t>());
+}
+
+
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
+}
+
+}  // namespace
+
+REGISTER_DS("locked-heap", DsNew, DsGetStats);
@@ -10,15 +10,20 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/lru_distributed_stack.h"
 
-DEFINE_uint64(p, 80, "number of partial queues");
+GLUE_DEFINE_uint64(p, 80, "number of partial queues");
 
+namespace {
 
-void* ds_new(void) {
+void* DsNew() {
   return static_cast<void*>(
       new scal::LRUDistributedStack<uint64_t>(FLAGS_p));
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("lru-dds-treiber-stack", DsNew, DsGetStats);
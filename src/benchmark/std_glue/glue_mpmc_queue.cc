@@ -0,0 +1,27 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include <gflags/gflags.h>
+
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/bounded_mpmc_queue.h"
+
+DEFINE_uint64(capacity, 1 << 20, "number of slots of the bounded queue "
+                                 "(rounded up to a power of two)");
+
+namespace {
+
+void* DsNew() {
+  return static_cast<void*>(
+      new scal::BoundedMpmcQueue<uint64_t>(FLAGS_capacity));
+}
+
+
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
+}
+
+}  // namespace
+
+REGISTER_DS("mpmc-queue", DsNew, DsGetStats);
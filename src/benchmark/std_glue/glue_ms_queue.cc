@@ -7,11 +7,17 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/ms_queue.h"
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(new scal::MSQueue<uint64_t>());
 }
 
 
-char* ds_get_stats(void) {
-  return NULL;
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("ms", DsNew, DsGetStats);
@@ -0,0 +1,26 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include <gflags/gflags.h>
+
+#include "benchmark/std_glue/std_pipe_api.h"
+#include "datastructures/multiqueue.h"
+
+DEFINE_uint64(mq_c, 2, "heaps per thread of the MultiQueue");
+
+namespace {
+
+void* DsNew() {
+  return static_cast<void*>(
+      new scal::MultiQueue<uint64_t>(FLAGS_mq_c * g_num_threads));
+}
+
+
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
+}
+
+}  // namespace
+
+REGISTER_DS("multiqueue", DsNew, DsGetStats);
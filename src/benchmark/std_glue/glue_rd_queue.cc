@@ -7,16 +7,22 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/random_dequeue_queue.h"
 
-DEFINE_uint64(quasi_factor, 80, "random dequeue quasi factor");
-DEFINE_uint64(max_retries, 10, "number of retries in dequeue");
+GLUE_DEFINE_uint64(quasi_factor, 80, "random dequeue quasi factor");
+GLUE_DEFINE_uint64(max_retries, 10, "number of retries in dequeue");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::RandomDequeueQueue<uint64_t>(
           FLAGS_quasi_factor, FLAGS_max_retries));
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("rd", DsNew, DsGetStats);
@@ -9,15 +9,21 @@
 
 #define TS_DS RTSQueue<uint64_t>
 
+namespace {
+
 TS_DS *ts_;
 
-void* ds_new() {
+void* DsNew() {
   ts_ = new TS_DS();
   ts_->initialize(g_num_threads + 1);
 
   return static_cast<void*>(ts_);
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return ts_->ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("rts-queue", DsNew, DsGetStats);
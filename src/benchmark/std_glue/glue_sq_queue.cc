@@ -7,14 +7,20 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/segment_queue.h"
 
-DEFINE_uint64(quasi_factor, 80, "random dequeue quasi factor");
+GLUE_DEFINE_uint64(quasi_factor, 80, "random dequeue quasi factor");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
       new scal::SegmentQueue<uint64_t>(FLAGS_quasi_factor));
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("sq", DsNew, DsGetStats);
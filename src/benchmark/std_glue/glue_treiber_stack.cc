@@ -7,11 +7,17 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/treiber_stack.h"
 
-void* ds_new() {
+namespace {
+
+void* DsNew() {
   scal::TreiberStack<uint64_t> *ts = new scal::TreiberStack<uint64_t>();
   return static_cast<void*>(ts);
 }
 
-char* ds_get_stats(void) {
-  return NULL;
+char* DsGetStats() {
+  return scal::DsStats::ds_get_stats();
 }
+
+}  // namespace
+
+REGISTER_DS("treiber", DsNew, DsGetStats);
@@ -8,13 +8,25 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/unboundedsize_kfifo.h"
 
-DEFINE_uint64(k, 80, "k-segment size");
+GLUE_DEFINE_uint64(k, 80, "k-segment size");
 
-void* ds_new() {
+#ifdef LOCALLY_LINEARIZABLE
+#define DS_NAME "ll-us-kfifo"
+#else
+#define DS_NAME "us-kfifo"
+#endif  // LOCALLY_LINEARIZABLE
+
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(new scal::UnboundedSizeKFifo<uint64_t>(FLAGS_k));
 }
 
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS(DS_NAME, DsNew, DsGetStats);
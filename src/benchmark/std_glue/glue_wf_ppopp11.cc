@@ -7,12 +7,18 @@
 #include "benchmark/std_glue/std_pipe_api.h"
 #include "datastructures/wf_queue_ppopp11.h"
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   // Main thread may also need the queue.
   WaitfreeQueue<uint64_t> *wfq = new WaitfreeQueue<uint64_t>(g_num_threads + 1);
   return static_cast<void*>(wfq);
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("wf-ppopp11", DsNew, DsGetStats);
@@ -8,10 +8,13 @@
 //#include "datastructures/wf_queue_ppopp12.h"
 #include "datastructures/wf_queue_ppopp12_new.h"
 
-DEFINE_uint64(max_retries, 10, "maximum number of retries in the fast path");
+GLUE_DEFINE_uint64(max_retries, 10, "maximum number of retries in the fast "
+                                        "path");
 DEFINE_uint64(helping_delay, 10, "number of iterations helping is derfered");
 
-void* ds_new(void) {
+namespace {
+
+void* DsNew() {
   return static_cast<void*>(
     new scal::WaitfreeQueue<uint64_t>(
       g_num_threads + 1,
@@ -19,6 +22,10 @@ void* ds_new(void) {
       FLAGS_helping_delay));
 }
 
-char* ds_get_stats(void) {
+char* DsGetStats() {
   return NULL;
 }
+
+}  // namespace
+
+REGISTER_DS("wf-queue", DsNew, DsGetStats);
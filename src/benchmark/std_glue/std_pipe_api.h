@@ -5,8 +5,11 @@
 #ifndef SCAL_BENCHMARK_STD_PIPE_API_H_
 #define SCAL_BENCHMARK_STD_PIPE_API_H_
 
+#include <gflags/gflags.h>
 #include <inttypes.h>
 
+#include "benchmark/std_glue/ds_registry.h"
+
 extern uint64_t g_num_threads;
 
 extern void* ds_new(void);
@@ -14,4 +17,32 @@ extern bool ds_put(void *ds, uint64_t val);
 extern bool ds_get(void *ds, uint64_t *val);
 extern char* ds_get_stats(void);
 
+// Every glue file provides a factory and a stats function for its data
+// structure and hands them to REGISTER_DS. Single data structure builds get
+// them as ds_new() and ds_get_stats(). Builds defining SCAL_DS_REGISTRY link
+// several glue files into one binary and instead register them by name.
+//
+// Flags that are used by more than one glue file are defined through
+// GLUE_DEFINE_* and live in glue_flags.cc in registry builds.
+#ifdef SCAL_DS_REGISTRY
+
+#define REGISTER_DS(name, new_func, stats_func)                                \
+  static const bool ds_registered_ =                                           \
+      scal::DsRegistry::Register(name, new_func, stats_func)
+
+#define GLUE_DEFINE_bool(name, val, txt) DECLARE_bool(name)
+#define GLUE_DEFINE_uint64(name, val, txt) DECLARE_uint64(name)
+
+#else  // !SCAL_DS_REGISTRY
+
+#define REGISTER_DS(name, new_func, stats_func)                                \
+  void* ds_new(void) { return new_func(); }                                    \
+  char* ds_get_stats(void) { return stats_func(); }                            \
+  extern char* ds_get_stats(void)
+
+#define GLUE_DEFINE_bool(name, val, txt) DEFINE_bool(name, val, txt)
+#define GLUE_DEFINE_uint64(name, val, txt) DEFINE_uint64(name, val, txt)
+
+#endif  // SCAL_DS_REGISTRY
+
 #endif  // SCAL_BENCHMARK_STD_PIPE_API_H_
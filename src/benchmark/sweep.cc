@@ -0,0 +1,383 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include "benchmark/sweep.h"
+
+#include <gflags/gflags.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+DEFINE_string(sweep, "", "run the benchmark over a cartesian product of flag "
+                         "values, e.g. \"producers+consumers=1..64:x2, "
+                         "c=0,500,5000\"");
+DEFINE_uint64(sweep_reps, 5, "recorded repetitions per sweep point");
+DEFINE_uint64(sweep_warmup, 1, "unrecorded warmup runs per sweep point");
+DEFINE_string(sweep_metric, "", "summary value reported by a sweep (default: "
+                                "the benchmark's throughput)");
+
+namespace {
+
+const char kSweepFlag[] = "sweep";
+
+// Two-sided 95% quantiles of Student's t-distribution for 1 to 30 degrees of
+// freedom. Larger samples use the normal distribution.
+const double kT95[] = {
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+const double kZ95 = 1.960;
+
+
+std::string Trim(const std::string& s) {
+  const size_t start = s.find_first_not_of(" \t");
+  if (start == std::string::npos) {
+    return "";
+  }
+  const size_t end = s.find_last_not_of(" \t");
+  return s.substr(start, end - start + 1);
+}
+
+
+std::vector<std::string> Split(const std::string& s, char delim) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (true) {
+    const size_t end = s.find(delim, start);
+    if (end == std::string::npos) {
+      parts.push_back(Trim(s.substr(start)));
+      return parts;
+    }
+    parts.push_back(Trim(s.substr(start, end - start)));
+    start = end + 1;
+  }
+}
+
+
+bool ParseUint64(const std::string& s, uint64_t* value) {
+  if (s.empty()) {
+    return false;
+  }
+  char* end;
+  *value = strtoull(s.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+
+// Expands a value token, which is either a plain value or a range.
+bool ExpandValue(const std::string& token, std::vector<std::string>* values) {
+  const size_t dots = token.find("..");
+  if (dots == std::string::npos) {
+    if (token.empty()) {
+      return false;
+    }
+    values->push_back(token);
+    return true;
+  }
+  std::string to = token.substr(dots + 2);
+  std::string step = "1";
+  const size_t colon = to.find(':');
+  if (colon != std::string::npos) {
+    step = to.substr(colon + 1);
+    to = to.substr(0, colon);
+  }
+  bool geometric = false;
+  if (!step.empty() && ((step[0] == 'x') || (step[0] == '+'))) {
+    geometric = step[0] == 'x';
+    step = step.substr(1);
+  }
+  uint64_t a;
+  uint64_t b;
+  uint64_t s;
+  if (!ParseUint64(token.substr(0, dots), &a) ||
+      !ParseUint64(to, &b) ||
+      !ParseUint64(step, &s) ||
+      (a > b) ||
+      (geometric && ((a == 0) || (s < 2))) ||
+      (!geometric && (s == 0))) {
+    return false;
+  }
+  for (uint64_t v = a; v <= b; v = geometric ? v * s : v + s) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%" PRIu64, v);
+    values->push_back(buffer);
+  }
+  return true;
+}
+
+
+// Returns whether arg is one of the --sweep* flags. Sets takes_value if the
+// flag's value is given as separate argument.
+bool IsSweepFlag(const std::string& arg, bool* takes_value) {
+  size_t start = arg.find_first_not_of('-');
+  if ((start == 0) || (start == std::string::npos) ||
+      (arg.compare(start, sizeof(kSweepFlag) - 1, kSweepFlag) != 0)) {
+    return false;
+  }
+  const size_t eq = arg.find('=');
+  const std::string name = arg.substr(start, eq - start);
+  if ((name != "sweep") && (name != "sweep_reps") &&
+      (name != "sweep_warmup") && (name != "sweep_metric")) {
+    return false;
+  }
+  *takes_value = eq == std::string::npos;
+  return true;
+}
+
+
+bool IsNumber(const std::string& s) {
+  if (s.empty()) {
+    return false;
+  }
+  char* end;
+  strtod(s.c_str(), &end);
+  return *end == '\0';
+}
+
+}  // namespace
+
+namespace scal {
+
+bool Sweep::Requested() {
+  return !FLAGS_sweep.empty();
+}
+
+
+int Sweep::RunFromFlags(const char* default_metric) {
+  std::vector<Parameter> params;
+  if (!ParseSpec(FLAGS_sweep, &params)) {
+    fprintf(stderr, "error: invalid sweep spec '%s'\n", FLAGS_sweep.c_str());
+    return EXIT_FAILURE;
+  }
+  if (FLAGS_sweep_reps == 0) {
+    fprintf(stderr, "error: --sweep_reps must be at least 1\n");
+    return EXIT_FAILURE;
+  }
+  const std::string metric =
+      FLAGS_sweep_metric.empty() ? default_metric : FLAGS_sweep_metric;
+  Sweep sweep(params, FLAGS_sweep_warmup, FLAGS_sweep_reps, metric);
+  sweep.Run(stdout);
+  return EXIT_SUCCESS;
+}
+
+
+bool Sweep::ParseSpec(const std::string& spec,
+                      std::vector<Parameter>* params) {
+  std::vector<std::string> tokens = Split(spec, ',');
+  for (size_t i = 0; i < tokens.size(); i++) {
+    std::string value = tokens[i];
+    const size_t eq = tokens[i].find('=');
+    if (eq != std::string::npos) {
+      Parameter param;
+      param.names = Split(Trim(tokens[i].substr(0, eq)), '+');
+      for (size_t j = 0; j < param.names.size(); j++) {
+        if (param.names[j].empty()) {
+          return false;
+        }
+      }
+      params->push_back(param);
+      value = Trim(tokens[i].substr(eq + 1));
+    }
+    if (params->empty() || !ExpandValue(value, &params->back().values)) {
+      return false;
+    }
+  }
+  return !params->empty();
+}
+
+
+Sweep::Stats Sweep::Summarize(const std::vector<double>& samples) {
+  Stats stats;
+  const size_t n = samples.size();
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += samples[i];
+  }
+  stats.mean = sum / n;
+
+  std::vector<double> sorted(samples);
+  std::sort(sorted.begin(), sorted.end());
+  if ((n % 2) == 0) {
+    stats.median = (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+  } else {
+    stats.median = sorted[n / 2];
+  }
+
+  stats.stddev = 0;
+  stats.ci95_low = stats.mean;
+  stats.ci95_high = stats.mean;
+  if (n > 1) {
+    double squares = 0;
+    for (size_t i = 0; i < n; i++) {
+      squares += (samples[i] - stats.mean) * (samples[i] - stats.mean);
+    }
+    stats.stddev = sqrt(squares / (n - 1));
+    const size_t df = n - 1;
+    const double t =
+        (df <= sizeof(kT95) / sizeof(kT95[0])) ? kT95[df - 1] : kZ95;
+    const double half_width = t * stats.stddev / sqrt(n);
+    stats.ci95_low = stats.mean - half_width;
+    stats.ci95_high = stats.mean + half_width;
+  }
+  return stats;
+}
+
+
+Sweep::Sweep(const std::vector<Parameter>& params,
+             uint64_t warmup,
+             uint64_t reps,
+             const std::string& metric)
+    : params_(params),
+      warmup_(warmup),
+      reps_(reps),
+      metric_(metric) {
+}
+
+
+void Sweep::Run(FILE* fp) {
+  // Odometer over the value indices, the last parameter varies fastest.
+  std::vector<size_t> point(params_.size(), 0);
+  while (true) {
+    std::vector<std::string> overrides;
+    for (size_t i = 0; i < params_.size(); i++) {
+      for (size_t j = 0; j < params_[i].names.size(); j++) {
+        overrides.push_back("--" + params_[i].names[j] + "=" +
+                            params_[i].values[point[i]]);
+      }
+    }
+    for (uint64_t i = 0; i < warmup_; i++) {
+      RunOnce(overrides);
+    }
+    std::vector<double> samples;
+    for (uint64_t i = 0; i < reps_; i++) {
+      samples.push_back(RunOnce(overrides));
+    }
+    PrintPoint(fp, point, samples);
+
+    size_t i = params_.size();
+    while (i > 0) {
+      i--;
+      if (++point[i] < params_[i].values.size()) {
+        break;
+      }
+      point[i] = 0;
+      if (i == 0) {
+        return;
+      }
+    }
+  }
+}
+
+
+double Sweep::RunOnce(const std::vector<std::string>& overrides) {
+  const std::vector<std::string>& argvs = google::GetArgvs();
+  std::vector<std::string> args;
+  args.push_back(argvs[0]);
+  for (size_t i = 1; i < argvs.size(); i++) {
+    bool takes_value;
+    if (IsSweepFlag(argvs[i], &takes_value)) {
+      if (takes_value) {
+        i++;
+      }
+      continue;
+    }
+    args.push_back(argvs[i]);
+  }
+  args.push_back("--print_summary=true");
+  args.insert(args.end(), overrides.begin(), overrides.end());
+  std::vector<char*> argv;
+  for (size_t i = 0; i < args.size(); i++) {
+    argv.push_back(const_cast<char*>(args[i].c_str()));
+  }
+  argv.push_back(NULL);
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    abort();
+  }
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    abort();
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    dup2(fds[1], STDOUT_FILENO);
+    close(fds[1]);
+    execv("/proc/self/exe", &argv[0]);
+    perror("execv");
+    _exit(EXIT_FAILURE);
+  }
+  close(fds[1]);
+  std::string output;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+    if (n < 0) {
+      perror("read");
+      abort();
+    }
+    output.append(buffer, n);
+  }
+  close(fds[0]);
+  int status;
+  if ((waitpid(pid, &status, 0) != pid) ||
+      !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+    fprintf(stderr, "error: sweep run failed:");
+    for (size_t i = 0; i < args.size(); i++) {
+      fprintf(stderr, " %s", args[i].c_str());
+    }
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+  }
+
+  const std::string key = "\"" + metric_ + "\":";
+  const size_t pos = output.find(key);
+  if (pos == std::string::npos) {
+    fprintf(stderr, "error: metric '%s' not found in summary: %s\n",
+            metric_.c_str(), output.c_str());
+    exit(EXIT_FAILURE);
+  }
+  return strtod(output.c_str() + pos + key.size(), NULL);
+}
+
+
+void Sweep::PrintPoint(FILE* fp,
+                       const std::vector<size_t>& point,
+                       const std::vector<double>& samples) {
+  fprintf(fp, "{\"point\": {");
+  bool first = true;
+  for (size_t i = 0; i < params_.size(); i++) {
+    const std::string& value = params_[i].values[point[i]];
+    for (size_t j = 0; j < params_[i].names.size(); j++) {
+      fprintf(fp, IsNumber(value) ? "%s\"%s\": %s" : "%s\"%s\": \"%s\"",
+              first ? "" : " ,", params_[i].names[j].c_str(), value.c_str());
+      first = false;
+    }
+  }
+  const Stats stats = Summarize(samples);
+  fprintf(fp, "} ,\"metric\": \"%s\" ,\"warmup\": %" PRIu64
+              " ,\"reps\": %" PRIu64 " ,\"mean\": %.2f ,\"median\": %.2f"
+              " ,\"stddev\": %.2f ,\"ci95_low\": %.2f ,\"ci95_high\": %.2f"
+              " ,\"samples\": [",
+          metric_.c_str(), warmup_, reps_, stats.mean, stats.median,
+          stats.stddev, stats.ci95_low, stats.ci95_high);
+  for (size_t i = 0; i < samples.size(); i++) {
+    fprintf(fp, "%s%.2f", (i == 0) ? "" : ", ", samples[i]);
+  }
+  fprintf(fp, "]}\n");
+  fflush(fp);
+}
+
+}  // namespace scal
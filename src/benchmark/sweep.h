@@ -0,0 +1,83 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_SWEEP_H_
+#define SCAL_BENCHMARK_SWEEP_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace scal {
+
+// Runs the current benchmark binary over the cartesian product of flag values
+// given by --sweep, e.g.
+//
+//   --sweep="producers+consumers=1..64:x2, c=0,500,5000"
+//
+// Every point is run --sweep_warmup times without being recorded, followed by
+// --sweep_reps recorded repetitions. Each run is a separate process, so that
+// runs do not share thread-local memory or thread ids. Per point one JSON line
+// with the statistics of --sweep_metric (taken from the run's summary) is
+// printed.
+//
+// Values are either plain (strings or numbers) or integer ranges: a..b
+// (step 1), a..b:+s or a..b:s (step s), and a..b:xf (factor f). Parameter
+// names joined with '+' are set to the same value.
+class Sweep {
+ public:
+  struct Parameter {
+    std::vector<std::string> names;
+    std::vector<std::string> values;
+  };
+
+  struct Stats {
+    double mean;
+    double median;
+    double stddev;
+    // 95% confidence interval of the mean, using Student's t-distribution.
+    double ci95_low;
+    double ci95_high;
+  };
+
+  // Returns whether a sweep has been requested on the command line.
+  static bool Requested();
+
+  // Runs the sweep given by the command line flags and returns the exit code
+  // for main(). default_metric is used if --sweep_metric is not set.
+  static int RunFromFlags(const char* default_metric);
+
+  // Returns false for malformed specs.
+  static bool ParseSpec(const std::string& spec,
+                        std::vector<Parameter>* params);
+
+  static Stats Summarize(const std::vector<double>& samples);
+
+  Sweep(const std::vector<Parameter>& params,
+        uint64_t warmup,
+        uint64_t reps,
+        const std::string& metric);
+
+  // Prints one JSON line per point to fp.
+  void Run(FILE* fp);
+
+ private:
+  // Runs the benchmark once with the given flags appended to the original
+  // command line and extracts the metric from its summary.
+  double RunOnce(const std::vector<std::string>& overrides);
+  void PrintPoint(FILE* fp,
+                  const std::vector<size_t>& point,
+                  const std::vector<double>& samples);
+
+  std::vector<Parameter> params_;
+  uint64_t warmup_;
+  uint64_t reps_;
+  std::string metric_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_SWEEP_H_
@@ -0,0 +1,214 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include "benchmark/thread_placement.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "util/topology.h"
+
+namespace {
+
+const char kListPrefix[] = "list:";
+
+// Sort key of a cpu: three components compared lexicographically, and the
+// cpu id as tie breaker.
+struct Slot {
+  int key[3];
+  int cpu;
+
+  bool operator<(const Slot& other) const {
+    for (int i = 0; i < 3; i++) {
+      if (key[i] != other.key[i]) {
+        return key[i] < other.key[i];
+      }
+    }
+    return cpu < other.cpu;
+  }
+};
+
+
+bool IsList(const std::string& policy) {
+  return policy.compare(0, sizeof(kListPrefix) - 1, kListPrefix) == 0;
+}
+
+}  // namespace
+
+namespace scal {
+
+ThreadPlacement::ThreadPlacement(uint64_t num_threads)
+    : num_threads_(num_threads),
+      cpus_(num_threads, -1),
+      roles_(num_threads) {
+}
+
+
+std::vector<int> ThreadPlacement::CpuOrder(const std::string& policy) {
+  const CpuTopology& topology = CpuTopology::Get();
+  std::vector<int> order;
+  if (IsList(policy)) {
+    if (!CpuTopology::ParseCpuList(policy.substr(sizeof(kListPrefix) - 1),
+                                   &order) ||
+        order.empty()) {
+      fprintf(stderr, "error: invalid cpu list in placement '%s'\n",
+              policy.c_str());
+      exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+      if (topology.Find(order[i]) == NULL) {
+        fprintf(stderr, "error: cpu %d in placement '%s' is not online\n",
+                order[i], policy.c_str());
+        exit(EXIT_FAILURE);
+      }
+    }
+    return order;
+  }
+
+  // Cores ids are not necessarily dense, use their rank within a socket.
+  std::map<std::pair<int, int>, int> core_rank;
+  for (size_t i = 0; i < topology.cpus().size(); i++) {
+    const CpuInfo& info = topology.cpus()[i];
+    core_rank[std::make_pair(info.socket, info.core)] = 0;
+  }
+  std::map<int, int> cores_per_socket;
+  for (std::map<std::pair<int, int>, int>::iterator it = core_rank.begin();
+       it != core_rank.end();
+       ++it) {
+    it->second = cores_per_socket[it->first.first]++;
+  }
+
+  std::vector<Slot> slots;
+  for (size_t i = 0; i < topology.cpus().size(); i++) {
+    const CpuInfo& info = topology.cpus()[i];
+    const int core = core_rank[std::make_pair(info.socket, info.core)];
+    Slot slot;
+    slot.cpu = info.cpu;
+    if (policy == "compact") {
+      slot.key[0] = info.smt;
+      slot.key[1] = info.socket;
+      slot.key[2] = core;
+    } else if (policy == "scatter") {
+      slot.key[0] = info.smt;
+      slot.key[1] = core;
+      slot.key[2] = info.socket;
+    } else if (policy == "smt-first") {
+      slot.key[0] = info.socket;
+      slot.key[1] = core;
+      slot.key[2] = info.smt;
+    } else if (policy == "socket-fill") {
+      slot.key[0] = info.socket;
+      slot.key[1] = info.smt;
+      slot.key[2] = core;
+    } else {
+      fprintf(stderr, "error: unknown placement policy '%s'\n",
+              policy.c_str());
+      exit(EXIT_FAILURE);
+    }
+    slots.push_back(slot);
+  }
+  std::sort(slots.begin(), slots.end());
+  for (size_t i = 0; i < slots.size(); i++) {
+    order.push_back(slots[i].cpu);
+  }
+  return order;
+}
+
+
+void ThreadPlacement::Assign(const std::vector<uint64_t>& threads,
+                             const std::string& policy,
+                             const std::string& role) {
+  if (!description_.empty()) {
+    description_ += ",";
+  }
+  description_ += role.empty() ? policy : role + "=" + policy;
+  if ((policy == "none") || threads.empty()) {
+    return;
+  }
+
+  std::vector<int> order = CpuOrder(policy);
+  if (!IsList(policy)) {
+    std::set<int> taken(cpus_.begin(), cpus_.end());
+    std::vector<int> free;
+    for (size_t i = 0; i < order.size(); i++) {
+      if (taken.count(order[i]) == 0) {
+        free.push_back(order[i]);
+      }
+    }
+    if (free.size() < threads.size()) {
+      fprintf(stderr, "warning: placement '%s' oversubscribes cpus\n",
+              policy.c_str());
+    }
+    if (!free.empty()) {
+      order.swap(free);
+    }
+  } else if (order.size() < threads.size()) {
+    fprintf(stderr, "warning: placement '%s' oversubscribes cpus\n",
+            policy.c_str());
+  }
+  for (size_t i = 0; i < threads.size(); i++) {
+    if (threads[i] >= num_threads_) {
+      fprintf(stderr, "%s: error: thread index %" PRIu64 " out of range\n",
+              __func__, threads[i]);
+      abort();
+    }
+    cpus_[threads[i]] = order[i % order.size()];
+    roles_[threads[i]] = role;
+  }
+}
+
+
+void ThreadPlacement::AssignAll(const std::string& policy) {
+  std::vector<uint64_t> threads;
+  for (uint64_t i = 0; i < num_threads_; i++) {
+    threads.push_back(i);
+  }
+  Assign(threads, policy, "");
+}
+
+
+void ThreadPlacement::Pin(uint64_t thread_idx) {
+  const int cpu = cpus_[thread_idx];
+  if (cpu < 0) {
+    return;
+  }
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+    fprintf(stderr, "warning: could not set thread cpu affinity\n");
+  }
+}
+
+
+void ThreadPlacement::PrintJson(FILE* fp) {
+  const CpuTopology& topology = CpuTopology::Get();
+  fprintf(fp, " ,\"placement\": \"%s\" ,\"thread_cpus\": [",
+          description_.c_str());
+  for (uint64_t i = 0; i < num_threads_; i++) {
+    const CpuInfo* info = topology.Find(cpus_[i]);
+    fprintf(fp, "%s{\"thread\": %" PRIu64, (i == 0) ? "" : ", ", i);
+    if (!roles_[i].empty()) {
+      fprintf(fp, " ,\"role\": \"%s\"", roles_[i].c_str());
+    }
+    if (info == NULL) {
+      fprintf(fp, " ,\"cpu\": -1}");
+    } else {
+      fprintf(fp, " ,\"cpu\": %d ,\"socket\": %d ,\"core\": %d ,\"node\": %d}",
+              info->cpu, info->socket, info->core, info->node);
+    }
+  }
+  fprintf(fp, "]");
+}
+
+}  // namespace scal
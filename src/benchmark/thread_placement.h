@@ -0,0 +1,66 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_THREAD_PLACEMENT_H_
+#define SCAL_BENCHMARK_THREAD_PLACEMENT_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace scal {
+
+// Maps benchmark threads (0-based index, i.e., thread id - 1) to cpus.
+//
+// Policies:
+//   none        -- no pinning.
+//   compact     -- one thread per core, filling a socket before moving on to
+//                  the next one; SMT siblings only after all cores are used.
+//   scatter     -- one thread per core, round-robin across sockets; SMT
+//                  siblings only after all cores are used.
+//   smt-first   -- all hardware threads of a core before the next core,
+//                  socket by socket.
+//   socket-fill -- all hardware threads of a socket (cores first, then their
+//                  siblings) before the next socket.
+//   list:<cpus> -- explicit cpus in sysfs list format, e.g., list:0-3,8.
+class ThreadPlacement {
+ public:
+  explicit ThreadPlacement(uint64_t num_threads);
+
+  // Places the given threads according to a policy, skipping cpus that are
+  // already taken by previous calls (unless the policy is an explicit list).
+  // The role is only used for reporting.
+  void Assign(const std::vector<uint64_t>& threads,
+              const std::string& policy,
+              const std::string& role);
+
+  // Places all threads according to a policy.
+  void AssignAll(const std::string& policy);
+
+  // Pins the calling thread to the cpu of the given thread index, if any.
+  void Pin(uint64_t thread_idx);
+
+  // Returns the cpu of a given thread index, or -1 if it is not pinned.
+  inline int CpuOf(uint64_t thread_idx) const { return cpus_[thread_idx]; }
+
+  // Prints the mapping as JSON members (starting with " ,"), ready to be
+  // appended to a benchmark summary.
+  void PrintJson(FILE* fp);
+
+  // Returns the cpus in the order defined by a policy. Terminates on unknown
+  // policies or cpus that are not online.
+  static std::vector<int> CpuOrder(const std::string& policy);
+
+ private:
+  uint64_t num_threads_;
+  std::vector<int> cpus_;
+  std::vector<std::string> roles_;
+  std::string description_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_THREAD_PLACEMENT_H_
@@ -0,0 +1,172 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#define __STDC_FORMAT_MACROS 1  // we want PRIu64 and friends
+
+#include "benchmark/throughput_sampler.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "util/allocation.h"
+#include "util/scal-time.h"
+
+namespace {
+
+// Upper bound on a single sleep of the sampler thread, i.e., the latency of
+// noticing Arm() or Finish().
+const uint64_t kMaxSleepUs = 1000;
+
+}  // namespace
+
+namespace scal {
+
+ThroughputSampler::ThroughputSampler(uint64_t num_threads,
+                                     uint64_t interval_ms,
+                                     uint64_t duration_ms)
+    : num_threads_(num_threads),
+      interval_ms_(interval_ms),
+      duration_ms_(duration_ms),
+      start_time_(0),
+      stop_(false),
+      finish_(false),
+      running_(false),
+      last_total_(0) {
+  // Thread ids are 1-based for workers, 0 is the main thread.
+  counters_ = static_cast<Counter*>(
+      CallocAligned(num_threads_ + 1, sizeof(Counter), kCachePrefetch));
+  if ((interval_ms_ > 0) && (duration_ms_ > 0)) {
+    samples_.reserve(duration_ms_ / interval_ms_ + 2);
+  }
+}
+
+
+void ThroughputSampler::Start() {
+  if (!active()) {
+    return;
+  }
+  int s = pthread_create(&thread_, NULL,
+                         ThroughputSampler::pthread_start_helper,
+                         reinterpret_cast<void*>(this));
+  if (s != 0) {
+    errno = s;
+    perror("pthread_create");
+    exit(EXIT_FAILURE);
+  }
+  running_ = true;
+}
+
+
+void ThroughputSampler::Arm() {
+  if (start_time_.load(std::memory_order_relaxed) != 0) {
+    return;
+  }
+  uint64_t expected = 0;
+  start_time_.compare_exchange_strong(expected, get_utime());
+}
+
+
+void ThroughputSampler::Finish() {
+  if (!running_) {
+    return;
+  }
+  finish_.store(true);
+  pthread_join(thread_, NULL);
+  running_ = false;
+  // Account for the operations of the last (partial) interval.
+  if ((interval_ms_ > 0) && (start_time_.load() != 0)) {
+    TakeSample(get_utime());
+  }
+}
+
+
+uint64_t ThroughputSampler::TotalOperations() {
+  uint64_t total = 0;
+  for (uint64_t i = 0; i <= num_threads_; i++) {
+    total += counters_[i].value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+
+void ThroughputSampler::TakeSample(uint64_t now) {
+  const uint64_t total = TotalOperations();
+  const uint64_t start = start_time_.load();
+  Sample sample;
+  sample.time = now - start;
+  sample.operations = total - last_total_;
+  samples_.push_back(sample);
+  last_total_ = total;
+}
+
+
+void ThroughputSampler::Loop() {
+  // Wait for the workers to pass the start barrier.
+  while (start_time_.load() == 0) {
+    if (finish_.load()) {
+      return;
+    }
+    usleep(kMaxSleepUs / 10);
+  }
+  const uint64_t start = start_time_.load();
+  const uint64_t deadline =
+      (duration_ms_ > 0) ? start + duration_ms_ * 1000 : 0;
+  uint64_t next_sample = (interval_ms_ > 0) ? start + interval_ms_ * 1000 : 0;
+  last_total_ = 0;
+
+  while (!finish_.load()) {
+    const uint64_t now = get_utime();
+    if ((next_sample != 0) && (now >= next_sample)) {
+      TakeSample(now);
+      // Skip sample points we missed because the sampler thread was not
+      // scheduled in time; the sample above covers them.
+      while (next_sample <= now) {
+        next_sample += interval_ms_ * 1000;
+      }
+    }
+    if ((deadline != 0) && (now >= deadline)) {
+      stop_.store(true);
+      return;
+    }
+    uint64_t wakeup = now + kMaxSleepUs;
+    if ((next_sample != 0) && (next_sample < wakeup)) {
+      wakeup = next_sample;
+    }
+    if ((deadline != 0) && (deadline < wakeup)) {
+      wakeup = deadline;
+    }
+    usleep(wakeup - now);
+  }
+}
+
+
+void ThroughputSampler::PrintJson(FILE* fp) {
+  if (duration_ms_ > 0) {
+    fprintf(fp, " ,\"duration_ms\": %" PRIu64, duration_ms_);
+  }
+  if (interval_ms_ == 0) {
+    return;
+  }
+  fprintf(fp, " ,\"sample_interval_ms\": %" PRIu64 " ,\"throughput_series\": [",
+          interval_ms_);
+  uint64_t prev_time = 0;
+  for (size_t i = 0; i < samples_.size(); i++) {
+    const Sample& s = samples_[i];
+    const uint64_t length = s.time - prev_time;
+    // Throughput is reported in operations per ms, as in the summary.
+    const uint64_t throughput = (length == 0) ? 0 : static_cast<uint64_t>(
+        s.operations / (static_cast<double>(length) / 1000));
+    fprintf(fp, "%s{\"t\": %" PRIu64 " ,\"operations\": %" PRIu64
+                " ,\"throughput\": %" PRIu64 "}",
+            (i == 0) ? "" : ", ", s.time, s.operations, throughput);
+    prev_time = s.time;
+  }
+  fprintf(fp, "]");
+}
+
+}  // namespace scal
@@ -0,0 +1,96 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_BENCHMARK_THROUGHPUT_SAMPLER_H_
+#define SCAL_BENCHMARK_THROUGHPUT_SAMPLER_H_
+
+#include <pthread.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <vector>
+
+#include "util/platform.h"
+
+namespace scal {
+
+// Counts completed operations per thread and periodically snapshots the
+// counters from a separate sampler thread, yielding a throughput time series.
+//
+// In duration mode (duration_ms > 0) the sampler thread additionally raises a
+// stop flag once duration_ms have passed since the workers have been released.
+// Workers are expected to poll stopped() and return.
+class ThroughputSampler {
+ public:
+  ThroughputSampler(uint64_t num_threads,
+                    uint64_t interval_ms,
+                    uint64_t duration_ms);
+
+  // Spawns the sampler thread. Time starts with the first call to Arm().
+  void Start();
+
+  // Called by workers after passing the start barrier. Only the first call
+  // has an effect.
+  void Arm();
+
+  // Stops and joins the sampler thread.
+  void Finish();
+
+  _always_inline bool active() {
+    return interval_ms_ > 0 || duration_ms_ > 0;
+  }
+
+  _always_inline bool stopped() {
+    return stop_.load(std::memory_order_relaxed);
+  }
+
+  // Only ever called by the thread owning the counter.
+  _always_inline void Count(uint64_t thread_id, uint64_t num = 1) {
+    std::atomic<uint64_t>& cnt = counters_[thread_id].value;
+    cnt.store(cnt.load(std::memory_order_relaxed) + num,
+              std::memory_order_relaxed);
+  }
+
+  uint64_t TotalOperations();
+
+  // Prints the time series as JSON members (starting with " ,"), ready to be
+  // appended to a benchmark summary.
+  void PrintJson(FILE* fp);
+
+ private:
+  struct Counter {
+    std::atomic<uint64_t> value;
+    uint8_t pad[kCachePrefetch - sizeof(std::atomic<uint64_t>)];
+  };
+
+  struct Sample {
+    uint64_t time;        // In us, relative to Arm().
+    uint64_t operations;  // Operations completed within this interval.
+  };
+
+  static void* pthread_start_helper(void* thiz) {
+    reinterpret_cast<ThroughputSampler*>(thiz)->Loop();
+    return NULL;
+  }
+
+  void Loop();
+  void TakeSample(uint64_t now);
+
+  uint64_t num_threads_;
+  uint64_t interval_ms_;
+  uint64_t duration_ms_;
+  Counter* counters_;
+  std::atomic<uint64_t> start_time_;
+  std::atomic<bool> stop_;
+  std::atomic<bool> finish_;
+  pthread_t thread_;
+  bool running_;
+  uint64_t last_total_;
+  std::vector<Sample> samples_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_BENCHMARK_THROUGHPUT_SAMPLER_H_
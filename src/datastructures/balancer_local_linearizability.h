@@ -39,6 +39,12 @@ class BalancerLocalLinearizability {
     return true;
   }
 
+  // Whether threads with ids below num_threads put into pairwise different
+  // backends, i.e., every backend has at most a single producer.
+  inline bool exclusive_puts(uint64_t num_threads) const {
+    return size_ >= num_threads;
+  }
+
  private:
   size_t size_;
   size_t* distribution_;
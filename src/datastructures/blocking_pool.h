@@ -0,0 +1,156 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A pool wrapper that lets consumers block instead of polling.
+//
+// get_wait() spins on get() for a bounded number of attempts and then parks
+// the caller on a futex. Before parking, a consumer announces itself in
+// parked_ and checks the backend once more. A producer only looks at parked_
+// after its put, so puts issue no syscall as long as no consumer is parked.
+// The first put after a consumer observed the pool as empty takes the flag
+// and wakes all parked consumers; subsequent puts see the flag cleared until
+// a consumer parks again.
+
+#ifndef SCAL_DATASTRUCTURES_BLOCKING_POOL_H_
+#define SCAL_DATASTRUCTURES_BLOCKING_POOL_H_
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "datastructures/pool.h"
+#include "util/platform.h"
+#include "util/scal-time.h"
+
+namespace scal {
+
+template<typename T>
+class BlockingPool : public Pool<T> {
+ public:
+  struct WaitInfo {
+    // Number of times the caller has been parked.
+    uint64_t parks;
+    // TSC cycles from the waking put to the caller running again (last wake
+    // up only, 0 if the caller has not been woken up).
+    uint64_t wakeup_cycles;
+  };
+
+  // Consumers try spin gets before parking.
+  BlockingPool(Pool<T>* backend, uint64_t spin)
+      : backend_(backend), spin_(spin), epoch_(0), parked_(0), wake_time_(0),
+        wakeups_(0) {}
+
+  bool put(T item) {
+    const bool ok = backend_->put(item);
+    Notify();
+    return ok;
+  }
+
+  bool put_batch(const T* items, size_t num) {
+    const bool ok = backend_->put_batch(items, num);
+    Notify();
+    return ok;
+  }
+
+  inline bool get(T* item) {
+    return backend_->get(item);
+  }
+
+  inline size_t get_batch(T* items, size_t max) {
+    return backend_->get_batch(items, max);
+  }
+
+  bool get_wait(T* item, uint64_t timeout_us) {
+    return get_wait(item, timeout_us, NULL);
+  }
+
+  bool get_wait(T* item, uint64_t timeout_us, WaitInfo* info);
+
+  // Number of futex wake ups issued by producers.
+  inline uint64_t wakeups() {
+    return wakeups_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  _always_inline void Notify() {
+    // Orders the put before reading parked_; pairs with the store to parked_
+    // in get_wait().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ((parked_.load(std::memory_order_relaxed) != 0) &&
+        (parked_.exchange(0) != 0)) {
+      Wake();
+    }
+  }
+
+  void Wake() {
+    wake_time_.store(get_hwtime(), std::memory_order_relaxed);
+    epoch_.fetch_add(1);
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    syscall(SYS_futex, &epoch_, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+  }
+
+  Pool<T>* backend_;
+  uint64_t spin_;
+  uint8_t pad1_[kCachePrefetch - sizeof(Pool<T>*) - sizeof(uint64_t)];
+  // Futex word, incremented on every wake up.
+  std::atomic<uint32_t> epoch_;
+  std::atomic<uint32_t> parked_;
+  std::atomic<uint64_t> wake_time_;
+  std::atomic<uint64_t> wakeups_;
+  uint8_t pad2_[kCachePrefetch - 2 * sizeof(uint32_t) - 2 * sizeof(uint64_t)];
+};
+
+
+template<typename T>
+bool BlockingPool<T>::get_wait(T* item, uint64_t timeout_us, WaitInfo* info) {
+  const bool forever = timeout_us == Pool<T>::kWaitForever;
+  const uint64_t deadline = forever ? 0 : get_utime() + timeout_us;
+  while (true) {
+    for (uint64_t i = 0; i < spin_; i++) {
+      if (backend_->get(item)) {
+        return true;
+      }
+      __asm__ __volatile__("pause");
+    }
+    // Read the epoch before announcing the park: A put that is missed by the
+    // get below either takes parked_ and bumps the epoch, or a concurrent
+    // put already did so after this read. In both cases the futex does not
+    // sleep on the stale epoch.
+    const uint32_t epoch = epoch_.load();
+    parked_.store(1);
+    if (backend_->get(item)) {
+      return true;
+    }
+    struct timespec timeout;
+    struct timespec* timeout_ptr = NULL;
+    if (!forever) {
+      const uint64_t now = get_utime();
+      if (now >= deadline) {
+        return false;
+      }
+      timeout.tv_sec = (deadline - now) / 1000000;
+      timeout.tv_nsec = ((deadline - now) % 1000000) * 1000;
+      timeout_ptr = &timeout;
+    }
+    if (info != NULL) {
+      info->parks++;
+    }
+    const long rc = syscall(SYS_futex, &epoch_, FUTEX_WAIT_PRIVATE, epoch,  // NOLINT
+                            timeout_ptr, NULL, 0);
+    if ((rc == 0) && (info != NULL) && (epoch_.load() != epoch)) {
+      info->wakeup_cycles =
+          get_hwtime() - wake_time_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_BLOCKING_POOL_H_
@@ -0,0 +1,133 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Implementing the bounded MPMC queue from:
+//
+// D. Vyukov. Bounded MPMC queue.
+// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//
+// A strict FIFO queue on a ring buffer. Every slot carries a sequence number
+// that tells enqueuers and dequeuers of which round the slot is: A slot at
+// position pos can be filled if its sequence equals pos, and emptied if it
+// equals pos + 1. Enqueuers and dequeuers claim positions by CAS on the tail
+// and head counters, respectively.
+
+#ifndef SCAL_DATASTRUCTURES_BOUNDED_MPMC_QUEUE_H_
+#define SCAL_DATASTRUCTURES_BOUNDED_MPMC_QUEUE_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "datastructures/queue.h"
+#include "util/allocation.h"
+#include "util/ds_stats.h"
+#include "util/platform.h"
+
+namespace scal {
+
+template<typename T, class Stats = DsStats>
+class BoundedMpmcQueue : public Queue<T> {
+ public:
+  // The capacity is rounded up to the next power of two.
+  explicit BoundedMpmcQueue(uint64_t capacity);
+
+  // Fails if the queue is full.
+  bool enqueue(T item);
+  bool dequeue(T *item);
+
+  inline uint64_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    T value;
+  };
+
+  Slot* slots_;
+  uint64_t mask_;
+  uint8_t pad1_[kCachePrefetch - sizeof(Slot*) - sizeof(uint64_t)];
+  std::atomic<uint64_t> tail_;
+  uint8_t pad2_[kCachePrefetch - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> head_;
+  uint8_t pad3_[kCachePrefetch - sizeof(std::atomic<uint64_t>)];
+};
+
+
+template<typename T, class Stats>
+BoundedMpmcQueue<T, Stats>::BoundedMpmcQueue(uint64_t capacity)
+    : tail_(0), head_(0) {
+  if (capacity == 0) {
+    fprintf(stderr, "%s: capacity has to be positive\n", __func__);
+    abort();
+  }
+  uint64_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  mask_ = size - 1;
+  slots_ = static_cast<Slot*>(MallocAligned(size * sizeof(Slot),
+                                            kCachePrefetch));
+  for (uint64_t i = 0; i < size; i++) {
+    new(&slots_[i].sequence) std::atomic<uint64_t>(i);
+  }
+}
+
+
+template<typename T, class Stats>
+bool BoundedMpmcQueue<T, Stats>::enqueue(T item) {
+  uint64_t pos = tail_.load(std::memory_order_relaxed);
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Slot& slot = slots_[pos & mask_];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(sequence - pos);
+    if (diff == 0) {
+      if (Stats::Cas(tail_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed))) {
+        slot.value = item;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+      // pos has been updated by the failed CAS.
+    } else if (diff < 0) {
+      // The slot still holds the item of the previous round.
+      return false;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+
+template<typename T, class Stats>
+bool BoundedMpmcQueue<T, Stats>::dequeue(T *item) {
+  uint64_t pos = head_.load(std::memory_order_relaxed);
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Slot& slot = slots_[pos & mask_];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(sequence - (pos + 1));
+    if (diff == 0) {
+      if (Stats::Cas(head_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed))) {
+        *item = slot.value;
+        slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // The slot has not been filled in this round yet.
+      return false;
+    } else {
+      pos = head_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_BOUNDED_MPMC_QUEUE_H_
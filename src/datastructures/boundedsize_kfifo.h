@@ -18,6 +18,7 @@
 #include "datastructures/queue.h"
 #include "util/allocation.h"
 #include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
 #include "util/platform.h"
 #include "util/random.h"
 
@@ -33,13 +34,17 @@
 
 namespace scal {
 
-template<typename T>
+template<typename T, class Stats = DsStats>
 class BoundedSizeKFifo : public Queue<T> {
  public:
   BoundedSizeKFifo(uint64_t k, uint64_t num_segments);
   bool enqueue(T item);
   bool dequeue(T *item);
 
+  // Fills the free slots of the tail segment in a single pass before moving
+  // on to the next segment.
+  bool put_batch(const T* items, size_t num);
+
  private:
   typedef TaggedValue<uint64_t> SegmentPtr;
   typedef AtomicTaggedValue<uint64_t, PTR_ALIGNMENT, 128> AtomicSegmentPtr;
@@ -77,8 +82,8 @@ class BoundedSizeKFifo : public Queue<T> {
 };
 
 
-template<typename T>
-BoundedSizeKFifo<T>::BoundedSizeKFifo(uint64_t k, uint64_t num_segments)
+template<typename T, class Stats>
+BoundedSizeKFifo<T, Stats>::BoundedSizeKFifo(uint64_t k, uint64_t num_segments)
     : queue_size_(k * num_segments)
     , k_(k)
     , head_(new AtomicSegmentPtr())
@@ -88,8 +93,8 @@ BoundedSizeKFifo<T>::BoundedSizeKFifo(uint64_t k, uint64_t num_segments)
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::find_index(
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::find_index(
     uint64_t start_index, bool empty, int64_t *item_index, Item* old) {
   const uint64_t random_index = pseudorand() % k_;
   uint64_t index;
@@ -106,22 +111,30 @@ bool BoundedSizeKFifo<T>::find_index(
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::advance_head(const SegmentPtr& head_old) {
-  return head_->swap(
-      head_old, SegmentPtr((head_old.value() + k_) % queue_size_, head_old.tag() + 1));
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::advance_head(const SegmentPtr& head_old) {
+  if (Stats::Cas(head_->swap(
+      head_old, SegmentPtr((head_old.value() + k_) % queue_size_, head_old.tag() + 1)))) {
+    Stats::Count(kSegmentAdvances);
+    return true;
+  }
+  return false;
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::advance_tail(const SegmentPtr& tail_old) {
-  return tail_->swap(
-      tail_old, SegmentPtr((tail_old.value() + k_) % queue_size_, tail_old.tag() + 1));
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::advance_tail(const SegmentPtr& tail_old) {
+  if (Stats::Cas(tail_->swap(
+      tail_old, SegmentPtr((tail_old.value() + k_) % queue_size_, tail_old.tag() + 1)))) {
+    Stats::Count(kSegmentAdvances);
+    return true;
+  }
+  return false;
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::queue_full(
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::queue_full(
     const SegmentPtr& head_old, const SegmentPtr& tail_old) {
   if (((tail_old.value() + k_) % queue_size_) == head_old.value() &&
       (head_old.value() == head_->load().value())) {
@@ -131,8 +144,8 @@ bool BoundedSizeKFifo<T>::queue_full(
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::segment_not_empty(const SegmentPtr& head_old) {
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::segment_not_empty(const SegmentPtr& head_old) {
   const uint64_t start = head_old.value();
   for (size_t i = 0; i < k_; i++) {
     if (queue_[(start + i) % queue_size_].load().value() != (T)NULL) {
@@ -143,8 +156,8 @@ bool BoundedSizeKFifo<T>::segment_not_empty(const SegmentPtr& head_old) {
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::in_valid_region(uint64_t tail_old_pointer,
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::in_valid_region(uint64_t tail_old_pointer,
                                           uint64_t tail_current_pointer,
                                           uint64_t head_current_pointer) {
   bool wrap_around = (tail_current_pointer < head_current_pointer)
@@ -158,8 +171,8 @@ bool BoundedSizeKFifo<T>::in_valid_region(uint64_t tail_old_pointer,
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::not_in_valid_region(uint64_t tail_old_pointer,
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::not_in_valid_region(uint64_t tail_old_pointer,
                                               uint64_t tail_current_pointer,
                                               uint64_t head_current_pointer) {
   bool wrap_around = (tail_current_pointer < head_current_pointer)
@@ -173,8 +186,8 @@ bool BoundedSizeKFifo<T>::not_in_valid_region(uint64_t tail_old_pointer,
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::committed(const SegmentPtr& tail_old,
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::committed(const SegmentPtr& tail_old,
                                     //uint64_t tail_old_pointer,
                                     //AtomicValue<T> *new_item,
                                     const Item& new_item,
@@ -190,18 +203,18 @@ bool BoundedSizeKFifo<T>::committed(const SegmentPtr& tail_old,
     return true;
   } else if (not_in_valid_region(tail_old.value(), tail_current.value(),
                                  head_current.value())) {
-    if (!queue_[item_index].swap(
-          new_item, Item((T)NULL, new_item.tag() + 1))) {
+    if (!Stats::Cas(queue_[item_index].swap(
+          new_item, Item((T)NULL, new_item.tag() + 1)))) {
       return true;
     }
   } else {
-    if (head_->swap(
+    if (Stats::Cas(head_->swap(
           head_current, SegmentPtr(head_current.value(),
-                                   head_current.tag() + 1))) {
+                                   head_current.tag() + 1)))) {
       return true;
     }
-    if (!queue_[item_index].swap(
-          new_item, Item((T)NULL, new_item.tag() + 1))) { 
+    if (!Stats::Cas(queue_[item_index].swap(
+          new_item, Item((T)NULL, new_item.tag() + 1)))) { 
       return true;
     }
   }
@@ -209,14 +222,15 @@ bool BoundedSizeKFifo<T>::committed(const SegmentPtr& tail_old,
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::dequeue(T *item) {
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::dequeue(T *item) {
   SegmentPtr tail_old;
   SegmentPtr head_old;
   int64_t item_index;
   Item old_item;
   bool found_idx;
   while (true) {
+    Stats::Count(kLoopIterations);
     head_old = head_->load();
     tail_old = tail_->load();
     found_idx = find_index(head_old.value(), false, &item_index, &old_item);
@@ -225,8 +239,8 @@ bool BoundedSizeKFifo<T>::dequeue(T *item) {
         if (head_old.value() == tail_old.value()) {
           advance_tail(tail_old);
         }
-        if (queue_[item_index].swap(
-              old_item, Item((T)NULL, old_item.tag() + 1))) {
+        if (Stats::Cas(queue_[item_index].swap(
+              old_item, Item((T)NULL, old_item.tag() + 1)))) {
           *item = old_item.value();
           return true;
         }
@@ -242,8 +256,8 @@ bool BoundedSizeKFifo<T>::dequeue(T *item) {
 }
 
 
-template<typename T>
-bool BoundedSizeKFifo<T>::enqueue(T item) {
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::enqueue(T item) {
   TaggedValue<T>::CheckCompatibility(item);
   if (item == (T)NULL) {
     printf("%s: unable to enqueue NULL or equivalent value\n", __func__);
@@ -255,13 +269,14 @@ bool BoundedSizeKFifo<T>::enqueue(T item) {
   Item old_item;
   bool found_idx;
   while (true) {
+    Stats::Count(kLoopIterations);
     tail_old = tail_->load();
     head_old = head_->load();
     found_idx = find_index(tail_old.value(), true, &item_index, &old_item);
     if (tail_old == tail_->load()) {
       if (found_idx) {
         const Item new_item(item, old_item.tag() + 1);
-        if (queue_[item_index].swap(old_item, new_item)) {
+        if (Stats::Cas(queue_[item_index].swap(old_item, new_item))) {
           if (committed(tail_old, new_item, item_index)) {
             return true;
           }
@@ -280,6 +295,57 @@ bool BoundedSizeKFifo<T>::enqueue(T item) {
   }
 }
 
+
+template<typename T, class Stats>
+bool BoundedSizeKFifo<T, Stats>::put_batch(const T* items, size_t num) {
+  for (size_t i = 0; i < num; i++) {
+    TaggedValue<T>::CheckCompatibility(items[i]);
+    if (items[i] == (T)NULL) {
+      printf("%s: unable to enqueue NULL or equivalent value\n", __func__);
+      abort();
+    }
+  }
+  SegmentPtr tail_old;
+  SegmentPtr head_old;
+  Item old_item;
+  size_t done = 0;
+  while (done < num) {
+    Stats::Count(kLoopIterations);
+    tail_old = tail_->load();
+    head_old = head_->load();
+    const uint64_t random_index = pseudorand() % k_;
+    bool found_idx = false;
+    for (size_t i = 0; (i < k_) && (done < num); i++) {
+      const uint64_t item_index =
+          (tail_old.value() + ((random_index + i) % k_)) % queue_size_;
+      old_item = queue_[item_index].load();
+      if (old_item.value() != (T)NULL) {
+        continue;
+      }
+      found_idx = true;
+      if (tail_old != tail_->load()) {
+        break;
+      }
+      const Item new_item(items[done], old_item.tag() + 1);
+      if (Stats::Cas(queue_[item_index].swap(old_item, new_item)) &&
+          committed(tail_old, new_item, item_index)) {
+        done++;
+      }
+    }
+    if ((done < num) && !found_idx && (tail_old == tail_->load())) {
+      if (queue_full(head_old, tail_old)) {
+        if (segment_not_empty(head_old) &&
+            (head_old.value() == head_->load().value())) {
+          return false;
+        }
+        advance_head(head_old);
+      }
+      advance_tail(tail_old);
+    }
+  }
+  return true;
+}
+
 }  // namespace scal
 
 #endif  // SCAL_DATASTRUCTURES_BOUNDEDSIZE_KFIFO_H_
@@ -12,12 +12,13 @@
 #include "datastructures/pool.h"
 #include "util/allocation.h"
 #include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
 #include "util/platform.h"
 #include "util/threadlocals.h"
 
 namespace scal {
 
-template<typename T, class P, class B>
+template<typename T, class P, class B, class Stats = DsStats>
 class DistributedDataStructure : public Pool<T> {
  public:
   DistributedDataStructure(
@@ -25,6 +26,10 @@ class DistributedDataStructure : public Pool<T> {
   bool put(T item);
   bool get(T *item);
 
+  // A batch goes to a single backend.
+  bool put_batch(const T* items, size_t num);
+  size_t get_batch(T* items, size_t max);
+
  private:
   static const uint64_t kPtrAlignment = scal::kCachePrefetch;
 
@@ -34,8 +39,8 @@ class DistributedDataStructure : public Pool<T> {
 };
 
 
-template<typename T, class P, class B>
-DistributedDataStructure<T, P, B>::DistributedDataStructure(
+template<typename T, class P, class B, class Stats>
+DistributedDataStructure<T, P, B, Stats>::DistributedDataStructure(
     size_t num_data_structures, uint64_t num_threads, B* balancer)
     : num_data_structures_(num_data_structures),
       balancer_(balancer) {
@@ -48,15 +53,15 @@ DistributedDataStructure<T, P, B>::DistributedDataStructure(
 }
 
 
-template<typename T, class P, class B>
-bool DistributedDataStructure<T, P, B>::put(T item) {
+template<typename T, class P, class B, class Stats>
+bool DistributedDataStructure<T, P, B, Stats>::put(T item) {
   const uint64_t index = balancer_->put_id();
   return backend_[index]->put(item);
 }
 
 
-template<typename T, class P, class B>
-bool DistributedDataStructure<T, P, B>::get(T *item) {
+template<typename T, class P, class B, class Stats>
+bool DistributedDataStructure<T, P, B, Stats>::get(T *item) {
   uint64_t start;
 
 #ifdef GET_TRY_LOCAL_FIRST
@@ -70,6 +75,7 @@ bool DistributedDataStructure<T, P, B>::get(T *item) {
   size_t index;
   State tails[num_data_structures_];  // NOLINT
   while (true) {
+    Stats::Count(kLoopIterations);
     for (i = 0; i < num_data_structures_; i++) {
       index = (start + i) % num_data_structures_;
       if (backend_[index]->get_return_put_state(
@@ -83,6 +89,7 @@ bool DistributedDataStructure<T, P, B>::get(T *item) {
     for (i = 0; i < num_data_structures_; i++) {
       index = (start + i) % num_data_structures_;
       if (backend_[index]->put_state() != tails[index]) {
+        Stats::Count(kEmptyRescans);
         start = index;
         break;
       }
@@ -93,6 +100,47 @@ bool DistributedDataStructure<T, P, B>::get(T *item) {
   }
 }
 
+
+template<typename T, class P, class B, class Stats>
+bool DistributedDataStructure<T, P, B, Stats>::put_batch(
+    const T* items, size_t num) {
+  const uint64_t index = balancer_->put_id();
+  return backend_[index]->put_batch(items, num);
+}
+
+
+template<typename T, class P, class B, class Stats>
+size_t DistributedDataStructure<T, P, B, Stats>::get_batch(
+    T* items, size_t max) {
+  if (max == 0) {
+    return 0;
+  }
+  const uint64_t index = balancer_->get_id();
+  const size_t num = backend_[index]->get_batch(items, max);
+  if (num > 0) {
+    return num;
+  }
+  // Fall back to searching all backends (and checking for emptiness).
+  return get(items) ? 1 : 0;
+}
+
+
+// Returns a distributed data structure on backends of type SP if the balancer
+// guarantees exclusive puts for num_threads threads (see
+// BalancerLocalLinearizability::exclusive_puts()), and on backends of type P
+// otherwise. SP may then assume a single producer, e.g., scal::SpmcQueue for
+// scal::MSQueue.
+template<typename T, class P, class SP, class B>
+Pool<T>* NewDistributedDataStructure(
+    size_t num_data_structures, uint64_t num_threads, B* balancer) {
+  if (balancer->exclusive_puts(num_threads)) {
+    return new DistributedDataStructure<T, SP, B>(
+        num_data_structures, num_threads, balancer);
+  }
+  return new DistributedDataStructure<T, P, B>(
+      num_data_structures, num_threads, balancer);
+}
+
 }  // namespace scal
 
 #endif  // SCAL_DATASTRUCTURES_DISTRIBUTED_DATA_STRUCTURE_H_
@@ -19,6 +19,8 @@ namespace detail {
 
 // A producer node (PNode) is always assigned to a producing thread, i.e., a
 // thread that performed at least one put operation.
+// Only the assigned thread puts into the backend, i.e., P may be a
+// single-producer data structure such as scal::SpmcQueue.
 template<class P>
 struct PNode : ThreadLocalMemory<64> {
   PNode() : alive(1), backend(NULL) {
@@ -51,6 +53,9 @@ class DynamicDistributedDataStructure : public Pool<T> {
 
   uint64_t max_nodes_;
   ProducerNode** backends_;
+  // The node of each thread, indexed by thread id. Kept per instance, so
+  // that a thread can put into several instances.
+  ProducerNode** local_nodes_;
   uint64_t p_;
   uint64_t ds_state_;
   SpinLock<> segment_lock_;
@@ -65,20 +70,23 @@ DynamicDistributedDataStructure<T, P>::DynamicDistributedDataStructure(uint64_t
   const uint64_t backend_size = sizeof(ProducerNode*) * max_threads;
   backends_ = static_cast<ProducerNode**>(MallocAligned(backend_size, kPageSize));
   memset(backends_, 0, backend_size);
+  const uint64_t local_size =
+      sizeof(ProducerNode*) * ThreadContext::get_max_threads();
+  local_nodes_ = static_cast<ProducerNode**>(MallocAligned(local_size, kPageSize));
+  memset(local_nodes_, 0, local_size);
 }
 
 
 template<typename T, class P>
 detail::PNode<P>* DynamicDistributedDataStructure<T, P>::GetLocalNode(bool create_if_absent) {
-  scal::ThreadContext& ctx = scal::ThreadContext::get();
-  void* data = ctx.get_data();
-  if ((data == NULL) && create_if_absent) {
+  ProducerNode** local = &local_nodes_[scal::ThreadContext::get().thread_id()];
+  if ((*local == NULL) && create_if_absent) {
     ProducerNode* node = new ProducerNode();
-    ctx.set_data(node);
+    *local = node;
     AnnounceThread(node);
     return node;
   }
-  return reinterpret_cast<ProducerNode*>(data);
+  return *local;
 }
 
 
@@ -206,9 +214,7 @@ void DynamicDistributedDataStructure<T, P>::Terminate() {
     return;
   }
 
-  // For scal:: we need to get rid of our threadlocal state.
-  scal::ThreadContext& ctx = scal::ThreadContext::get();
-  ctx.set_data(NULL);
+  local_nodes_[scal::ThreadContext::get().thread_id()] = NULL;
 
   node->alive = 0;
   if (node->backend->empty()) {
@@ -27,7 +27,7 @@
 
 namespace scal {
 
-namespace detail {
+namespace eb_detail {
 
 enum Opcode {
   Push = 1,
@@ -48,7 +48,7 @@ struct Node : ThreadLocalMemory<kCachePrefetch * 4> {
   T data;
 };
 
-}  // namespace detail
+}  // namespace eb_detail
 
 template<typename T>
 class EliminationBackoffStack : public Stack<T> {
@@ -74,9 +74,9 @@ class EliminationBackoffStack : public Stack<T> {
   }
 
  private:
-  typedef detail::Node<T> Node;
-  typedef detail::Opcode Opcode;
-  typedef detail::Operation<T> Operation;
+  typedef eb_detail::Node<T> Node;
+  typedef eb_detail::Opcode Opcode;
+  typedef eb_detail::Operation<T> Operation;
 
   typedef TaggedValue<Node*> NodePtr;
   typedef AtomicTaggedValue<Node*, 64, 64> AtomicNodePtr;   
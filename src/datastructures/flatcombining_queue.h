@@ -20,7 +20,7 @@
 
 namespace scal {
 
-namespace detail {
+namespace fc_detail {
 
 enum Opcode {
   Done = 0,
@@ -49,7 +49,7 @@ struct Operation {
   }
 };
 
-}  // namespace detail
+}  // namespace fc_detail
 
 
 template<typename T>
@@ -60,8 +60,8 @@ class FlatCombiningQueue : public Queue<T> {
   bool dequeue(T *item);
 
  private:
-  typedef detail::Operation<T> Operation;
-  typedef detail::Opcode Opcode;
+  typedef fc_detail::Operation<T> Operation;
+  typedef fc_detail::Opcode Opcode;
 
   void ScanCombineApply();
 
@@ -0,0 +1,214 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A relaxed priority queue following the design of the k-LSM from:
+//
+// M. Wimmer, J. Gruber, J.L. Träff, and P. Tsigas. The lock-free k-LSM
+// relaxed priority queue. In Proc. Symposium on Principles and Practice of
+// Parallel Programming (PPoPP), pages 277–278. ACM, 2015.
+//
+// Every thread inserts into a local component holding at most k items. A full
+// local component is merged into the shared component as a whole. delete_min
+// removes the smaller of the local and the shared minimum, i.e., it may miss
+// the up to k items of every other thread's local component. Threads that
+// find both empty take items from the local components of other threads
+// (spying), so that no items get stranded.
+//
+// Unlike the original, components are sequential heaps protected by spin
+// locks instead of lock-free log-structured merge trees. To avoid a single
+// lock on the shared component, it is sharded into one heap per thread as in
+// the MultiQueue: A full local component is merged into a random shard that
+// could be try-locked, and the shared minimum is the smaller cached minimum of
+// two random shards, which are only try-locked as well. A local component is
+// only contended while it is spied on.
+//
+// The maximum value of T is reserved for empty components.
+
+#ifndef SCAL_DATASTRUCTURES_KLSM_H_
+#define SCAL_DATASTRUCTURES_KLSM_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <limits>
+#include <new>
+
+#include "datastructures/balancer_1random.h"
+#include "datastructures/priority_queue.h"
+#include "datastructures/sequential_heap.h"
+#include "util/allocation.h"
+#include "util/ds_stats.h"
+#include "util/lock.h"
+#include "util/platform.h"
+#include "util/random.h"
+#include "util/threadlocals.h"
+
+namespace scal {
+
+template<typename T, class Stats = DsStats>
+class KLsm : public PriorityQueue<T> {
+ public:
+  KLsm(uint64_t k, uint64_t num_threads);
+
+  bool insert(T item);
+  bool delete_min(T *item);
+
+ private:
+  static const T kEmpty;
+
+  struct Component {
+    SpinLock<> lock;
+    SequentialHeap<T> heap;
+    // Minimum of the heap (kEmpty if empty), readable without the lock.
+    std::atomic<T> min;
+    uint8_t pad[kCachePrefetch - sizeof(SpinLock<>) -
+                sizeof(SequentialHeap<T>) - sizeof(std::atomic<T>)];
+  };
+
+  static _always_inline void UpdateMin(Component* c) {
+    c->min.store(c->heap.empty() ? kEmpty : c->heap.min(),
+                 std::memory_order_relaxed);
+  }
+
+  // Removes the minimum of a locked component and unlocks it.
+  static _always_inline bool TakeMin(Component* c, T* item) {
+    const bool ok = c->heap.delete_min(item);
+    UpdateMin(c);
+    c->lock.Unlock();
+    return ok;
+  }
+
+  inline uint64_t ThreadIndex() {
+    return ThreadContext::get().thread_id() % num_threads_;
+  }
+
+  // The shard with the smaller minimum of two random shards.
+  inline Component* ChooseShard() {
+    Component* first = &shards_[balancer_.get_id()];
+    Component* second = &shards_[balancer_.get_id()];
+    return (second->min.load(std::memory_order_relaxed) <
+            first->min.load(std::memory_order_relaxed)) ? second : first;
+  }
+
+  // Moves all items of a locked local component to a random shard of the
+  // shared component.
+  void Merge(Component* local);
+
+  bool Spy(T* item);
+
+  uint64_t k_;
+  uint64_t num_threads_;
+  Component* locals_;
+  Component* shards_;
+  Balancer1Random balancer_;
+};
+
+
+template<typename T, class Stats>
+const T KLsm<T, Stats>::kEmpty = std::numeric_limits<T>::max();
+
+
+template<typename T, class Stats>
+KLsm<T, Stats>::KLsm(uint64_t k, uint64_t num_threads)
+    : k_(k), num_threads_(num_threads), balancer_(num_threads, false) {
+  if ((k == 0) || (num_threads == 0)) {
+    fprintf(stderr, "%s: k and the number of threads have to be positive\n",
+            __func__);
+    abort();
+  }
+  // The shards of the shared component follow the local components.
+  locals_ = static_cast<Component*>(MallocAligned(
+      2 * num_threads_ * sizeof(Component), kCachePrefetch));
+  for (uint64_t i = 0; i < 2 * num_threads_; i++) {
+    Component* c = new(&locals_[i]) Component();
+    c->min.store(kEmpty);
+  }
+  shards_ = &locals_[num_threads_];
+}
+
+
+template<typename T, class Stats>
+void KLsm<T, Stats>::Merge(Component* local) {
+  Component* shard;
+  do {
+    Stats::Count(kLoopIterations);
+    shard = &shards_[balancer_.put_id()];
+  } while (!shard->lock.TryLock());
+  const T* items = local->heap.items();
+  for (uint64_t i = 0; i < local->heap.size(); i++) {
+    shard->heap.insert(items[i]);
+  }
+  UpdateMin(shard);
+  shard->lock.Unlock();
+  local->heap.clear();
+  Stats::Count(kSegmentAdvances);
+}
+
+
+template<typename T, class Stats>
+bool KLsm<T, Stats>::insert(T item) {
+  Component* local = &locals_[ThreadIndex()];
+  local->lock.Lock();
+  if (local->heap.size() >= k_) {
+    Merge(local);
+  }
+  local->heap.insert(item);
+  UpdateMin(local);
+  local->lock.Unlock();
+  return true;
+}
+
+
+template<typename T, class Stats>
+bool KLsm<T, Stats>::delete_min(T *item) {
+  Component* local = &locals_[ThreadIndex()];
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Component* shard = ChooseShard();
+    const T shared_min = shard->min.load(std::memory_order_relaxed);
+    local->lock.Lock();
+    if (!local->heap.empty() &&
+        ((shared_min == kEmpty) || !(shared_min < local->heap.min()))) {
+      return TakeMin(local, item);
+    }
+    local->lock.Unlock();
+    if (shared_min == kEmpty) {
+      return Spy(item);
+    }
+    if (!shard->lock.TryLock()) {
+      continue;
+    }
+    if (!shard->heap.empty()) {
+      return TakeMin(shard, item);
+    }
+    // Emptied after reading the minimum.
+    shard->lock.Unlock();
+  }
+}
+
+
+template<typename T, class Stats>
+bool KLsm<T, Stats>::Spy(T* item) {
+  const uint64_t start = pseudorand() % num_threads_;
+  for (uint64_t i = 0; i < 2 * num_threads_; i++) {
+    // Includes all shards, as the two chosen ones may have been empty while
+    // others are not.
+    Component* c = &locals_[(start + i) % (2 * num_threads_)];
+    if (c->min.load(std::memory_order_relaxed) == kEmpty) {
+      continue;
+    }
+    c->lock.Lock();
+    if (!c->heap.empty()) {
+      return TakeMin(c, item);
+    }
+    c->lock.Unlock();
+  }
+  return false;
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_KLSM_H_
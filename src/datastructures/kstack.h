@@ -23,13 +23,15 @@
 #include "datastructures/stack.h"
 #include "util/allocation.h"
 #include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
 #include "util/platform.h"
 #include "util/random.h"
+#include "util/reclamation.h"
 #include "util/threadlocals.h"
 
 namespace scal {
 
-namespace detail {
+namespace kstack_detail {
 
 template<typename T>
 class KSegment : public ThreadLocalMemory<64> {
@@ -69,6 +71,10 @@ class KSegment : public ThreadLocalMemory<64> {
 #endif  // LOCALLY_LINEARIZABLE
   }
 
+  ~KSegment() {
+    ThreadLocalAllocator::Free(items);
+  }
+
   uint8_t remove;
   uint8_t _pad1[63];
   AtomicSegmentPtr  next;
@@ -84,10 +90,10 @@ class KSegment : public ThreadLocalMemory<64> {
 #endif  // LOCALLY_LINEARIZABLE
 };
 
-}  // namespace detail
+}  // namespace kstack_detail
 
 
-template<typename T>
+template<typename T, class Stats = DsStats, class R = Reclamation>
 class KStack : public Stack<T> {
  public:
   KStack(uint64_t k, uint64_t num_threads);
@@ -95,16 +101,18 @@ class KStack : public Stack<T> {
   bool pop(T *item);
 
  private:
-  typedef detail::KSegment<T> KSegment;
-  typedef typename detail::KSegment<T>::Item Item;
-  typedef typename detail::KSegment<T>::SegmentPtr SegmentPtr;
+  typedef kstack_detail::KSegment<T> KSegment;
+  typedef typename kstack_detail::KSegment<T>::Item Item;
+  typedef typename kstack_detail::KSegment<T>::SegmentPtr SegmentPtr;
   typedef AtomicTaggedValue<KSegment*, 4096, 4096> AtomicTopPtr;
+  typedef typename R::Guard Guard;
 
   inline bool is_empty(KSegment* segment);
   inline bool find_index(
       KSegment *segment, bool empty, uint64_t *item_index, TaggedValue<T>* old);
   bool try_add_new_ksegment(const TaggedValue<KSegment*>& top_old, const T& item);
-  void try_remove_ksegment(const TaggedValue<KSegment*>& top_old);
+  void try_remove_ksegment(
+      const TaggedValue<KSegment*>& top_old, Guard* guard);
   bool committed(
       TaggedValue<KSegment*> top_old, const TaggedValue<T>& item_new, uint64_t index);
 
@@ -113,15 +121,15 @@ class KStack : public Stack<T> {
 };
 
 
-template<typename T>
-KStack<T>::KStack(uint64_t k, uint64_t num_threads)
+template<typename T, class Stats, class R>
+KStack<T, Stats, R>::KStack(uint64_t k, uint64_t num_threads)
     : top_(new AtomicTopPtr(SegmentPtr(new KSegment(k), 0))),
       k_(k) {
 }
 
 
-template<typename T>
-bool KStack<T>::is_empty(KSegment* segment) {
+template<typename T, class Stats, class R>
+bool KStack<T, Stats, R>::is_empty(KSegment* segment) {
   // Distributed Queue style empty check.
   const uint64_t random_index = pseudorand() % k_;
   uint64_t index;
@@ -147,8 +155,8 @@ bool KStack<T>::is_empty(KSegment* segment) {
 }
 
 
-template<typename T>
-bool KStack<T>::try_add_new_ksegment(
+template<typename T, class Stats, class R>
+bool KStack<T, Stats, R>::try_add_new_ksegment(
     const TaggedValue<KSegment*>& top_old, const T& item) {
   if (top_->load() == top_old) {
     KSegment* segment_new = new KSegment(k_);
@@ -157,7 +165,9 @@ bool KStack<T>::try_add_new_ksegment(
 #ifdef LOCALLY_LINEARIZABLE
     segment_new->mark();
 #endif  // LOCALLY_LINEARIZABLE
-    if (top_->swap(top_old, SegmentPtr(segment_new, top_old.tag()+ 1))) {
+    if (Stats::Cas(
+            top_->swap(top_old, SegmentPtr(segment_new, top_old.tag()+ 1)))) {
+      Stats::Count(kSegmentAdvances);
       return true;
     } else {
       delete segment_new;
@@ -167,15 +177,18 @@ bool KStack<T>::try_add_new_ksegment(
 }
 
 
-template<typename T>
-void KStack<T>::try_remove_ksegment(
-    const TaggedValue<KSegment*>& top_old) {
-  SegmentPtr next = top_->load().value()->next.load();
+template<typename T, class Stats, class R>
+void KStack<T, Stats, R>::try_remove_ksegment(
+    const TaggedValue<KSegment*>& top_old, Guard* guard) {
+  SegmentPtr next = top_old.value()->next.load();
   if (top_->load() == top_old) {
     if (next.value() != NULL) {
       __sync_fetch_and_add(&top_old.value()->remove, 1);
       if (is_empty(top_old.value())) {
-        if (top_->swap(top_old, SegmentPtr(next.value(), top_old.tag() + 1))) {
+        if (Stats::Cas(top_->swap(
+                top_old, SegmentPtr(next.value(), top_old.tag() + 1)))) {
+          Stats::Count(kSegmentAdvances);
+          guard->Retire(top_old.value(), ReclaimObject<KSegment>);
           return;
         }
       }
@@ -185,8 +198,8 @@ void KStack<T>::try_remove_ksegment(
 }
 
 
-template<typename T>
-bool KStack<T>::committed(
+template<typename T, class Stats, class R>
+bool KStack<T, Stats, R>::committed(
     TaggedValue<KSegment*> top_old, const TaggedValue<T>& item_new, uint64_t index) {
   if (top_old.value()->items[index].load() != item_new) {
     return true;
@@ -194,16 +207,17 @@ bool KStack<T>::committed(
     return true;
   } else if (top_old.value()->remove >= 1) {
     if (top_->load() != top_old) {
-      if (!top_old.value()->items[index].swap(
-            item_new, Item((T)NULL, item_new.tag() + 1))) {
+      if (!Stats::Cas(top_old.value()->items[index].swap(
+            item_new, Item((T)NULL, item_new.tag() + 1)))) {
         return true;
       }
     } else {
-      if (top_->swap(top_old, SegmentPtr(top_old.value(), top_old.tag() +1))) {
+      if (Stats::Cas(top_->swap(
+              top_old, SegmentPtr(top_old.value(), top_old.tag() +1)))) {
         return true;
       }
-      if (!top_old.value()->items[index].swap(
-            item_new, Item((T)NULL, item_new.tag() + 1))) {
+      if (!Stats::Cas(top_old.value()->items[index].swap(
+            item_new, Item((T)NULL, item_new.tag() + 1)))) {
         return true;
       }
     }
@@ -212,8 +226,8 @@ bool KStack<T>::committed(
 }
 
 
-template<typename T>
-bool KStack<T>::find_index(
+template<typename T, class Stats, class R>
+bool KStack<T, Stats, R>::find_index(
     KSegment *segment, bool empty, uint64_t *item_index, TaggedValue<T>* old) {
   const uint64_t random_index = hwrand() % k_;
   uint64_t i;
@@ -230,15 +244,17 @@ bool KStack<T>::find_index(
 }
 
 
-template<typename T>
-bool KStack<T>::push(T item) {
+template<typename T, class Stats, class R>
+bool KStack<T, Stats, R>::push(T item) {
   TaggedValue<T>::CheckCompatibility(item);
+  Guard guard;
   SegmentPtr top_old;
   Item item_old;
   uint64_t item_index;
   bool found_idx;
   while (true) {
-    top_old = top_->load();
+    Stats::Count(kLoopIterations);
+    top_old = guard.Load(0, top_);
 
 #ifdef LOCALLY_LINEARIZABLE
     if (top_old.value()->is_marked()) {
@@ -253,7 +269,8 @@ bool KStack<T>::push(T item) {
     if (top_->load() == top_old) {
       if (found_idx) {
         Item item_new(item, item_old.tag() + 1);
-        if (top_old.value()->items[item_index].swap(item_old, item_new)) {
+        if (Stats::Cas(
+                top_old.value()->items[item_index].swap(item_old, item_new))) {
           if (committed(top_old, item_new, item_index)) {
 #ifdef LOCALLY_LINEARIZABLE
             top_old.value()->mark();
@@ -271,19 +288,21 @@ bool KStack<T>::push(T item) {
 }
 
 
-template<typename T>
-bool KStack<T>::pop(T *item) {
+template<typename T, class Stats, class R>
+bool KStack<T, Stats, R>::pop(T *item) {
+  Guard guard;
   SegmentPtr top_old;
   Item item_old;
   uint64_t item_index;
   bool found_idx;
   while (true) {
-    top_old = top_->load();
+    Stats::Count(kLoopIterations);
+    top_old = guard.Load(0, top_);
     found_idx = find_index(top_old.value(), false, &item_index, &item_old);
     if (top_->load() == top_old) {
       if (found_idx) {
-        if (top_old.value()->items[item_index].swap(
-              item_old, Item((T)NULL, item_old.tag() + 1))) {
+        if (Stats::Cas(top_old.value()->items[item_index].swap(
+              item_old, Item((T)NULL, item_old.tag() + 1)))) {
           *item = item_old.value();
           return true;
         }
@@ -293,9 +312,10 @@ bool KStack<T>::pop(T *item) {
             if (top_->load() == top_old) {
               return false;
             }
+            Stats::Count(kEmptyRescans);
           }
         } else {
-          try_remove_ksegment(top_old);
+          try_remove_ksegment(top_old, &guard);
         }
       }
     }
@@ -0,0 +1,348 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Implementing the queue from:
+//
+// A. Morrison and Y. Afek. Fast concurrent queues for x86 processors. In Proc.
+// Symposium on Principles and Practice of Parallel Programming (PPoPP), pages
+// 103–112. ACM, 2013.
+//
+// Unlike the upstream implementation wrapped by LCRQ (datastructures/lcrq.h),
+// all state lives in the instance, so several queues can exist in a process
+// (e.g. as backends of a distributed data structure). Rings that dequeuers
+// have moved past are retired through the reclamation policy R and, once
+// reclaimed, put on a free list of their queue from which new rings are
+// taken. With NoReclamation rings are never reused.
+//
+// Items are stored as 64-bit words; ~0 is reserved for empty cells.
+
+#ifndef SCAL_DATASTRUCTURES_LINKED_CRQ_H_
+#define SCAL_DATASTRUCTURES_LINKED_CRQ_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <new>
+
+#include "datastructures/queue.h"
+#include "util/allocation.h"
+#include "util/ds_stats.h"
+#include "util/lock.h"
+#include "util/platform.h"
+#include "util/reclamation.h"
+
+namespace scal {
+
+template<typename T, class Stats = DsStats, class R = Reclamation>
+class LinkedCRQ : public Queue<T> {
+ public:
+  // Rings have 2^ring_pow cells.
+  explicit LinkedCRQ(uint64_t ring_pow);
+  bool enqueue(T item);
+  bool dequeue(T *item);
+
+ private:
+  static_assert(sizeof(T) == sizeof(uint64_t), "items have to be 64 bits");
+
+  static const uint64_t kEmpty = ~0UL;
+  // Closed bit of a ring's tail and unsafe bit of a cell's index.
+  static const uint64_t kTopBit = 1UL << 63;
+  // Closing a ring falls back from CAS to test-and-set after these attempts.
+  static const int kCloseAttempts = 10;
+  // Dequeuers waiting for a slow enqueuer give up after this many rounds.
+  static const uint64_t kStarvationLimit = 200000;
+
+  struct Cell {
+    volatile uint64_t val;
+    volatile uint64_t idx;
+    uint8_t pad[kCachePrefetch - 2 * sizeof(uint64_t)];
+  };
+
+  struct Ring {
+    std::atomic<uint64_t> head;
+    uint8_t pad1[kCachePrefetch - sizeof(uint64_t)];
+    std::atomic<uint64_t> tail;
+    uint8_t pad2[kCachePrefetch - sizeof(uint64_t)];
+    std::atomic<Ring*> next;
+    LinkedCRQ* owner;
+    Ring* free_next;
+    uint8_t pad3[kCachePrefetch - 3 * sizeof(void*)];
+
+    // The cells follow the header.
+    inline Cell* cells() { return reinterpret_cast<Cell*>(this + 1); }
+  };
+
+  typedef unsigned __int128 DoubleWord;
+
+  static _always_inline bool CAS2(
+      Cell* cell, uint64_t val, uint64_t idx, uint64_t new_val,
+      uint64_t new_idx) {
+    return __sync_bool_compare_and_swap(
+        reinterpret_cast<volatile DoubleWord*>(cell),
+        (static_cast<DoubleWord>(idx) << 64) | val,
+        (static_cast<DoubleWord>(new_idx) << 64) | new_val);
+  }
+
+  static _always_inline uint64_t ToRaw(T item) {
+    uint64_t raw;
+    memcpy(&raw, &item, sizeof(raw));
+    return raw;
+  }
+
+  static _always_inline T FromRaw(uint64_t raw) {
+    T item;
+    memcpy(&item, &raw, sizeof(item));
+    return item;
+  }
+
+  // Reclaim function of retired rings.
+  static void RecycleRing(void* ring);
+
+  Ring* NewRing();
+  void FreeRing(Ring* ring);
+  bool AppendRing(Ring* rq, uint64_t raw);
+  bool CloseRing(Ring* rq, uint64_t t, int attempts);
+  void FixState(Ring* rq);
+
+  uint64_t ring_size_;
+  uint64_t mask_;
+  uint8_t pad1_[kCachePrefetch - 2 * sizeof(uint64_t)];
+  std::atomic<Ring*> head_;
+  uint8_t pad2_[kCachePrefetch - sizeof(Ring*)];
+  std::atomic<Ring*> tail_;
+  uint8_t pad3_[kCachePrefetch - sizeof(Ring*)];
+  SpinLock<> free_lock_;
+  Ring* free_rings_;
+};
+
+
+template<typename T, class Stats, class R>
+LinkedCRQ<T, Stats, R>::LinkedCRQ(uint64_t ring_pow) : free_rings_(NULL) {
+  if ((ring_pow == 0) || (ring_pow > 32)) {
+    fprintf(stderr, "%s: ring_pow has to be in [1, 32]\n", __func__);
+    abort();
+  }
+  ring_size_ = 1UL << ring_pow;
+  mask_ = ring_size_ - 1;
+  Ring* ring = NewRing();
+  head_.store(ring);
+  tail_.store(ring);
+}
+
+
+template<typename T, class Stats, class R>
+void LinkedCRQ<T, Stats, R>::RecycleRing(void* ring) {
+  Ring* r = static_cast<Ring*>(ring);
+  r->owner->FreeRing(r);
+}
+
+
+template<typename T, class Stats, class R>
+typename LinkedCRQ<T, Stats, R>::Ring* LinkedCRQ<T, Stats, R>::NewRing() {
+  free_lock_.Lock();
+  Ring* ring = free_rings_;
+  if (ring != NULL) {
+    free_rings_ = ring->free_next;
+  }
+  free_lock_.Unlock();
+  if (ring == NULL) {
+    ring = static_cast<Ring*>(MallocAligned(
+        sizeof(Ring) + ring_size_ * sizeof(Cell), kCachePrefetch));
+    new(ring) Ring();
+    ring->owner = this;
+  }
+  Cell* cells = ring->cells();
+  for (uint64_t i = 0; i < ring_size_; i++) {
+    cells[i].val = kEmpty;
+    cells[i].idx = i;
+  }
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  ring->next.store(NULL, std::memory_order_relaxed);
+  return ring;
+}
+
+
+template<typename T, class Stats, class R>
+void LinkedCRQ<T, Stats, R>::FreeRing(Ring* ring) {
+  free_lock_.Lock();
+  ring->free_next = free_rings_;
+  free_rings_ = ring;
+  free_lock_.Unlock();
+}
+
+
+template<typename T, class Stats, class R>
+bool LinkedCRQ<T, Stats, R>::AppendRing(Ring* rq, uint64_t raw) {
+  // Solo enqueue into a fresh ring.
+  Ring* ring = NewRing();
+  ring->tail.store(1, std::memory_order_relaxed);
+  ring->cells()[0].val = raw;
+  Ring* expected = NULL;
+  if (Stats::Cas(rq->next.compare_exchange_strong(expected, ring))) {
+    expected = rq;
+    tail_.compare_exchange_strong(expected, ring);
+    Stats::Count(kSegmentAdvances);
+    return true;
+  }
+  // The ring has never been visible to other threads.
+  FreeRing(ring);
+  return false;
+}
+
+
+template<typename T, class Stats, class R>
+bool LinkedCRQ<T, Stats, R>::CloseRing(Ring* rq, uint64_t t, int attempts) {
+  if (attempts < kCloseAttempts) {
+    uint64_t expected = t + 1;
+    return rq->tail.compare_exchange_strong(expected, (t + 1) | kTopBit);
+  }
+  return (rq->tail.fetch_or(kTopBit) & kTopBit) == 0;
+}
+
+
+template<typename T, class Stats, class R>
+void LinkedCRQ<T, Stats, R>::FixState(Ring* rq) {
+  while (true) {
+    uint64_t t = rq->tail.load();
+    const uint64_t h = rq->head.load();
+    if (rq->tail.load() != t) {
+      continue;
+    }
+    if (h > t) {
+      if (rq->tail.compare_exchange_strong(t, h)) {
+        break;
+      }
+      continue;
+    }
+    break;
+  }
+}
+
+
+template<typename T, class Stats, class R>
+bool LinkedCRQ<T, Stats, R>::enqueue(T item) {
+  const uint64_t raw = ToRaw(item);
+  typename R::Guard guard;
+  int close_attempts = 0;
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Ring* rq = tail_.load();
+    guard.Protect(0, rq);
+    if (R::kHazards && (tail_.load() != rq)) {
+      continue;
+    }
+    Ring* next = rq->next.load();
+    if (next != NULL) {
+      tail_.compare_exchange_strong(rq, next);
+      continue;
+    }
+    const uint64_t t = rq->tail.fetch_add(1);
+    if ((t & kTopBit) != 0) {
+      // Closed.
+      if (AppendRing(rq, raw)) {
+        return true;
+      }
+      continue;
+    }
+    Cell* cell = &rq->cells()[t & mask_];
+    const uint64_t idx = cell->idx;
+    const uint64_t val = cell->val;
+    if ((val == kEmpty) && ((idx & ~kTopBit) <= t) &&
+        (((idx & kTopBit) == 0) || (rq->head.load() < t)) &&
+        Stats::Cas(CAS2(cell, kEmpty, idx, raw, t))) {
+      return true;
+    }
+    const uint64_t h = rq->head.load();
+    if ((static_cast<int64_t>(t - h) >= static_cast<int64_t>(ring_size_)) &&
+        CloseRing(rq, t, ++close_attempts)) {
+      if (AppendRing(rq, raw)) {
+        return true;
+      }
+    }
+  }
+}
+
+
+template<typename T, class Stats, class R>
+bool LinkedCRQ<T, Stats, R>::dequeue(T *item) {
+  typename R::Guard guard;
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Ring* rq = head_.load();
+    guard.Protect(0, rq);
+    if (R::kHazards && (head_.load() != rq)) {
+      continue;
+    }
+    const uint64_t h = rq->head.fetch_add(1);
+    Cell* cell = &rq->cells()[h & mask_];
+    uint64_t tt = 0;
+    uint64_t rounds = 0;
+    while (true) {
+      const uint64_t cell_idx = cell->idx;
+      const uint64_t unsafe = cell_idx & kTopBit;
+      const uint64_t idx = cell_idx & ~kTopBit;
+      const uint64_t val = cell->val;
+      if (idx > h) {
+        break;
+      }
+      if (val != kEmpty) {
+        if (idx == h) {
+          if (Stats::Cas(CAS2(cell, val, cell_idx, kEmpty,
+                              unsafe | (h + ring_size_)))) {
+            *item = FromRaw(val);
+            return true;
+          }
+        } else if (CAS2(cell, val, cell_idx, val, idx | kTopBit)) {
+          // The enqueuer of round idx has not finished; mark the cell unsafe.
+          break;
+        }
+      } else {
+        if ((rounds & ((1UL << 10) - 1)) == 0) {
+          tt = rq->tail.load();
+        }
+        const bool closed = (tt & kTopBit) != 0;
+        const uint64_t t = tt & ~kTopBit;
+        if (unsafe != 0) {
+          if (CAS2(cell, val, cell_idx, val, unsafe | (h + ring_size_))) {
+            break;
+          }
+        } else if ((t < h + 1) || (rounds > kStarvationLimit) || closed) {
+          if (CAS2(cell, val, idx, val, h + ring_size_)) {
+            if ((rounds > kStarvationLimit) && (tt > ring_size_)) {
+              rq->tail.fetch_or(kTopBit);
+            }
+            break;
+          }
+        } else {
+          rounds++;
+        }
+      }
+    }
+    if ((rq->tail.load() & ~kTopBit) <= h + 1) {
+      FixState(rq);
+      Ring* next = rq->next.load();
+      if (next == NULL) {
+        return false;
+      }
+      if ((rq->tail.load() & ~kTopBit) <= h + 1) {
+        // The ring has to be unreachable from tail_ as well before it can be
+        // retired.
+        Ring* expected = rq;
+        tail_.compare_exchange_strong(expected, next);
+        expected = rq;
+        if (head_.compare_exchange_strong(expected, next)) {
+          guard.Retire(rq, RecycleRing);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_LINKED_CRQ_H_
@@ -15,7 +15,7 @@
 
 namespace scal {
 
-namespace detail {
+namespace ll_fc_detail {
 
 
 enum class Operation {
@@ -46,7 +46,7 @@ struct BackendNode {
   T item;
 };
 
-}  // namespace detail
+}  // namespace ll_fc_detail
 
 
 template<typename T, class P>
@@ -59,7 +59,7 @@ class LocLinFlatcombiningQueue : public Pool<T> {
   void Terminate();
 
  private:
-  typedef detail::BackendNode<P, T> BackendNode;
+  typedef ll_fc_detail::BackendNode<P, T> BackendNode;
 
   BackendNode* GetLocalNode();
   void AnnounceThread(BackendNode* node);
@@ -86,7 +86,7 @@ LocLinFlatcombiningQueue<T, P>::LocLinFlatcombiningQueue(uint64_t max_threads)
 
 
 template<typename T, class P>
-detail::BackendNode<P, T>* LocLinFlatcombiningQueue<T, P>::GetLocalNode() {
+ll_fc_detail::BackendNode<P, T>* LocLinFlatcombiningQueue<T, P>::GetLocalNode() {
   scal::ThreadContext& ctx = scal::ThreadContext::get();
   void* data = ctx.get_data();
   if (data == NULL) {
@@ -152,18 +152,18 @@ bool LocLinFlatcombiningQueue<T, P>::put(T item) {
 template<typename T, class P>
 bool LocLinFlatcombiningQueue<T, P>::get(T* item) {
   BackendNode* node = GetLocalNode();
-  node->operation_status = detail::Operation::kDequeue;
+  node->operation_status = ll_fc_detail::Operation::kDequeue;
   while (true) {
     if (segment_lock_.TryLock()) {
       for (uint64_t i = 0; i < p_; i++) {
-        if (backends_[i]->operation_status == detail::Operation::kDequeue) {
+        if (backends_[i]->operation_status == ll_fc_detail::Operation::kDequeue) {
           T item;
           if (DistributedQueueDequeue(&item)) {
             backends_[i]->item = item;
           } else {
             backends_[i]->item = (T)NULL;
           }
-          backends_[i]->operation_status = detail::Operation::kDone;
+          backends_[i]->operation_status = ll_fc_detail::Operation::kDone;
         }
       }
       segment_lock_.Unlock();
@@ -171,7 +171,7 @@ bool LocLinFlatcombiningQueue<T, P>::get(T* item) {
     } else {
       // maybe put in a backoff
       __asm__("PAUSE");
-      if (node->operation_status == detail::Operation::kDone) {
+      if (node->operation_status == ll_fc_detail::Operation::kDone) {
         break;
       }
     }
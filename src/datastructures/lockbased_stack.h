@@ -17,7 +17,7 @@
 
 namespace scal {
 
-namespace detail {
+namespace lb_stack_detail {
 
 template<typename S>
 class Node : public ThreadLocalMemory<64>  {
@@ -27,7 +27,7 @@ class Node : public ThreadLocalMemory<64>  {
   S value;
 };
 
-}  // namespace detail
+}  // namespace lb_stack_detail
 
 template<typename T>
 class LockBasedStack : public Stack<T> {
@@ -42,7 +42,7 @@ class LockBasedStack : public Stack<T> {
   inline bool get_return_put_state(T *item, State* put_state);
 
  private:
-  typedef detail::Node<T> Node;
+  typedef lb_stack_detail::Node<T> Node;
   typedef TaggedValue<Node*> NodePtr;
   typedef AtomicTaggedValue<Node*, 64, 64> AtomicNodePtr;
 
@@ -0,0 +1,46 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A strict priority queue: a binary heap protected by a single spin lock.
+// Baseline for the relaxed priority queues.
+
+#ifndef SCAL_DATASTRUCTURES_LOCKED_HEAP_H_
+#define SCAL_DATASTRUCTURES_LOCKED_HEAP_H_
+
+#include <inttypes.h>
+
+#include "datastructures/priority_queue.h"
+#include "datastructures/sequential_heap.h"
+#include "util/lock.h"
+#include "util/platform.h"
+
+namespace scal {
+
+template<typename T>
+class LockedHeap : public PriorityQueue<T> {
+ public:
+  LockedHeap() {}
+
+  bool insert(T item) {
+    lock_.Lock();
+    heap_.insert(item);
+    lock_.Unlock();
+    return true;
+  }
+
+  bool delete_min(T *item) {
+    lock_.Lock();
+    const bool ok = heap_.delete_min(item);
+    lock_.Unlock();
+    return ok;
+  }
+
+ private:
+  SpinLock<kCachePrefetch> lock_;
+  SequentialHeap<T> heap_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_LOCKED_HEAP_H_
@@ -19,13 +19,15 @@
 #include "datastructures/queue.h"
 #include "util/allocation.h"
 #include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
 #include "util/operation_logger.h"
 #include "util/platform.h"
+#include "util/reclamation.h"
 #include "util/threadlocals.h"
 
 namespace scal {
 
-namespace detail {
+namespace ms_detail {
 
 template<typename S>
 class Node : public ThreadLocalMemory<64>  {
@@ -36,19 +38,25 @@ class Node : public ThreadLocalMemory<64>  {
   S value;
 };
 
-}  // namespace detail
+}  // namespace ms_detail
 
 
-template<typename T>
+template<typename T, class Stats = DsStats, class R = Reclamation>
 class MSQueue : public Queue<T> {
  public:
-  typedef detail::Node<T> Node;
+  typedef ms_detail::Node<T> Node;
   typedef TaggedValue<Node*> NodePtr;
 
   MSQueue();
   bool enqueue(T item);
   bool dequeue(T *item);
 
+  // Links the items privately and splices them in with a single CAS.
+  bool put_batch(const T* items, size_t num);
+
+  // Takes up to max items (but not beyond the tail) with a single CAS.
+  size_t get_batch(T* items, size_t max);
+
   inline const TaggedValue<Node*> head() const {
     return head_->load();
   }
@@ -70,14 +78,15 @@ class MSQueue : public Queue<T> {
 
  private:
   typedef AtomicTaggedValue<Node*, scal::kCachePrefetch> AtomicNodePtr;
+  typedef typename R::Guard Guard;
 
   AtomicNodePtr* head_;
   AtomicNodePtr* tail_;
 };
 
 
-template<typename T>
-MSQueue<T>::MSQueue()
+template<typename T, class Stats, class R>
+MSQueue<T, Stats, R>::MSQueue()
     : head_(new AtomicNodePtr()),
       tail_(new AtomicNodePtr()) {
   Node* node = new Node(static_cast<T>(NULL));
@@ -86,23 +95,27 @@ MSQueue<T>::MSQueue()
 }
 
 
-template<typename T>
-bool MSQueue<T>::enqueue(T item) {
+template<typename T, class Stats, class R>
+bool MSQueue<T, Stats, R>::enqueue(T item) {
   Node* node = new Node(item);
+  Guard guard;
   NodePtr tail_old;
   NodePtr next;
   while (true) {
-    tail_old = tail_->load();
+    Stats::Count(kLoopIterations);
+    tail_old = guard.Load(0, tail_);
     next = tail_old.value()->next.load();
     if (tail_old == tail_->load()) {
       if (next.value() == NULL) {
-        if (tail_old.value()->next.swap(
-                next, NodePtr(node, next.tag() + 1))) {
-          tail_->swap(tail_old, NodePtr(node, tail_old.tag() + 1));
+        if (Stats::Cas(tail_old.value()->next.swap(
+                next, NodePtr(node, next.tag() + 1)))) {
+          Stats::Cas(tail_->swap(
+              tail_old, NodePtr(node, tail_old.tag() + 1)));
           break;
         }
       } else {
-        tail_->swap(tail_old, NodePtr(next.value(), tail_old.tag() + 1));
+        Stats::Cas(tail_->swap(
+            tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
       }
     }
   }
@@ -110,37 +123,79 @@ bool MSQueue<T>::enqueue(T item) {
 }
 
 
-template<typename T>
-bool MSQueue<T>::try_enqueue(T item, uint64_t tail_old_tag) {
+template<typename T, class Stats, class R>
+bool MSQueue<T, Stats, R>::put_batch(const T* items, size_t num) {
+  if (num == 0) {
+    return true;
+  }
+  Node* first = new Node(items[0]);
+  Node* last = first;
+  for (size_t i = 1; i < num; i++) {
+    Node* node = new Node(items[i]);
+    last->next.store(NodePtr(node, 0));
+    last = node;
+  }
+  Guard guard;
+  NodePtr tail_old;
+  NodePtr next;
+  while (true) {
+    Stats::Count(kLoopIterations);
+    tail_old = guard.Load(0, tail_);
+    next = tail_old.value()->next.load();
+    if (tail_old == tail_->load()) {
+      if (next.value() == NULL) {
+        if (Stats::Cas(tail_old.value()->next.swap(
+                next, NodePtr(first, next.tag() + 1)))) {
+          // If this fails the tail is moved along the batch one by one.
+          Stats::Cas(tail_->swap(
+              tail_old, NodePtr(last, tail_old.tag() + 1)));
+          break;
+        }
+      } else {
+        Stats::Cas(tail_->swap(
+            tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
+      }
+    }
+  }
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool MSQueue<T, Stats, R>::try_enqueue(T item, uint64_t tail_old_tag) {
+  Guard guard;
   NodePtr next;
   NodePtr tail_old;
-  tail_old = tail_->load();
+  tail_old = guard.Load(0, tail_);
   next = tail_old.value()->next.load();
   if (tail_old_tag == tail_old.tag()) {
     if (next.value() == NULL) {
       Node* node = new Node(item);
-      if (tail_old.value()->next.swap(
-              next, NodePtr(node, next.tag() + 1))) {
-        tail_->swap(tail_old, NodePtr(node, tail_old.tag() + 1));
+      if (Stats::Cas(tail_old.value()->next.swap(
+              next, NodePtr(node, next.tag() + 1)))) {
+        Stats::Cas(tail_->swap(
+            tail_old, NodePtr(node, tail_old.tag() + 1)));
         return true;
       }
     } else {
-      tail_->swap(tail_old, NodePtr(next.value(), tail_old.tag() + 1));
+      Stats::Cas(tail_->swap(
+          tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
     }
   }
   return false;
 }
 
 
-template<typename T>
-bool MSQueue<T>::empty() {
+template<typename T, class Stats, class R>
+bool MSQueue<T, Stats, R>::empty() {
+  Guard guard;
   NodePtr head_old;
   NodePtr tail_old;
   NodePtr next;
   while (true) {
-    head_old = head_->load();
+    head_old = guard.Load(0, head_);
     tail_old = tail_->load();
-    next = head_old.value()->next.load();
+    next = guard.Load(1, &head_old.value()->next);
     if (head_->load() == head_old) {
       if ((head_old.value() == tail_old.value()) &&
           (next.value() == NULL)) {
@@ -152,25 +207,29 @@ bool MSQueue<T>::empty() {
 }
 
 
-template<typename T>
-bool MSQueue<T>::dequeue(T* item) {
+template<typename T, class Stats, class R>
+bool MSQueue<T, Stats, R>::dequeue(T* item) {
+  Guard guard;
   NodePtr head_old;
   NodePtr tail_old;
   NodePtr next;
   while (true) {
-    head_old = head_->load();
+    Stats::Count(kLoopIterations);
+    head_old = guard.Load(0, head_);
     tail_old = tail_->load();
-    next = head_old.value()->next.load();
+    next = guard.Load(1, &head_old.value()->next);
     if (head_->load() == head_old) {
       if (head_old.value() == tail_old.value()) {
         if (next.value() == NULL) {
           return false;
         }
-        tail_->swap(tail_old, NodePtr(next.value(), tail_old.tag() + 1));
+        Stats::Cas(tail_->swap(
+            tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
       } else {
         *item = next.value()->value;
-        if (head_->swap(
-                head_old, NodePtr(next.value(), head_old.tag() + 1))) {
+        if (Stats::Cas(head_->swap(
+                head_old, NodePtr(next.value(), head_old.tag() + 1)))) {
+          guard.Retire(head_old.value(), ReclaimObject<Node>);
           break;
         }
       }
@@ -180,23 +239,82 @@ bool MSQueue<T>::dequeue(T* item) {
 }
 
 
-template<typename T>
-uint8_t MSQueue<T>::try_dequeue(
+template<typename T, class Stats, class R>
+size_t MSQueue<T, Stats, R>::get_batch(T* items, size_t max) {
+  Guard guard;
+  NodePtr head_old;
+  NodePtr tail_old;
+  NodePtr next;
+  if (max == 0) {
+    return 0;
+  }
+  while (true) {
+    Stats::Count(kLoopIterations);
+    head_old = guard.Load(0, head_);
+    tail_old = tail_->load();
+    next = guard.Load(1, &head_old.value()->next);
+    if (head_old == head_->load()) {
+      if (head_old.value() == tail_old.value()) {
+        if (next.value() == NULL) {
+          return 0;
+        }
+        Stats::Cas(tail_->swap(
+            tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
+      } else {
+        // The head is not ahead of tail_old, i.e., the nodes up to tail_old
+        // are linked for good.
+        Node* node = next.value();
+        size_t num = 0;
+        items[num++] = node->value;
+        while ((num < max) && (node != tail_old.value())) {
+          node = node->next.load().value();
+          if (R::kHazards) {
+            // Nodes only get unlinked after the head moved past them.
+            guard.Protect(2 + (num % 2), node);
+            if (head_->load() != head_old) {
+              break;
+            }
+          }
+          items[num++] = node->value;
+        }
+        if ((!R::kHazards || (head_->load() == head_old)) &&
+            Stats::Cas(head_->swap(
+                head_old, NodePtr(node, head_old.tag() + 1)))) {
+          // All nodes but the new head (the last one taken) are unlinked.
+          Node* unlinked = head_old.value();
+          while (unlinked != node) {
+            Node* following = unlinked->next.load().value();
+            guard.Retire(unlinked, ReclaimObject<Node>);
+            unlinked = following;
+          }
+          return num;
+        }
+      }
+    }
+  }
+}
+
+
+template<typename T, class Stats, class R>
+uint8_t MSQueue<T, Stats, R>::try_dequeue(
     T* item, uint64_t head_old_tag, State* put_state) {
-  NodePtr head_old = head_->load();
+  Guard guard;
+  NodePtr head_old = guard.Load(0, head_);
   NodePtr tail_old = tail_->load();
-  NodePtr next = head_old.value()->next.load();
+  NodePtr next = guard.Load(1, &head_old.value()->next);
   if (head_old_tag == head_old.tag()) {
     if (head_old.value() == tail_old.value()) {
       if (next.value() == NULL) {
         *put_state = tail_old.tag();
         return 1;
       }
-      tail_->swap(tail_old, NodePtr(next.value(), tail_old.tag() + 1));
+      Stats::Cas(tail_->swap(
+          tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
     } else {
       *item = next.value()->value;
-      if (head_->swap(
-              head_old, NodePtr(next.value(), head_old.tag() + 1))) {
+      if (Stats::Cas(head_->swap(
+              head_old, NodePtr(next.value(), head_old.tag() + 1)))) {
+        guard.Retire(head_old.value(), ReclaimObject<Node>);
         return 0;
       }
     }
@@ -205,26 +323,30 @@ uint8_t MSQueue<T>::try_dequeue(
 }
 
 
-template<typename T>
-bool MSQueue<T>::get_return_put_state(T *item, State* put_state) {
+template<typename T, class Stats, class R>
+bool MSQueue<T, Stats, R>::get_return_put_state(T *item, State* put_state) {
+  Guard guard;
   NodePtr head_old;
   NodePtr tail_old;
   NodePtr next;
   while (true) {
-    head_old = head_->load();
+    Stats::Count(kLoopIterations);
+    head_old = guard.Load(0, head_);
     tail_old = tail_->load();
-    next = head_old.value()->next.load();
+    next = guard.Load(1, &head_old.value()->next);
     if (head_->load() == head_old) {
       if (head_old.value() == tail_old.value()) {
         if (next.value() == NULL) {
           *put_state = tail_old.tag();
           return false;
         }
-        tail_->swap(tail_old, NodePtr(next.value(), tail_old.tag() + 1));
+        Stats::Cas(tail_->swap(
+            tail_old, NodePtr(next.value(), tail_old.tag() + 1)));
       } else {
         *item = next.value()->value;
-        if (head_->swap(
-                head_old, NodePtr(next.value(), head_old.tag() + 1))) {
+        if (Stats::Cas(head_->swap(
+                head_old, NodePtr(next.value(), head_old.tag() + 1)))) {
+          guard.Retire(head_old.value(), ReclaimObject<Node>);
           break;
         }
       }
@@ -0,0 +1,164 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Implementing the relaxed priority queue from:
+//
+// H. Rihani, P. Sanders, and R. Dementiev. MultiQueues: Simple relaxed
+// concurrent priority queues. In Proc. Symposium on Parallelism in Algorithms
+// and Architectures (SPAA), pages 80–82. ACM, 2015.
+//
+// Items are spread over a number of lock-protected sequential heaps (c times
+// the number of threads). An insert locks a random heap; a delete_min looks at
+// the cached minima of two random heaps and removes the smaller one. Heaps are
+// chosen as in the 1-random balancer and only try-locked, i.e., contended
+// heaps are skipped.
+//
+// If both heaps are empty, all heaps are scanned once; delete_min fails if no
+// heap holds an item at that point (emptiness is not linearizable).
+//
+// The maximum value of T is reserved for empty heaps.
+
+#ifndef SCAL_DATASTRUCTURES_MULTIQUEUE_H_
+#define SCAL_DATASTRUCTURES_MULTIQUEUE_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <limits>
+#include <new>
+
+#include "datastructures/balancer_1random.h"
+#include "datastructures/priority_queue.h"
+#include "datastructures/sequential_heap.h"
+#include "util/allocation.h"
+#include "util/ds_stats.h"
+#include "util/lock.h"
+#include "util/platform.h"
+#include "util/random.h"
+
+namespace scal {
+
+template<typename T, class Stats = DsStats>
+class MultiQueue : public PriorityQueue<T> {
+ public:
+  explicit MultiQueue(uint64_t num_heaps);
+
+  bool insert(T item);
+  bool delete_min(T *item);
+
+ private:
+  static const T kEmpty;
+
+  struct Heap {
+    SpinLock<> lock;
+    SequentialHeap<T> heap;
+    // Minimum of the heap (kEmpty if empty), readable without the lock.
+    std::atomic<T> min;
+    uint8_t pad[kCachePrefetch - sizeof(SpinLock<>) -
+                sizeof(SequentialHeap<T>) - sizeof(std::atomic<T>)];
+  };
+
+  static _always_inline void UpdateMin(Heap* h) {
+    h->min.store(h->heap.empty() ? kEmpty : h->heap.min(),
+                 std::memory_order_relaxed);
+  }
+
+  // Removes the minimum of a locked heap and unlocks it.
+  static _always_inline bool TakeMin(Heap* h, T* item) {
+    const bool ok = h->heap.delete_min(item);
+    UpdateMin(h);
+    h->lock.Unlock();
+    return ok;
+  }
+
+  bool ScanAll(T* item);
+
+  uint64_t num_heaps_;
+  Heap* heaps_;
+  Balancer1Random balancer_;
+};
+
+
+template<typename T, class Stats>
+const T MultiQueue<T, Stats>::kEmpty = std::numeric_limits<T>::max();
+
+
+template<typename T, class Stats>
+MultiQueue<T, Stats>::MultiQueue(uint64_t num_heaps)
+    : num_heaps_(num_heaps), balancer_(num_heaps, false) {
+  if (num_heaps == 0) {
+    fprintf(stderr, "%s: number of heaps has to be positive\n", __func__);
+    abort();
+  }
+  heaps_ = static_cast<Heap*>(MallocAligned(num_heaps_ * sizeof(Heap),
+                                            kCachePrefetch));
+  for (uint64_t i = 0; i < num_heaps_; i++) {
+    Heap* h = new(&heaps_[i]) Heap();
+    h->min.store(kEmpty);
+  }
+}
+
+
+template<typename T, class Stats>
+bool MultiQueue<T, Stats>::insert(T item) {
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Heap* h = &heaps_[balancer_.put_id()];
+    if (h->lock.TryLock()) {
+      h->heap.insert(item);
+      UpdateMin(h);
+      h->lock.Unlock();
+      return true;
+    }
+  }
+}
+
+
+template<typename T, class Stats>
+bool MultiQueue<T, Stats>::delete_min(T *item) {
+  while (true) {
+    Stats::Count(kLoopIterations);
+    Heap* first = &heaps_[balancer_.get_id()];
+    Heap* second = &heaps_[balancer_.get_id()];
+    const T first_min = first->min.load(std::memory_order_relaxed);
+    const T second_min = second->min.load(std::memory_order_relaxed);
+    if ((first_min == kEmpty) && (second_min == kEmpty)) {
+      return ScanAll(item);
+    }
+    Heap* h = (second_min < first_min) ? second : first;
+    if (!h->lock.TryLock()) {
+      continue;
+    }
+    if (h->heap.empty()) {
+      // Emptied after reading the minimum.
+      h->lock.Unlock();
+      continue;
+    }
+    return TakeMin(h, item);
+  }
+}
+
+
+template<typename T, class Stats>
+bool MultiQueue<T, Stats>::ScanAll(T* item) {
+  const uint64_t start = balancer_.get_id();
+  for (uint64_t i = 0; i < num_heaps_; i++) {
+    Heap* h = &heaps_[(start + i) % num_heaps_];
+    if (h->min.load(std::memory_order_relaxed) == kEmpty) {
+      continue;
+    }
+    h->lock.Lock();
+    if (!h->heap.empty()) {
+      return TakeMin(h, item);
+    }
+    h->lock.Unlock();
+  }
+  return false;
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_MULTIQUEUE_H_
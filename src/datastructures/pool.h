@@ -5,16 +5,56 @@
 #ifndef SCAL_DATASTRUCTURES_POOL_H_
 #define SCAL_DATASTRUCTURES_POOL_H_
 
+#include <stddef.h>
+
 #include "util/atomic_value_new.h"
+#include "util/scal-time.h"
 
 typedef uint64_t State;
 
 template<typename T>
 class Pool {
  public:
+  static const uint64_t kWaitForever = ~0UL;
+
   virtual bool put(T item) = 0;
   virtual bool get(T *item) = 0;
 
+  // Puts num items. Data structures that can amortize synchronization over a
+  // batch override this; the default puts the items one by one.
+  virtual bool put_batch(const T* items, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+      if (!put(items[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Gets up to max items and returns how many were retrieved. A return value
+  // of 0 has the same meaning as a failing get().
+  virtual size_t get_batch(T* items, size_t max) {
+    size_t num = 0;
+    while ((num < max) && get(&items[num])) {
+      num++;
+    }
+    return num;
+  }
+
+  // Gets an item, waiting up to timeout_us microseconds (kWaitForever: no
+  // limit) for one to arrive. The default polls get(); scal::BlockingPool
+  // parks the caller instead.
+  virtual bool get_wait(T* item, uint64_t timeout_us) {
+    const uint64_t start = get_utime();
+    while (!get(item)) {
+      if ((timeout_us != kWaitForever) &&
+          ((get_utime() - start) >= timeout_us)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   virtual void Terminate() {}
 
   virtual ~Pool() {}
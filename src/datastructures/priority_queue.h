@@ -0,0 +1,26 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_DATASTRUCTURES_PRIORITY_QUEUE_H_
+#define SCAL_DATASTRUCTURES_PRIORITY_QUEUE_H_
+
+#include "datastructures/pool.h"
+
+// Items are their own priorities; smaller items are removed first.
+template<typename T>
+class PriorityQueue : public Pool<T> {
+ public:
+  virtual bool insert(T item) = 0;
+  virtual bool delete_min(T *item) = 0;
+
+  inline bool put(T item) {
+    return insert(item);
+  }
+
+  inline bool get(T *item) {
+    return delete_min(item);
+  }
+};
+
+#endif  // SCAL_DATASTRUCTURES_PRIORITY_QUEUE_H_
@@ -32,7 +32,7 @@
 
 namespace scal {
 
-namespace detail {
+namespace rd_detail {
 
 template<typename T>
 struct Node : ThreadLocalMemory<kCachePrefetch>  {
@@ -45,7 +45,7 @@ struct Node : ThreadLocalMemory<kCachePrefetch>  {
   bool deleted;
 };
 
-}  // namespace detail
+}  // namespace rd_detail
 
 
 template<typename T>
@@ -56,7 +56,7 @@ class RandomDequeueQueue : public Queue<T> {
   bool dequeue(T *item);
 
  private:
-  typedef detail::Node<T> Node;
+  typedef rd_detail::Node<T> Node;
   typedef TaggedValue<Node*> NodePtr;
   typedef AtomicTaggedValue<Node*, 64, 64> AtomicNodePtr;
 
@@ -17,10 +17,11 @@
 #include "util/allocation.h"
 #include "util/atomic_value_new.h"
 #include "util/random.h"
+#include "util/reclamation.h"
 
 namespace scal {
 
-namespace detail {
+namespace sq_detail {
 
 template<typename T>
 class Pair : public ThreadLocalMemory<64> {
@@ -45,12 +46,20 @@ class Node  : public ThreadLocalMemory<64> {
       : segment(static_cast<Pair<T>**>(
           ThreadLocalAllocator::Get().CallocAligned(
               s, sizeof(Pair<T>*), 64)))
+      , s_(s)
       , next_(NodePtr(NULL, 0)) {
     for (uint64_t i = 0; i < s; i++) {
       segment[i] = new Pair<T>((T)NULL);
     }
   }
 
+  ~Node() {
+    for (uint64_t i = 0; i < s_; i++) {
+      delete segment[i];
+    }
+    ThreadLocalAllocator::Free(segment);
+  }
+
   _always_inline NodePtr next() { return next_.load(); }
   _always_inline bool atomic_set_next(
       const NodePtr& old_next, const NodePtr& new_next) { 
@@ -74,13 +83,14 @@ class Node  : public ThreadLocalMemory<64> {
 
  private:
   Pair<T>** segment;
+  uint64_t s_;
   AtomicNodePtr next_;
 };
 
-}  // namespace detail
+}  // namespace sq_detail
 
 
-template<typename T>
+template<typename T, class R = Reclamation>
 class SegmentQueue : public Queue<T> {
  public:
   explicit SegmentQueue(uint64_t s);
@@ -88,14 +98,17 @@ class SegmentQueue : public Queue<T> {
   bool dequeue(T* item);
 
  private:
-  typedef detail::Node<T> Node;
-  typedef typename detail::Node<T>::NodePtr NodePtr;
+  typedef sq_detail::Node<T> Node;
+  typedef typename sq_detail::Node<T>::NodePtr NodePtr;
   typedef AtomicTaggedValue<Node*, 4*128, 4*128> AtomicNodePtr;
+  typedef typename R::Guard Guard;
 
-  NodePtr get_tail();
-  NodePtr get_head();
-  void tail_segment_create(const typename detail::Node<T>::NodePtr& my_tail);
-  void head_segment_remove(const typename detail::Node<T>::NodePtr& my_head);
+  NodePtr get_tail(Guard* guard);
+  NodePtr get_head(Guard* guard);
+  void tail_segment_create(
+      const typename sq_detail::Node<T>::NodePtr& my_tail, Guard* guard);
+  void head_segment_remove(
+      const typename sq_detail::Node<T>::NodePtr& my_head, Guard* guard);
 
   AtomicNodePtr* head_;
   AtomicNodePtr* tail_;
@@ -103,8 +116,8 @@ class SegmentQueue : public Queue<T> {
 };
 
 
-template<typename T>
-SegmentQueue<T>::SegmentQueue(uint64_t s) 
+template<typename T, class R>
+SegmentQueue<T, R>::SegmentQueue(uint64_t s) 
     : s_(s) {
   const NodePtr new_node(new Node(s), 0);
   head_ = new AtomicNodePtr(new_node);
@@ -112,12 +125,13 @@ SegmentQueue<T>::SegmentQueue(uint64_t s)
 }
 
 
-template<typename T>
-bool SegmentQueue<T>::enqueue(T item) {
-  NodePtr tail = get_tail();
+template<typename T, class R>
+bool SegmentQueue<T, R>::enqueue(T item) {
+  Guard guard;
+  NodePtr tail = get_tail(&guard);
   while (tail.value() == NULL) {
-    tail_segment_create(tail);
-    tail = get_tail();
+    tail_segment_create(tail, &guard);
+    tail = get_tail(&guard);
   }
   uint64_t item_index;
   uint64_t rand;
@@ -133,21 +147,22 @@ bool SegmentQueue<T>::enqueue(T item) {
       }
     }
     do {
-      tail_segment_create(tail);
-      tail = get_tail();
+      tail_segment_create(tail, &guard);
+      tail = get_tail(&guard);
     } while (tail.value() == NULL);
   }
 }
 
 
-template<typename T>
-bool SegmentQueue<T>::dequeue(T* item) {
+template<typename T, class R>
+bool SegmentQueue<T, R>::dequeue(T* item) {
+  Guard guard;
   NodePtr head;
   uint64_t rand;
   uint64_t item_index;
   bool found_null = false;
   while (true) {
-    head = get_head();
+    head = get_head(&guard);
     if (head.value() == NULL) {
       return false;
     }
@@ -166,19 +181,19 @@ bool SegmentQueue<T>::dequeue(T* item) {
     if (found_null) { 
       return false;
     }
-    head_segment_remove(head);
+    head_segment_remove(head, &guard);
   }
 }
 
 
-template<typename T>
-typename detail::Node<T>::NodePtr SegmentQueue<T>::get_tail() {
+template<typename T, class R>
+typename sq_detail::Node<T>::NodePtr SegmentQueue<T, R>::get_tail(Guard* guard) {
   NodePtr next;
   NodePtr head_old;
   NodePtr tail_old;
   while (true) {
     head_old = head_->load();
-    tail_old = tail_->load();
+    tail_old = guard->Load(2, tail_);
     next = tail_old.value()->next();
     if ((tail_old == tail_->load()) &&
         (head_old == head_->load())) {
@@ -195,15 +210,17 @@ typename detail::Node<T>::NodePtr SegmentQueue<T>::get_tail() {
 }
 
 
-template<typename T>
-typename detail::Node<T>::NodePtr SegmentQueue<T>::get_head() {
+template<typename T, class R>
+typename sq_detail::Node<T>::NodePtr SegmentQueue<T, R>::get_head(Guard* guard) {
   NodePtr next;
   NodePtr head_old;
   NodePtr tail_old;
   while (true) {
-    head_old = head_->load();
+    head_old = guard->Load(0, head_);
     tail_old = tail_->load();
     next = head_old.value()->next();
+    // The node after the head is only removed once the head moved past it.
+    guard->Protect(1, next.value());
     if (head_old == head_->load()) {
       if (head_old == tail_old) {
         if (next.value() == NULL) {
@@ -216,13 +233,13 @@ typename detail::Node<T>::NodePtr SegmentQueue<T>::get_head() {
 }
 
 
-template<typename T>
-void SegmentQueue<T>::tail_segment_create(
-    const typename detail::Node<T>::NodePtr& my_tail) {
+template<typename T, class R>
+void SegmentQueue<T, R>::tail_segment_create(
+    const typename sq_detail::Node<T>::NodePtr& my_tail, Guard* guard) {
   NodePtr tail_old;
   NodePtr next;
   while (true) {
-    tail_old = tail_->load();
+    tail_old = guard->Load(3, tail_);
     next = tail_old.value()->next();
     if (tail_old == tail_->load()) {
       if (next.value() == NULL) {
@@ -244,14 +261,14 @@ void SegmentQueue<T>::tail_segment_create(
 }
 
 
-template<typename T>
-void SegmentQueue<T>::head_segment_remove(
-    const typename detail::Node<T>::NodePtr& my_head) {
+template<typename T, class R>
+void SegmentQueue<T, R>::head_segment_remove(
+    const typename sq_detail::Node<T>::NodePtr& my_head, Guard* guard) {
   NodePtr head_old;
   NodePtr tail_old;
   NodePtr next;
   while (true) {
-    head_old = head_->load();
+    head_old = guard->Load(0, head_);
     tail_old = tail_->load();
     next = head_old.value()->next();
     if (head_old == head_->load()) {
@@ -265,7 +282,9 @@ void SegmentQueue<T>::head_segment_remove(
         if (next == my_head) {
           // Still the same, let's push the sentinel by one.
           NodePtr new_head(next.value(), head_old.tag() + 1);
-          head_->swap(head_old, new_head);
+          if (head_->swap(head_old, new_head)) {
+            guard->Retire(head_old.value(), ReclaimObject<Node>);
+          }
         }
         return;  // someone else made it
       }
@@ -0,0 +1,97 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A binary min-heap for single-threaded use, e.g., as component of the
+// concurrent priority queues. The array grows by doubling and never shrinks.
+
+#ifndef SCAL_DATASTRUCTURES_SEQUENTIAL_HEAP_H_
+#define SCAL_DATASTRUCTURES_SEQUENTIAL_HEAP_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace scal {
+
+template<typename T>
+class SequentialHeap {
+ public:
+  SequentialHeap() : items_(NULL), size_(0), capacity_(0) {}
+
+  inline bool empty() const { return size_ == 0; }
+  inline uint64_t size() const { return size_; }
+
+  // Must not be called on an empty heap.
+  inline T min() const { return items_[0]; }
+
+  void insert(T item);
+  bool delete_min(T* item);
+
+  // Removes all items.
+  inline void clear() { size_ = 0; }
+
+  // Items in no particular order.
+  inline const T* items() const { return items_; }
+
+ private:
+  static const uint64_t kInitialCapacity = 64;
+
+  T* items_;
+  uint64_t size_;
+  uint64_t capacity_;
+};
+
+
+template<typename T>
+void SequentialHeap<T>::insert(T item) {
+  if (size_ == capacity_) {
+    capacity_ = (capacity_ == 0) ? kInitialCapacity : 2 * capacity_;
+    items_ = static_cast<T*>(realloc(items_, capacity_ * sizeof(T)));
+    if (items_ == NULL) {
+      fprintf(stderr, "%s: realloc failed\n", __func__);
+      abort();
+    }
+  }
+  uint64_t pos = size_++;
+  while (pos > 0) {
+    const uint64_t parent = (pos - 1) / 2;
+    if (!(item < items_[parent])) {
+      break;
+    }
+    items_[pos] = items_[parent];
+    pos = parent;
+  }
+  items_[pos] = item;
+}
+
+
+template<typename T>
+bool SequentialHeap<T>::delete_min(T* item) {
+  if (size_ == 0) {
+    return false;
+  }
+  *item = items_[0];
+  const T last = items_[--size_];
+  uint64_t pos = 0;
+  while (true) {
+    uint64_t child = 2 * pos + 1;
+    if (child >= size_) {
+      break;
+    }
+    if ((child + 1 < size_) && (items_[child + 1] < items_[child])) {
+      child++;
+    }
+    if (!(items_[child] < last)) {
+      break;
+    }
+    items_[pos] = items_[child];
+    pos = child;
+  }
+  items_[pos] = last;
+  return true;
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_SEQUENTIAL_HEAP_H_
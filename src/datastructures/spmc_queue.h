@@ -0,0 +1,215 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A single-producer/multi-consumer variant of the Michael-Scott queue
+// (datastructures/ms_queue.h).
+//
+// Only a single thread, the owner, may enqueue; any thread may dequeue. The
+// owner keeps the tail privately and links new nodes with a plain store, so
+// enqueues do not need any CAS. Dequeuers take nodes with a CAS on the head
+// as in the MS queue. The tail is only ever read by the owner, hence
+// dequeuers cannot help with (or be delayed by) a lagging tail.
+//
+// The put state is a counter that the owner bumps after every enqueue.
+
+#ifndef SCAL_DATASTRUCTURES_SPMC_QUEUE_H_
+#define SCAL_DATASTRUCTURES_SPMC_QUEUE_H_
+
+#include <inttypes.h>
+
+#include <atomic>
+#include <new>
+
+#include "datastructures/distributed_data_structure_interface.h"
+#include "datastructures/queue.h"
+#include "util/allocation.h"
+#include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
+#include "util/platform.h"
+#include "util/reclamation.h"
+#include "util/threadlocals.h"
+
+namespace scal {
+
+namespace spmc_detail {
+
+template<typename S>
+struct QueueNode : ThreadLocalMemory<64> {
+  explicit QueueNode(S item) : next(NULL), value(item) {}
+
+  std::atomic<QueueNode<S>*> next;
+  S value;
+};
+
+}  // namespace spmc_detail
+
+
+template<typename T, class Stats = DsStats, class R = Reclamation>
+class SpmcQueue : public Queue<T> {
+ public:
+  SpmcQueue();
+
+  // Must only be called by the owner.
+  bool enqueue(T item);
+  bool put_batch(const T* items, size_t num);
+
+  bool dequeue(T *item);
+
+  inline State put_state() {
+    return puts_.load();
+  }
+
+  bool get_return_put_state(T* item, State* put_state);
+
+  bool empty();
+
+ private:
+  typedef spmc_detail::QueueNode<T> Node;
+  typedef TaggedValue<Node*> NodePtr;
+  typedef AtomicTaggedValue<Node*, scal::kCachePrefetch> AtomicNodePtr;
+  typedef typename R::Guard Guard;
+
+  // Reads the successor of the head into *next, protecting it in slot 1.
+  // Returns false if the head moved in between.
+  _always_inline bool LoadNext(Guard* guard, NodePtr head_old, Node** next);
+
+  // Returns true if the head has been moved from head_old to next.
+  _always_inline bool TryTake(Guard* guard, NodePtr head_old, Node* next);
+
+  AtomicNodePtr* head_;
+  uint8_t pad1_[kCachePrefetch - sizeof(AtomicNodePtr*)];
+  // Owner only.
+  Node* tail_;
+  std::atomic<uint64_t> puts_;
+  uint8_t pad2_[kCachePrefetch - sizeof(Node*) - sizeof(uint64_t)];
+};
+
+
+template<typename T, class Stats, class R>
+SpmcQueue<T, Stats, R>::SpmcQueue()
+    : head_(new AtomicNodePtr()),
+      tail_(new Node(static_cast<T>(NULL))),
+      puts_(0) {
+  head_->store(NodePtr(tail_, 0));
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::enqueue(T item) {
+  Node* node = new Node(item);
+  // The tail cannot be retired before it has a successor, i.e., before the
+  // store below.
+  tail_->next.store(node, std::memory_order_release);
+  tail_ = node;
+  puts_.store(puts_.load(std::memory_order_relaxed) + 1,
+              std::memory_order_release);
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::put_batch(const T* items, size_t num) {
+  if (num == 0) {
+    return true;
+  }
+  Node* first = new Node(items[0]);
+  Node* last = first;
+  for (size_t i = 1; i < num; i++) {
+    Node* node = new Node(items[i]);
+    last->next.store(node, std::memory_order_relaxed);
+    last = node;
+  }
+  tail_->next.store(first, std::memory_order_release);
+  tail_ = last;
+  puts_.store(puts_.load(std::memory_order_relaxed) + 1,
+              std::memory_order_release);
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::LoadNext(
+    Guard* guard, NodePtr head_old, Node** next) {
+  *next = head_old.value()->next.load(std::memory_order_acquire);
+  if (R::kHazards && (*next != NULL)) {
+    // Nodes only get retired after the head moved past them.
+    guard->Protect(1, *next);
+    if (head_->load() != head_old) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::TryTake(
+    Guard* guard, NodePtr head_old, Node* next) {
+  if (Stats::Cas(head_->swap(head_old, NodePtr(next, head_old.tag() + 1)))) {
+    guard->Retire(head_old.value(), ReclaimObject<Node>);
+    return true;
+  }
+  return false;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::dequeue(T* item) {
+  Guard guard;
+  NodePtr head_old;
+  Node* next;
+  while (true) {
+    Stats::Count(kLoopIterations);
+    head_old = guard.Load(0, head_);
+    if (!LoadNext(&guard, head_old, &next)) {
+      continue;
+    }
+    if (next == NULL) {
+      return false;
+    }
+    *item = next->value;
+    if (TryTake(&guard, head_old, next)) {
+      return true;
+    }
+  }
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::get_return_put_state(T* item, State* put_state) {
+  Guard guard;
+  NodePtr head_old;
+  Node* next;
+  while (true) {
+    Stats::Count(kLoopIterations);
+    // Read before looking for a successor: An enqueue that is missed below
+    // bumps the counter afterwards.
+    const State puts = puts_.load();
+    head_old = guard.Load(0, head_);
+    if (!LoadNext(&guard, head_old, &next)) {
+      continue;
+    }
+    if (next == NULL) {
+      *put_state = puts;
+      return false;
+    }
+    *item = next->value;
+    if (TryTake(&guard, head_old, next)) {
+      *put_state = puts;
+      return true;
+    }
+  }
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcQueue<T, Stats, R>::empty() {
+  Guard guard;
+  NodePtr head_old = guard.Load(0, head_);
+  return head_old.value()->next.load() == NULL;
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_SPMC_QUEUE_H_
@@ -0,0 +1,188 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// A single-producer/multi-consumer variant of the Treiber stack
+// (datastructures/treiber_stack.h).
+//
+// Only a single thread, the owner, may push; any thread may pop. Since pops
+// move the top as well, a push cannot be a plain store. Instead the owner
+// swaps its node in with a single exchange that never fails and links the
+// node to the old top afterwards. A pop that finds the top not linked yet
+// waits for the owner to finish its push.
+//
+// The tag of the top counts pushes and is left untouched by pops, i.e., it
+// is the put state. Pops do not need a tag to avoid ABA: a node cannot be
+// pushed again while a popping thread may still access it.
+
+#ifndef SCAL_DATASTRUCTURES_SPMC_STACK_H_
+#define SCAL_DATASTRUCTURES_SPMC_STACK_H_
+
+#include <inttypes.h>
+
+#include <atomic>
+
+#include "datastructures/distributed_data_structure_interface.h"
+#include "datastructures/stack.h"
+#include "util/allocation.h"
+#include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
+#include "util/platform.h"
+#include "util/reclamation.h"
+
+namespace scal {
+
+namespace spmc_detail {
+
+template<typename S>
+struct StackNode : ThreadLocalMemory<64> {
+  explicit StackNode(S item) : next(NULL), data(item) {}
+
+  std::atomic<StackNode<S>*> next;
+  S data;
+};
+
+}  // namespace spmc_detail
+
+
+template<typename T, class Stats = DsStats, class R = Reclamation>
+class SpmcStack : public Stack<T> {
+ public:
+  SpmcStack();
+
+  // Must only be called by the owner.
+  bool push(T item);
+  bool put_batch(const T* items, size_t num);
+
+  bool pop(T *item);
+
+  inline bool put(T item) {
+    return push(item);
+  }
+
+  inline State put_state() {
+    return top_->load().tag();
+  }
+
+  inline bool empty() {
+    return top_->load().value() == NULL;
+  }
+
+  bool get_return_put_state(T *item, State* put_state);
+
+ private:
+  typedef spmc_detail::StackNode<T> Node;
+  typedef TaggedValue<Node*> NodePtr;
+  typedef AtomicTaggedValue<Node*, 64, 64> AtomicNodePtr;
+  typedef typename R::Guard Guard;
+
+  // Marks the next pointer of a node that is on top but not linked yet.
+  static Node* Unlinked() {
+    return reinterpret_cast<Node*>(1);
+  }
+
+  static _always_inline Node* WaitForLink(Node* node) {
+    Node* next;
+    while ((next = node->next.load(std::memory_order_acquire)) == Unlinked()) {
+      __asm__ __volatile__("pause");
+    }
+    return next;
+  }
+
+  // Swaps [top, bottom] in as the new top.
+  _always_inline void Publish(Node* top, Node* bottom);
+
+  _always_inline bool TryPop(Guard* guard, T* item, NodePtr* top_old);
+
+  AtomicNodePtr* top_;
+  // Owner only.
+  uint64_t pushes_;
+};
+
+
+template<typename T, class Stats, class R>
+SpmcStack<T, Stats, R>::SpmcStack() : top_(new AtomicNodePtr()), pushes_(0) {
+}
+
+
+template<typename T, class Stats, class R>
+void SpmcStack<T, Stats, R>::Publish(Node* top, Node* bottom) {
+  bottom->next.store(Unlinked(), std::memory_order_relaxed);
+  const NodePtr top_old = top_->exchange(NodePtr(top, ++pushes_));
+  bottom->next.store(top_old.value(), std::memory_order_release);
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcStack<T, Stats, R>::push(T item) {
+  Node* n = new Node(item);
+  Publish(n, n);
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcStack<T, Stats, R>::put_batch(const T* items, size_t num) {
+  if (num == 0) {
+    return true;
+  }
+  Node* bottom = new Node(items[0]);
+  Node* top = bottom;
+  for (size_t i = 1; i < num; i++) {
+    Node* n = new Node(items[i]);
+    n->next.store(top, std::memory_order_relaxed);
+    top = n;
+  }
+  Publish(top, bottom);
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcStack<T, Stats, R>::TryPop(Guard* guard, T* item, NodePtr* top_old) {
+  Stats::Count(kLoopIterations);
+  *top_old = guard->Load(0, top_);
+  Node* node = top_old->value();
+  if (node == NULL) {
+    return false;
+  }
+  Node* next = WaitForLink(node);
+  if (Stats::Cas(top_->swap(*top_old, NodePtr(next, top_old->tag())))) {
+    *item = node->data;
+    guard->Retire(node, ReclaimObject<Node>);
+    return true;
+  }
+  return false;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcStack<T, Stats, R>::pop(T *item) {
+  Guard guard;
+  NodePtr top_old;
+  while (!TryPop(&guard, item, &top_old)) {
+    if (top_old.value() == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+template<typename T, class Stats, class R>
+bool SpmcStack<T, Stats, R>::get_return_put_state(T* item, State* put_state) {
+  Guard guard;
+  NodePtr top_old;
+  while (!TryPop(&guard, item, &top_old)) {
+    if (top_old.value() == NULL) {
+      *put_state = top_old.tag();
+      return false;
+    }
+  }
+  *put_state = top_old.tag();
+  return true;
+}
+
+}  // namespace scal
+
+#endif  // SCAL_DATASTRUCTURES_SPMC_STACK_H_
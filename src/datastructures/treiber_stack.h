@@ -14,11 +14,13 @@
 #include "datastructures/stack.h"
 #include "util/allocation.h"
 #include "util/atomic_value_new.h"
+#include "util/ds_stats.h"
 #include "util/platform.h"
+#include "util/reclamation.h"
 
 namespace scal {
 
-namespace detail {
+namespace treiber_detail {
 
 template<typename T>
 struct Node : ThreadLocalMemory<64> {
@@ -28,16 +30,22 @@ struct Node : ThreadLocalMemory<64> {
   T data;
 };
 
-}  // namespace detail
+}  // namespace treiber_detail
 
 
-template<typename T>
+template<typename T, class Stats = DsStats, class R = Reclamation>
 class TreiberStack : public Stack<T> {
  public:
   TreiberStack();
   bool push(T item);
   bool pop(T *item);
 
+  // Pushes a privately linked chain (last item on top) with a single CAS.
+  bool put_batch(const T* items, size_t num);
+
+  // Pops up to max items with a single CAS.
+  size_t get_batch(T* items, size_t max);
+
   bool try_push(T item, uint64_t top_old_tag);
   uint8_t try_pop(T *item, uint64_t top_old_tag, State* put_state);
 
@@ -58,53 +66,128 @@ class TreiberStack : public Stack<T> {
   inline bool get_return_put_state(T *item, State* put_state);
 
  private:
-  typedef detail::Node<T> Node;
+  typedef treiber_detail::Node<T> Node;
   typedef TaggedValue<Node*> NodePtr;
   typedef AtomicTaggedValue<Node*, 64, 64> AtomicNodePtr;
+  typedef typename R::Guard Guard;
 
   AtomicNodePtr* top_;
 };
 
 
-template<typename T>
-TreiberStack<T>::TreiberStack() : top_(new AtomicNodePtr()) {
+template<typename T, class Stats, class R>
+TreiberStack<T, Stats, R>::TreiberStack() : top_(new AtomicNodePtr()) {
 }
 
 
-template<typename T>
-bool TreiberStack<T>::push(T item) {
+template<typename T, class Stats, class R>
+bool TreiberStack<T, Stats, R>::push(T item) {
   Node* n = new Node(item);
   NodePtr top_old;
   NodePtr top_new;
   do {
+    Stats::Count(kLoopIterations);
     top_old = top_->load();
     n->next = top_old.value();
     top_new = NodePtr(n, top_old.tag() + 1);
-  } while (!top_->swap(top_old, top_new));
+  } while (!Stats::Cas(top_->swap(top_old, top_new)));
   return true;
 }
 
 
-template<typename T>
-bool TreiberStack<T>::pop(T *item) {
+template<typename T, class Stats, class R>
+bool TreiberStack<T, Stats, R>::pop(T *item) {
+  Guard guard;
   NodePtr top_old;
   NodePtr top_new;
   do {
-    top_old = top_->load();
+    Stats::Count(kLoopIterations);
+    top_old = guard.Load(0, top_);
     if (top_old.value() == NULL) {
       return false;
     }
     top_new = NodePtr(top_old.value()->next, top_old.tag() + 1);
-  } while (!top_->swap(top_old, top_new));
+  } while (!Stats::Cas(top_->swap(top_old, top_new)));
   *item = top_old.value()->data;
+  guard.Retire(top_old.value(), ReclaimObject<Node>);
+  return true;
+}
+
+template<typename T, class Stats, class R>
+bool TreiberStack<T, Stats, R>::put_batch(const T* items, size_t num) {
+  if (num == 0) {
+    return true;
+  }
+  Node* bottom = new Node(items[0]);
+  Node* top = bottom;
+  for (size_t i = 1; i < num; i++) {
+    Node* n = new Node(items[i]);
+    n->next = top;
+    top = n;
+  }
+  NodePtr top_old;
+  NodePtr top_new;
+  do {
+    Stats::Count(kLoopIterations);
+    top_old = top_->load();
+    bottom->next = top_old.value();
+    top_new = NodePtr(top, top_old.tag() + 1);
+  } while (!Stats::Cas(top_->swap(top_old, top_new)));
   return true;
 }
 
+
+template<typename T, class Stats, class R>
+size_t TreiberStack<T, Stats, R>::get_batch(T* items, size_t max) {
+  Guard guard;
+  NodePtr top_old;
+  NodePtr top_new;
+  size_t num;
+  if (max == 0) {
+    return 0;
+  }
+  while (true) {
+    Stats::Count(kLoopIterations);
+    top_old = guard.Load(0, top_);
+    if (top_old.value() == NULL) {
+      return 0;
+    }
+    Node* node = top_old.value();
+    num = 0;
+    items[num++] = node->data;
+    while ((num < max) && (node->next != NULL)) {
+      node = node->next;
+      if (R::kHazards) {
+        // Nodes only get popped after the top moved past them.
+        guard.Protect(1 + (num % 2), node);
+        if (top_->load() != top_old) {
+          break;
+        }
+      }
+      items[num++] = node->data;
+    }
+    if (R::kHazards && (top_->load() != top_old)) {
+      continue;
+    }
+    top_new = NodePtr(node->next, top_old.tag() + 1);
+    if (Stats::Cas(top_->swap(top_old, top_new))) {
+      break;
+    }
+  }
+  Node* popped = top_old.value();
+  for (size_t i = 0; i < num; i++) {
+    Node* next = popped->next;
+    guard.Retire(popped, ReclaimObject<Node>);
+    popped = next;
+  }
+  return num;
+}
+
 // Tailored for the LRU distributed stack implementation.
 // Using only 8 bit of the top pointers tag as ABA count 
 // for put operations.
-template<typename T>
-bool TreiberStack<T>::try_push(T item, uint64_t top_old_tag) {
+template<typename T, class Stats, class R>
+bool TreiberStack<T, Stats, R>::try_push(T item, uint64_t top_old_tag) {
   Node* n = new Node(item);
   NodePtr top_old;
   NodePtr top_new;
@@ -123,7 +206,7 @@ bool TreiberStack<T>::try_push(T item, uint64_t top_old_tag) {
     }
 
     top_new = NodePtr(n, (put_tag << 8) ^ get_tag);
-    if (top_->swap(top_old, top_new)) {
+    if (Stats::Cas(top_->swap(top_old, top_new))) {
       return true;
     }
   }
@@ -133,12 +216,13 @@ bool TreiberStack<T>::try_push(T item, uint64_t top_old_tag) {
 // Tailored for the LRU distributed stack implementation.
 // Using only 8 bit of the top pointers tag as ABA count 
 // for get operations.
-template<typename T>
-uint8_t TreiberStack<T>::try_pop(
+template<typename T, class Stats, class R>
+uint8_t TreiberStack<T, Stats, R>::try_pop(
     T *item, uint64_t top_old_tag, State* put_state) {
+  Guard guard;
   NodePtr top_old;
   NodePtr top_new;
-  top_old = top_->load();
+  top_old = guard.Load(0, top_);
 
   uint16_t tag_old = top_old.tag();
   uint16_t put_tag = tag_old >> 8;
@@ -156,27 +240,31 @@ uint8_t TreiberStack<T>::try_pop(
     }
 
     top_new = NodePtr(top_old.value()->next, (put_tag << 8) ^ get_tag);
-    if (top_->swap(top_old, top_new)) {
+    if (Stats::Cas(top_->swap(top_old, top_new))) {
       *item = top_old.value()->data;
+      guard.Retire(top_old.value(), ReclaimObject<Node>);
       return 0;
     }
   }
   return 2;
 }
 
-template<typename T>
-bool TreiberStack<T>::get_return_put_state(T* item, State* put_state) {
+template<typename T, class Stats, class R>
+bool TreiberStack<T, Stats, R>::get_return_put_state(T* item, State* put_state) {
+  Guard guard;
   NodePtr top_old;
   NodePtr top_new;
   do {
-    top_old = top_->load();
+    Stats::Count(kLoopIterations);
+    top_old = guard.Load(0, top_);
     if (top_old.value() == NULL) {
       *put_state = top_old.tag();
       return false;
     }
     top_new = NodePtr(top_old.value()->next, top_old.tag() + 1);
-  } while (!top_->swap(top_old, top_new));
+  } while (!Stats::Cas(top_->swap(top_old, top_new)));
   *item = top_old.value()->data;
+  guard.Retire(top_old.value(), ReclaimObject<Node>);
   *put_state = top_old.tag();
   return true;
 }
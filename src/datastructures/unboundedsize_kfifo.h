@@ -20,11 +20,12 @@
 #include "util/atomic_value_new.h"
 #include "util/platform.h"
 #include "util/random.h"
+#include "util/reclamation.h"
 #include "util/threadlocals.h"
 
 namespace scal {
 
-namespace detail {
+namespace kfifo_detail {
 
 template<typename T>
 class KSegment : public ThreadLocalMemory<64> {
@@ -43,6 +44,10 @@ class KSegment : public ThreadLocalMemory<64> {
                 k, sizeof(AtomicItem), 64))) {
   }
 
+  _always_inline ~KSegment() {
+    ThreadLocalAllocator::Free(items_);
+  }
+
   _always_inline uint64_t k() { return k_; }
   _always_inline uint8_t deleted() { return deleted_; }
   _always_inline void set_deleted() { deleted_ = 1; }
@@ -70,10 +75,10 @@ class KSegment : public ThreadLocalMemory<64> {
   AtomicItem* items_;
 };
 
-}  // namespace detail
+}  // namespace kfifo_detail
 
 
-template<typename T>
+template<typename T, class R = Reclamation>
 class UnboundedSizeKFifo : public Queue<T> {
  public:
   explicit UnboundedSizeKFifo(uint64_t k);
@@ -81,13 +86,14 @@ class UnboundedSizeKFifo : public Queue<T> {
   bool dequeue(T *item);
 
  private:
-  typedef detail::KSegment<T> KSegment;
+  typedef kfifo_detail::KSegment<T> KSegment;
   typedef typename KSegment::SegmentPtr SegmentPtr;
   typedef typename KSegment::Item Item;
   typedef typename KSegment::AtomicItem AtomicItem;
   typedef AtomicTaggedValue<KSegment*, 4096, 4096> AtomicSegmentPtr;
+  typedef typename R::Guard Guard;
 
-  _always_inline void advance_head(const SegmentPtr& head_old);
+  _always_inline void advance_head(const SegmentPtr& head_old, Guard* guard);
   _always_inline void advance_tail(const SegmentPtr& tail_old);
   _always_inline bool find_index(
       KSegment* const start_index, bool empty, int64_t *item_index, Item* old);
@@ -116,8 +122,8 @@ class UnboundedSizeKFifo : public Queue<T> {
 };
 
 
-template<typename T>
-UnboundedSizeKFifo<T>::UnboundedSizeKFifo(uint64_t k)
+template<typename T, class R>
+UnboundedSizeKFifo<T, R>::UnboundedSizeKFifo(uint64_t k)
     : k_(k) {
   const SegmentPtr new_segment(new KSegment(k_), 0);
   head_ = new AtomicSegmentPtr(new_segment);
@@ -125,11 +131,12 @@ UnboundedSizeKFifo<T>::UnboundedSizeKFifo(uint64_t k)
 }
 
 
-template<typename T>
-void UnboundedSizeKFifo<T>::advance_head(const SegmentPtr& head_old) {
+template<typename T, class R>
+void UnboundedSizeKFifo<T, R>::advance_head(
+    const SegmentPtr& head_old, Guard* guard) {
   const SegmentPtr head_current = head_->load();
   if (head_current == head_old) {
-    const SegmentPtr tail_current = tail_->load();
+    const SegmentPtr tail_current = guard->Load(2, tail_);
     const SegmentPtr tail_next_ksegment = tail_current.value()->next();
     const SegmentPtr head_next_ksegment = head_current.value()->next();
     if (head_current == head_->load()) {
@@ -143,15 +150,17 @@ void UnboundedSizeKFifo<T>::advance_head(const SegmentPtr& head_old) {
         }
       }
       head_old.value()->set_deleted();
-      head_->swap(
-          head_old, SegmentPtr(head_next_ksegment.value(), head_old.tag() + 1));
+      if (head_->swap(head_old, SegmentPtr(head_next_ksegment.value(),
+                                           head_old.tag() + 1))) {
+        guard->Retire(head_old.value(), ReclaimObject<KSegment>);
+      }
     }
   }
 }
 
 
-template<typename T>
-void UnboundedSizeKFifo<T>::advance_tail(const SegmentPtr& tail_old) {
+template<typename T, class R>
+void UnboundedSizeKFifo<T, R>::advance_tail(const SegmentPtr& tail_old) {
   const SegmentPtr tail_current = tail_->load();
   SegmentPtr next_ksegment;
   if (tail_current == tail_old) {
@@ -175,9 +184,9 @@ void UnboundedSizeKFifo<T>::advance_tail(const SegmentPtr& tail_old) {
 }
 
 
-template<typename T>
-bool UnboundedSizeKFifo<T>::find_index(
-    detail::KSegment<T>* const start_index, bool empty, int64_t *item_index,
+template<typename T, class R>
+bool UnboundedSizeKFifo<T, R>::find_index(
+    kfifo_detail::KSegment<T>* const start_index, bool empty, int64_t *item_index,
     Item* old) {
   const uint64_t k = start_index->k();
   const uint64_t random_index = hwrand() % k;
@@ -195,8 +204,8 @@ bool UnboundedSizeKFifo<T>::find_index(
 }
 
 
-template<typename T>
-bool UnboundedSizeKFifo<T>::committed(
+template<typename T, class R>
+bool UnboundedSizeKFifo<T, R>::committed(
     const SegmentPtr& tail_old, const Item& new_item, uint64_t item_index) {
   if (tail_old.value()->item(item_index) != new_item) {
     return true;
@@ -236,17 +245,18 @@ bool UnboundedSizeKFifo<T>::committed(
 }
 
 
-template<typename T>
-bool UnboundedSizeKFifo<T>::dequeue(T *item) {
+template<typename T, class R>
+bool UnboundedSizeKFifo<T, R>::dequeue(T *item) {
   SegmentPtr tail_old;
   SegmentPtr head_old;
   int64_t item_index = 0;
   Item old_item;
   bool found_idx;
+  Guard guard;
   while (true) {
-    head_old = head_->load();
+    head_old = guard.Load(0, head_);
     found_idx = find_index(head_old.value(), false, &item_index, &old_item);
-    tail_old = tail_->load();
+    tail_old = guard.Load(1, tail_);
     if (head_old == head_->load()) {
       if (found_idx) {
         if (head_old.value() == tail_old.value()) {
@@ -262,15 +272,15 @@ bool UnboundedSizeKFifo<T>::dequeue(T *item) {
             (tail_old == tail_->load())) {
           return false;
         }
-        advance_head(head_old);
+        advance_head(head_old, &guard);
       }
     }
   }
 }
 
 
-template<typename T>
-bool UnboundedSizeKFifo<T>::enqueue(T item) {
+template<typename T, class R>
+bool UnboundedSizeKFifo<T, R>::enqueue(T item) {
   TaggedValue<T>::CheckCompatibility(item);
   if (item == (T)NULL) {
     printf("%s: unable to enqueue NULL or equivalent value\n", __func__);
@@ -281,8 +291,9 @@ bool UnboundedSizeKFifo<T>::enqueue(T item) {
   int64_t item_index = 0;
   Item old_item;
   bool found_idx;
+  Guard guard;
   while (true) {
-    tail_old = tail_->load();
+    tail_old = guard.Load(1, tail_);
 #ifdef LOCALLY_LINEARIZABLE
     if (IsLastSegment(tail_old)) {
       advance_tail(tail_old);
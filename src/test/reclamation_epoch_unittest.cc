@@ -0,0 +1,119 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Stress test for epoch-based reclamation: Threads concurrently put unique
+// items into and get items from a queue or stack whose unlinked nodes are
+// reclaimed (and recycled by the thread-local allocator). Reclaiming a node
+// that another thread still accesses shows up as lost or duplicated items.
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+#include "datastructures/ms_queue.h"
+#include "datastructures/treiber_stack.h"
+#include "util/allocation.h"
+#include "util/reclamation.h"
+#include "util/threadlocals.h"
+
+namespace {
+
+const uint64_t kThreads = 8;
+// Every test starts new threads, which get new thread contexts.
+const uint64_t kTests = 2;
+const uint64_t kItemsPerThread = 100000;
+const size_t kPreallocPages = 1024;
+
+template<class DS>
+struct StressArg {
+  DS* ds;
+  uint64_t id;
+  std::atomic<uint64_t>* ready;
+  // Number of times every item has been taken out.
+  std::vector<std::atomic<uint8_t> >* seen;
+};
+
+
+template<class DS>
+void* StressThread(void* ptr) {
+  StressArg<DS>* arg = static_cast<StressArg<DS>*>(ptr);
+  scal::ThreadContext::assign_context();
+  scal::ThreadLocalAllocator::Get().Init(kPreallocPages, false);
+  arg->ready->fetch_add(1);
+  while (arg->ready->load() < kThreads) {
+  }
+  // Every thread puts its own items and takes out the same number of items.
+  uint64_t taken = 0;
+  for (uint64_t i = 0; i < kItemsPerThread; i++) {
+    // Items are never 0.
+    EXPECT_TRUE(arg->ds->put(arg->id * kItemsPerThread + i + 1));
+    uint64_t item;
+    if (arg->ds->get(&item)) {
+      (*arg->seen)[item - 1].fetch_add(1);
+      taken++;
+    }
+  }
+  while (taken < kItemsPerThread) {
+    uint64_t item;
+    if (arg->ds->get(&item)) {
+      (*arg->seen)[item - 1].fetch_add(1);
+      taken++;
+    }
+  }
+  return NULL;
+}
+
+
+template<class DS>
+void Stress(DS* ds) {
+  std::atomic<uint64_t> ready(0);
+  std::vector<std::atomic<uint8_t> > seen(kThreads * kItemsPerThread);
+  for (size_t i = 0; i < seen.size(); i++) {
+    seen[i].store(0);
+  }
+  std::vector<pthread_t> threads(kThreads);
+  std::vector<StressArg<DS> > args(kThreads);
+  for (uint64_t i = 0; i < kThreads; i++) {
+    args[i].ds = ds;
+    args[i].id = i;
+    args[i].ready = &ready;
+    args[i].seen = &seen;
+    ASSERT_EQ(0, pthread_create(&threads[i], NULL, StressThread<DS>,
+                                &args[i]));
+  }
+  for (uint64_t i = 0; i < kThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  uint64_t item;
+  EXPECT_FALSE(ds->get(&item));
+  for (size_t i = 0; i < seen.size(); i++) {
+    ASSERT_EQ(1, seen[i].load()) << "item " << (i + 1);
+  }
+}
+
+
+class EpochReclamationTest : public testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    scal::ThreadContext::prepare(kTests * kThreads + 1);
+    scal::ThreadContext::assign_context();
+    scal::ThreadLocalAllocator::Get().Init(kPreallocPages, false);
+  }
+};
+
+}  // namespace
+
+
+TEST_F(EpochReclamationTest, MSQueue) {
+  Stress(new scal::MSQueue<uint64_t, scal::DsStats,
+                           scal::EpochReclamation>());
+}
+
+
+TEST_F(EpochReclamationTest, TreiberStack) {
+  Stress(new scal::TreiberStack<uint64_t, scal::DsStats,
+                                scal::EpochReclamation>());
+}
@@ -5,17 +5,485 @@
 #include "util/allocation.h"
 
 #include <gflags/gflags.h>
+#include <linux/mempolicy.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
-DEFINE_bool(reuse_memory, true, "reuse memory, no matter what");
+#include <atomic>
+
+DEFINE_bool(reuse_memory, true,
+            "deprecated: arenas are chained instead of reset on overflowing");
 DEFINE_bool(warn_on_overflow, false, "print a warning on overflowing");
+DEFINE_string(arena_pages, "default", "pages backing thread-local arenas: "
+              "default, thp (transparent huge pages), or hugetlb (reserved "
+              "huge pages, falling back to thp)");
+DEFINE_bool(arena_numa_local, false, "bind thread-local arenas to the NUMA "
+            "node of the thread allocating them");
+DEFINE_string(prefault, "pages", "fault in thread-local memory on "
+              "initialization: pages (write one word per page), words (write "
+              "every word), populate (MAP_POPULATE), or none");
 
 namespace scal {
 
+namespace {
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+enum ArenaPages {
+  kDefaultPages = 0,
+  kTransparentHugePages,
+  kHugeTlbPages
+};
+
+enum Prefault {
+  kPrefaultNone = 0,
+  kPrefaultPages,
+  kPrefaultWords,
+  kPrefaultPopulate
+};
+
+std::atomic<uint64_t> g_arenas(0);
+std::atomic<uint64_t> g_arena_bytes(0);
+std::atomic<uint64_t> g_hugetlb_fallbacks(0);
+std::atomic<uint64_t> g_mbind_failures(0);
+std::atomic<uint64_t> g_prefault_ns_max(0);
+
+
+ArenaPages ParseArenaPages() {
+  if (FLAGS_arena_pages == "default") {
+    return kDefaultPages;
+  } else if (FLAGS_arena_pages == "thp") {
+    return kTransparentHugePages;
+  } else if (FLAGS_arena_pages == "hugetlb") {
+    return kHugeTlbPages;
+  }
+  fprintf(stderr, "unknown --arena_pages: %s\n", FLAGS_arena_pages.c_str());
+  abort();
+}
+
+
+Prefault ParsePrefault() {
+  if (FLAGS_prefault == "none") {
+    return kPrefaultNone;
+  } else if (FLAGS_prefault == "pages") {
+    return kPrefaultPages;
+  } else if (FLAGS_prefault == "words") {
+    return kPrefaultWords;
+  } else if (FLAGS_prefault == "populate") {
+    return kPrefaultPopulate;
+  }
+  fprintf(stderr, "unknown --prefault: %s\n", FLAGS_prefault.c_str());
+  abort();
+}
+
+
+uint64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+
+void TouchPages(char* mem, size_t size) {
+  for (size_t i = 0; i < size; i += kPageSize) {
+    reinterpret_cast<volatile intptr_t*>(mem + i)[0] = 0;
+  }
+}
+
+
+void BindToLocalNode(void* mem, size_t size) {
+  unsigned cpu;
+  unsigned node;
+  unsigned long mask[16] = { 0 };  // NOLINT
+  if ((syscall(SYS_getcpu, &cpu, &node, NULL) != 0) ||
+      (node >= sizeof(mask) * 8)) {
+    g_mbind_failures++;
+    return;
+  }
+  mask[node / 64] = 1UL << (node % 64);
+  if (syscall(SYS_mbind, mem, size, MPOL_BIND, mask, sizeof(mask) * 8, 0)
+      != 0) {
+    // E.g. kernels without NUMA support.
+    g_mbind_failures++;
+  }
+}
+
+
+// Maps an arena of at least *size bytes (returning the actual size in *size)
+// that is aligned to spans.
+intptr_t MapArena(size_t* size, bool prefault) {
+  static const ArenaPages configured_pages = ParseArenaPages();
+  static const Prefault prefault_mode = ParsePrefault();
+  ArenaPages pages = configured_pages;
+  const size_t alignment = (pages == kDefaultPages) ?
+      ThreadLocalAllocator::kSpanSize : kHugePageSize;
+  *size = RoundSize(*size, alignment);
+  // Pages have to be faulted in after binding them to a node.
+  const bool populate = prefault && (prefault_mode == kPrefaultPopulate) &&
+                        !FLAGS_arena_numa_local;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS | (populate ? MAP_POPULATE : 0);
+  const uint64_t start = NowNs();
+  char* mem = static_cast<char*>(MAP_FAILED);
+  if (pages == kHugeTlbPages) {
+    mem = static_cast<char*>(mmap(NULL, *size, PROT_READ | PROT_WRITE,
+                                  flags | MAP_HUGETLB, -1, 0));
+    if (mem == MAP_FAILED) {
+      g_hugetlb_fallbacks++;
+      pages = kTransparentHugePages;
+    }
+  }
+  if (mem == MAP_FAILED) {
+    // Over-map to align the arena and unmap the rest.
+    const size_t mapped_size = *size + alignment;
+    char* mapped = static_cast<char*>(mmap(NULL, mapped_size,
+        PROT_READ | PROT_WRITE, flags, -1, 0));
+    if (mapped == MAP_FAILED) {
+      perror("mmap");
+      abort();
+    }
+    mem = reinterpret_cast<char*>(
+        RoundSize(reinterpret_cast<uintptr_t>(mapped), alignment));
+    if (mem > mapped) {
+      munmap(mapped, mem - mapped);
+    }
+    if (mapped + mapped_size > mem + *size) {
+      munmap(mem + *size, mapped + mapped_size - (mem + *size));
+    }
+    if ((pages == kTransparentHugePages) &&
+        (madvise(mem, *size, MADV_HUGEPAGE) != 0)) {
+      perror("madvise(MADV_HUGEPAGE)");
+    }
+  }
+  if (FLAGS_arena_numa_local) {
+    BindToLocalNode(mem, *size);
+  }
+  if (prefault) {
+    switch (prefault_mode) {
+      case kPrefaultPages:
+        TouchPages(mem, *size);
+        break;
+      case kPrefaultWords:
+        for (size_t i = 0; i < (*size / sizeof(intptr_t)); i++) {
+          reinterpret_cast<volatile intptr_t*>(mem)[i] = 1;
+          reinterpret_cast<volatile intptr_t*>(mem)[i] = 0;
+        }
+        break;
+      case kPrefaultPopulate:
+        if (!populate) {
+          // The arena has been bound to a node after mapping it.
+          TouchPages(mem, *size);
+        }
+        break;
+      case kPrefaultNone:
+        break;
+    }
+    const uint64_t ns = NowNs() - start;
+    uint64_t max = g_prefault_ns_max.load();
+    while ((ns > max) && !g_prefault_ns_max.compare_exchange_weak(max, ns)) {
+    }
+  }
+  g_arenas++;
+  g_arena_bytes += *size;
+  return reinterpret_cast<intptr_t>(mem);
+}
+
+}  // namespace
+
+
 pthread_once_t tla_key_once = PTHREAD_ONCE_INIT;
 
+std::atomic<uint64_t> aligned_mallocs(0);
+std::atomic<uint64_t> aligned_malloc_bytes(0);
+
 pthread_key_t ThreadLocalAllocator::tla_key;
+std::atomic<ThreadLocalAllocator*> ThreadLocalAllocator::allocators_(NULL);
+
+const size_t ThreadLocalAllocator::kSpanSize;
+const size_t ThreadLocalAllocator::kMaxSmallSize;
+const size_t ThreadLocalAllocator::kMaxSmallAlignment;
+const size_t ThreadLocalAllocator::kSpanHeaderSize;
+const uint64_t ThreadLocalAllocator::kLargeClass;
+const uint64_t ThreadLocalAllocator::kRemoteBatch;
+
+const uint32_t ThreadLocalAllocator::kSizeClasses[kNumSizeClasses] = {
+  16, 32, 48, 64,
+  128, 192, 256,
+  384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192,
+  12288, 16384, 24576, 32768,
+};
+
+
+void* ThreadLocalAllocator::Refill(uint64_t size_class) {
+  SizeClass& state = classes_[size_class];
+  if (remote_free_.load(std::memory_order_relaxed) != NULL) {
+    DrainRemoteFrees();
+    if (state.free != NULL) {
+      void* object = state.free;
+      state.free = *static_cast<void**>(object);
+      return object;
+    }
+  }
+  const size_t size = kSizeClasses[size_class];
+  if ((state.current + static_cast<intptr_t>(size)) > state.end) {
+    const intptr_t span = NewSpans(1);
+    SpanHeader* header = reinterpret_cast<SpanHeader*>(span);
+    header->owner = this;
+    header->size_class = size_class;
+    // Spans are aligned, so blocks are aligned if the first one is.
+    state.current = span + RoundSize(kSpanHeaderSize,
+                                     ClassAlignment(size_class));
+    state.end = span + kSpanSize;
+  }
+  void* object = reinterpret_cast<void*>(state.current);
+  state.current += size;
+  return object;
+}
+
+
+void* ThreadLocalAllocator::AllocLarge(size_t size, size_t alignment) {
+  if (alignment >= kSpanSize) {
+    // The block would start at a span boundary, i.e., at the span header
+    // Free() looks up.
+    fprintf(stderr, "%s: alignment %zu not supported (has to be below %zu)\n",
+            __func__, alignment, kSpanSize);
+    abort();
+  }
+  const size_t num_spans =
+      RoundSize(kSpanHeaderSize + size + alignment, kSpanSize) / kSpanSize;
+  if (remote_free_.load(std::memory_order_relaxed) != NULL) {
+    DrainRemoteFrees();
+  }
+  // First fit.
+  intptr_t span = 0;
+  intptr_t* link = &free_runs_;
+  while (*link != 0) {
+    SpanHeader* run = reinterpret_cast<SpanHeader*>(*link);
+    if (run->run_spans >= num_spans) {
+      span = *link;
+      *link = run->next_run;
+      if (run->run_spans > num_spans) {
+        // Keep the rest of the run.
+        const intptr_t rest = span + num_spans * kSpanSize;
+        SpanHeader* rest_header = reinterpret_cast<SpanHeader*>(rest);
+        rest_header->run_start = rest;
+        rest_header->run_spans = run->run_spans - num_spans;
+        rest_header->next_run = free_runs_;
+        free_runs_ = rest;
+      }
+      break;
+    }
+    link = &run->next_run;
+  }
+  if (span == 0) {
+    span = NewSpans(num_spans);
+  }
+  CountAllocation(num_spans * kSpanSize);
+  const intptr_t object = RoundSize(span + kSpanHeaderSize, alignment);
+  // Free() looks at the span the object starts in.
+  SpanHeader* headers[2] = {
+    reinterpret_cast<SpanHeader*>(span),
+    SpanOf(reinterpret_cast<void*>(object))
+  };
+  for (int i = 0; i < 2; i++) {
+    headers[i]->owner = this;
+    headers[i]->size_class = kLargeClass;
+    headers[i]->run_start = span;
+    headers[i]->run_spans = num_spans;
+  }
+  return reinterpret_cast<void*>(object);
+}
+
+
+void ThreadLocalAllocator::FreeLarge(void* object) {
+  const SpanHeader* header = SpanOf(object);
+  const intptr_t span = header->run_start;
+  const size_t num_spans = header->run_spans;
+  usage_.live_bytes -= num_spans * kSpanSize;
+  SpanHeader* run = reinterpret_cast<SpanHeader*>(span);
+  run->run_start = span;
+  run->run_spans = num_spans;
+  run->next_run = free_runs_;
+  free_runs_ = span;
+}
+
+
+intptr_t ThreadLocalAllocator::NewSpans(size_t num) {
+  const size_t size = num * kSpanSize;
+  if ((current_ + static_cast<intptr_t>(size)) > end_) {
+    NewArena(size);
+  }
+  const intptr_t span = current_;
+  current_ += size;
+  return span;
+}
+
+
+void ThreadLocalAllocator::Init(size_t prealloc_pages, bool touch_memory) {
+  prealloc_size_ = kPageSize * prealloc_pages;
+  start_ = MapArena(&prealloc_size_, touch_memory);
+  SpanHeader* header = reinterpret_cast<SpanHeader*>(start_);
+  header->next_arena = 0;
+  header->arena_size = prealloc_size_;
+  last_arena_ = start_;
+  ResetBuffer();
+}
+
+
+void ThreadLocalAllocator::PrintArenaJson(FILE* fp) {
+  fprintf(fp, " ,\"arena\": {\"pages\": \"%s\" ,\"numa_local\": %s"
+              " ,\"prefault\": \"%s\" ,\"arenas\": %" PRIu64
+              " ,\"arena_mb\": %" PRIu64 " ,\"hugetlb_fallbacks\": %" PRIu64
+              " ,\"mbind_failures\": %" PRIu64 " ,\"prefault_ms_max\": %.3f}",
+          FLAGS_arena_pages.c_str(),
+          FLAGS_arena_numa_local ? "true" : "false",
+          FLAGS_prefault.c_str(),
+          g_arenas.load(),
+          g_arena_bytes.load() / (1024 * 1024),
+          g_hugetlb_fallbacks.load(),
+          g_mbind_failures.load(),
+          g_prefault_ns_max.load() / 1e6);
+}
+
+
+ThreadLocalAllocator::Usage ThreadLocalAllocator::TotalUsage() {
+  Usage total;
+  memset(&total, 0, sizeof(total));
+  for (ThreadLocalAllocator* tla = allocators_.load();
+       tla != NULL;
+       tla = tla->next_allocator_) {
+    total.allocations += tla->usage_.allocations;
+    total.frees += tla->usage_.frees;
+    total.live_bytes += tla->usage_.live_bytes;
+    total.peak_bytes += tla->usage_.peak_bytes;
+  }
+  return total;
+}
+
+
+void ThreadLocalAllocator::PrintMemoryJson(FILE* fp) {
+  const Usage total = TotalUsage();
+  fprintf(fp, " ,\"memory\": {\"live_bytes\": %" PRIu64
+              " ,\"peak_bytes_sum\": %" PRIu64 " ,\"allocations\": %" PRIu64
+              " ,\"frees\": %" PRIu64 " ,\"aligned_mallocs\": %" PRIu64
+              " ,\"aligned_malloc_bytes\": %" PRIu64 " ,\"threads\": [",
+          total.live_bytes, total.peak_bytes, total.allocations, total.frees,
+          aligned_mallocs.load(), aligned_malloc_bytes.load());
+  bool first = true;
+  for (ThreadLocalAllocator* tla = allocators_.load();
+       tla != NULL;
+       tla = tla->next_allocator_) {
+    const Usage& usage = tla->usage_;
+    if ((usage.allocations == 0) && (usage.frees == 0)) {
+      continue;
+    }
+    fprintf(fp, "%s{\"live_bytes\": %" PRIu64 " ,\"peak_bytes\": %" PRIu64
+                " ,\"allocations\": %" PRIu64 " ,\"frees\": %" PRIu64 "}",
+            first ? "" : ", ", usage.live_bytes, usage.peak_bytes,
+            usage.allocations, usage.frees);
+    first = false;
+  }
+  fprintf(fp, "]}");
+}
+
+
+void ThreadLocalAllocator::NewArena(size_t size) {
+  if (prealloc_size_ == 0) {
+    fprintf(stderr, "%s: thread-local allocator not initialized\n", __func__);
+    abort();
+  }
+  if (FLAGS_warn_on_overflow) {
+    fprintf(stderr, "%p: overflowing buffer. allocating new arena.\n", this);
+  }
+  if (size < prealloc_size_) {
+    size = prealloc_size_;
+  }
+  const intptr_t arena = MapArena(&size, false);
+  SpanHeader* header = reinterpret_cast<SpanHeader*>(arena);
+  header->next_arena = last_arena_;
+  header->arena_size = size;
+  last_arena_ = arena;
+  current_ = arena;
+  end_ = arena + size;
+}
+
+
+void ThreadLocalAllocator::DrainRemoteFrees() {
+  void* object = remote_free_.exchange(NULL);
+  while (object != NULL) {
+    void* next = *static_cast<void**>(object);
+    const uint64_t size_class = SpanOf(object)->size_class;
+    if (size_class == kLargeClass) {
+      FreeLarge(object);
+      object = next;
+      continue;
+    }
+    usage_.live_bytes -= kSizeClasses[size_class];
+    SizeClass& state = classes_[size_class];
+    *static_cast<void**>(object) = state.free;
+    state.free = object;
+    object = next;
+  }
+}
+
+
+void ThreadLocalAllocator::FreeRemote(
+    ThreadLocalAllocator* owner, void* object) {
+  if (owner != remote_owner_) {
+    FlushRemoteFrees();
+    remote_owner_ = owner;
+  }
+  if (remote_count_ == 0) {
+    remote_tail_ = object;
+  }
+  *static_cast<void**>(object) = remote_head_;
+  remote_head_ = object;
+  if (++remote_count_ == kRemoteBatch) {
+    FlushRemoteFrees();
+  }
+}
+
+
+void ThreadLocalAllocator::FlushRemoteFrees() {
+  if (remote_count_ == 0) {
+    return;
+  }
+  std::atomic<void*>& list = remote_owner_->remote_free_;
+  void* head_old = list.load();
+  do {
+    *static_cast<void**>(remote_tail_) = head_old;
+  } while (!list.compare_exchange_weak(head_old, remote_head_));
+  remote_head_ = NULL;
+  remote_tail_ = NULL;
+  remote_count_ = 0;
+}
+
+
+void ThreadLocalAllocator::ResetBuffer() {
+  // Chained arenas are released, keeping only the first one.
+  intptr_t arena = last_arena_;
+  while ((arena != 0) && (arena != start_)) {
+    const SpanHeader* header = reinterpret_cast<SpanHeader*>(arena);
+    const intptr_t next = header->next_arena;
+    munmap(reinterpret_cast<void*>(arena), header->arena_size);
+    arena = next;
+  }
+  last_arena_ = start_;
+  current_ = start_;
+  end_ = start_ + prealloc_size_;
+  last_object_ = 0;
+  usage_.live_bytes = 0;
+  memset(classes_, 0, sizeof(classes_));
+  remote_free_.store(NULL);
+  remote_owner_ = NULL;
+  remote_head_ = NULL;
+  remote_tail_ = NULL;
+  remote_count_ = 0;
+  free_runs_ = 0;
+}
 
 
 size_t HumanSizeToPages(const char* hsize, size_t len) {
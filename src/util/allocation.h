@@ -16,6 +16,7 @@
 
 #include <gflags/gflags.h>
 
+#include <atomic>
 #include <new>
 
 #include "util/platform.h"
@@ -27,6 +28,10 @@ namespace scal {
 
 extern pthread_once_t tla_key_once;
 
+// Blocks allocated through MallocAligned() (and CallocAligned()).
+extern std::atomic<uint64_t> aligned_mallocs;
+extern std::atomic<uint64_t> aligned_malloc_bytes;
+
 size_t HumanSizeToPages(const char* hsize, size_t len);
 
 
@@ -39,6 +44,8 @@ _always_inline size_t RoundSize(uint64_t size, uint64_t round_to) {
 
 
 _always_inline void* MallocAligned(size_t size, size_t alignment) {
+  aligned_mallocs.fetch_add(1, std::memory_order_relaxed);
+  aligned_malloc_bytes.fetch_add(size, std::memory_order_relaxed);
   void* mem;
   if (posix_memalign(reinterpret_cast<void**>(&mem),
                      alignment, size)) {
@@ -57,37 +64,209 @@ _always_inline void* CallocAligned(size_t num, size_t size, size_t alignment) {
 }
 
 
+// Per-thread allocator.
+//
+// Small blocks (up to kMaxSmallSize bytes, aligned to at most
+// kMaxSmallAlignment) are served from size classes. Every size class carves
+// blocks from spans, i.e., kSpanSize-aligned chunks of the thread's arena whose
+// header records the owning allocator and the size class. Blocks of a class
+// are aligned to the largest power of two dividing the class size (up to
+// kMaxSmallAlignment), so aligned requests pick the smallest class that is
+// large and aligned enough. A block freed by its
+// owner goes to the owner's free list of the block's size class. A block freed
+// by another thread (e.g. a queue node allocated by a producer and retired by a
+// consumer) is collected with other blocks of the same owner and returned in a
+// batch to the owner's lock-free remote free list, which the owner drains once
+// a local free list runs empty.
+//
+// Larger blocks get their own runs of spans. Freed runs go to a free list of
+// the owner and are reused (first fit, splitting larger runs) by later large
+// blocks. Alignments of kSpanSize or more are not supported. Arenas are chained, i.e., a thread running out of preallocated
+// memory allocates another arena.
 class ThreadLocalAllocator {
  public:
+  static const size_t kSpanSize = 256 * 1024;
+  static const size_t kMaxSmallSize = 32 * 1024;
+  static const size_t kMaxSmallAlignment = 4096;
+
+  // Memory usage of an allocator (or all allocators). Blocks freed by another
+  // thread are live until their owner picks them up from its remote free list.
+  struct Usage {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+  };
+
   static _always_inline ThreadLocalAllocator& Get();
 
+  // Returns a block allocated by any thread's allocator.
+  static _always_inline void Free(void* object);
+
   _always_inline ThreadLocalAllocator()
-      : prealloc_size_(0),
+      : remote_free_(NULL),
+        prealloc_size_(0),
         start_(0),
+        last_arena_(0),
         end_(0),
-        current_(0) {
+        current_(0),
+        last_object_(0),
+        remote_owner_(NULL),
+        remote_head_(NULL),
+        remote_tail_(NULL),
+        remote_count_(0),
+        free_runs_(0),
+        next_allocator_(NULL) {
+    memset(classes_, 0, sizeof(classes_));
+    memset(&usage_, 0, sizeof(usage_));
   }
 
-  _always_inline void Init(size_t prealloc_size, bool touch_memory);
+  // Maps the first arena as configured by --arena_pages, --arena_numa_local,
+  // and --prefault (if touch_memory is set).
+  void Init(size_t prealloc_size, bool touch_memory);
   _always_inline void* Calloc(size_t num, size_t size);
   _always_inline void* CallocAligned(size_t num, size_t size, size_t alignment);
   _always_inline void* Malloc(size_t size);
   _always_inline void* MallocAligned(size_t size, size_t alignment);
   _always_inline bool TryFreeLast();
 
+  // Prints the arena configuration and statistics of all threads as JSON
+  // member (starting with " ,").
+  static void PrintArenaJson(FILE* fp);
+
+  // Sums up the usage of all threads. Peak bytes are the sum of the peaks of
+  // all threads.
+  static Usage TotalUsage();
+
+  // Prints the total and per-thread usage as JSON member (starting with " ,").
+  static void PrintMemoryJson(FILE* fp);
+
+  inline const Usage& usage() const { return usage_; }
+
+  // Returns the pending batch of blocks freed by this thread to their owner,
+  // e.g., before the thread exits.
+  void FlushRemoteFrees();
+
+  // Picks up the blocks other threads returned to this allocator.
+  void DrainRemoteFrees();
+
+  // Discards all objects allocated so far, making the whole buffer available
+  // again. Callers have to make sure that none of these objects is used
+  // anymore.
+  _always_inline void Reset() { ResetBuffer(); }
+
  private:
+  static const size_t kSpanHeaderSize = 128;
+  static const size_t kNumSizeClasses = 21;
+  static const uint64_t kLargeClass = kNumSizeClasses;
+  // Blocks freed by another thread that are returned to their owner at once.
+  static const uint64_t kRemoteBatch = 32;
+  static const uint32_t kSizeClasses[kNumSizeClasses];
+
+  struct SpanHeader {
+    ThreadLocalAllocator* owner;
+    uint64_t size_class;
+    // Previous arena and size of the arena, only set in the first span of an
+    // arena.
+    intptr_t next_arena;
+    size_t arena_size;
+    // Run of spans of a large block, set in the span the block starts in and
+    // in the first span of the run. Free runs are linked through next_run of
+    // their first span.
+    intptr_t run_start;
+    size_t run_spans;
+    intptr_t next_run;
+  };
+
+  struct SizeClass {
+    void* free;
+    // Unused part of the span blocks of this class are carved from.
+    intptr_t current;
+    intptr_t end;
+  };
+
   static inline void CreateTlaKey();
 
-  _always_inline void ResetBuffer();
+  static _always_inline SpanHeader* SpanOf(void* object) {
+    return reinterpret_cast<SpanHeader*>(
+        reinterpret_cast<intptr_t>(object) & ~(kSpanSize - 1));
+  }
+
+  // Blocks of a size class are aligned to the largest power of two dividing
+  // the class size, see Refill().
+  static _always_inline size_t ClassAlignment(uint64_t size_class) {
+    const size_t size = kSizeClasses[size_class];
+    const size_t alignment = size & (~size + 1);
+    return (alignment < kMaxSmallAlignment) ? alignment : kMaxSmallAlignment;
+  }
+
+  // Returns the index of the smallest size class for size (a multiple of 16).
+  static _always_inline uint64_t SizeClassOf(size_t size) {
+    if (size <= 64) {
+      return (size >> 4) - 1;
+    }
+    if (size <= 256) {
+      return ((size + 63) >> 6) + 2;
+    }
+    // Two classes, 1.5 * 2^p and 2^(p + 1), per power of two above 256.
+    const uint64_t p = 63 - __builtin_clzll(size - 1);
+    return 7 + 2 * (p - 8) + ((size > (3UL << (p - 1))) ? 1 : 0);
+  }
+
+  _always_inline void* AllocSmall(uint64_t size_class) {
+    CountAllocation(kSizeClasses[size_class]);
+    SizeClass& state = classes_[size_class];
+    void* object = state.free;
+    if (object != NULL) {
+      state.free = *static_cast<void**>(object);
+      return object;
+    }
+    return Refill(size_class);
+  }
+
+  _always_inline void CountAllocation(size_t size) {
+    usage_.allocations++;
+    usage_.live_bytes += size;
+    if (usage_.live_bytes > usage_.peak_bytes) {
+      usage_.peak_bytes = usage_.live_bytes;
+    }
+  }
+
+  void* Refill(uint64_t size_class);
+  void* AllocLarge(size_t size, size_t alignment);
+  void FreeLarge(void* object);
+  intptr_t NewSpans(size_t num);
+  void NewArena(size_t size);
+  void FreeRemote(ThreadLocalAllocator* owner, void* object);
+  void ResetBuffer();
 
   static pthread_key_t tla_key;
+  // All allocators ever created, linked through next_allocator_.
+  static std::atomic<ThreadLocalAllocator*> allocators_;
+
+  // Written by other threads.
+  std::atomic<void*> remote_free_;
+  uint8_t pad_[kCachePrefetch - sizeof(std::atomic<void*>)];
 
   size_t prealloc_size_;  // In bytes.
+  // First and most recently allocated arena.
   intptr_t start_;
+  intptr_t last_arena_;
+  // Unused part of the current arena.
   intptr_t end_;
   intptr_t current_;
   // Record of the last allocated block to allow free-ing it.
-  size_t last_size_;
+  intptr_t last_object_;
+  SizeClass classes_[kNumSizeClasses];
+  // Pending batch of blocks freed by this thread but owned by remote_owner_.
+  ThreadLocalAllocator* remote_owner_;
+  void* remote_head_;
+  void* remote_tail_;
+  uint64_t remote_count_;
+  // Free runs of spans of large blocks.
+  intptr_t free_runs_;
+  Usage usage_;
+  ThreadLocalAllocator* next_allocator_;
 };
 
 
@@ -108,63 +287,52 @@ ThreadLocalAllocator& ThreadLocalAllocator::Get() {
       perror("pthread_setspecific");
       abort();
     }
+    ThreadLocalAllocator* head = allocators_.load();
+    do {
+      tla->next_allocator_ = head;
+    } while (!allocators_.compare_exchange_weak(head, tla));
   }
   return *tla;
 }
 
 
-void ThreadLocalAllocator::Init(size_t prealloc_pages, bool touch_memory) {
-  prealloc_size_ = kPageSize * prealloc_pages;
-  start_ = reinterpret_cast<uintptr_t>(
-      scal::MallocAligned(prealloc_size_, kPageSize));
-  ResetBuffer();
-  if (touch_memory) {
-    for (size_t i = 0; i < (prealloc_size_ / sizeof(intptr_t)); i++) {
-      reinterpret_cast<intptr_t*>(start_)[i] = 1;
-      reinterpret_cast<intptr_t*>(start_)[i] = 0;
-    }
+void* ThreadLocalAllocator::Malloc(size_t size) {
+  size = RoundSize((size > 0) ? size : 1, 2 * kWordSize);
+  void* object;
+  if (size <= kMaxSmallSize) {
+    object = AllocSmall(SizeClassOf(size));
+  } else {
+    object = AllocLarge(size, 2 * kWordSize);
   }
+  last_object_ = reinterpret_cast<intptr_t>(object);
+  return object;
 }
 
 
-void* ThreadLocalAllocator::Malloc(size_t size) {
-  size = RoundSize(size, 2 * kWordSize);
-  if (size > prealloc_size_) {
-    fprintf(stderr, "unable to allocate %lu bytes through "
-                    "thread-local allocation", size);
-    abort();
+void* ThreadLocalAllocator::MallocAligned(size_t size, size_t alignment) {
+  if (alignment <= 2 * kWordSize) {
+    return Malloc(size);
   }
-  if ((current_ + static_cast<intptr_t>(size)) >= end_) {
-    if (FLAGS_reuse_memory) {
-      if (FLAGS_warn_on_overflow) {
-        fprintf(stderr, "%p: overflowing buffer. resetting.\n", this);
-      }
-    } else {
-      fprintf(stderr, "warning: allocating new buffer\n");
-      start_ = reinterpret_cast<uintptr_t>(
-          scal::MallocAligned(prealloc_size_, kPageSize));
+  size = RoundSize((size > 0) ? size : 1, alignment);
+  void* object;
+  if ((alignment <= kMaxSmallAlignment) && (size <= kMaxSmallSize)) {
+    // Terminates at the latest with the largest class, which is aligned to
+    // kMaxSmallAlignment.
+    uint64_t size_class = SizeClassOf(size);
+    while (ClassAlignment(size_class) < alignment) {
+      size_class++;
     }
-    ResetBuffer();
+    object = AllocSmall(size_class);
+  } else {
+    object = AllocLarge(size, alignment);
   }
-  last_size_ = size;
-  void* object = reinterpret_cast<void*>(current_);
-  current_ += size;
+  assert((reinterpret_cast<intptr_t>(object) % alignment) == 0);
+  last_object_ = reinterpret_cast<intptr_t>(object);
   return object;
 }
 
 
-void* ThreadLocalAllocator::MallocAligned(size_t size, size_t alignment) {
-  // TODO(ckgroup): Check alignment.
-  size = RoundSize(size, 2 * kWordSize);
-  const size_t alloc_size = size + alignment;
-  intptr_t start = reinterpret_cast<intptr_t>(Malloc(alloc_size));
-  start += alignment - (start % alignment);
-  assert((start % alignment) == 0);
-  return reinterpret_cast<void*>(start);
-}
-
-
-void* ThreadLocalAllocator::Calloc(size_t size, size_t num) {
+void* ThreadLocalAllocator::Calloc(size_t num, size_t size) {
   const size_t alloc_size = RoundSize(size * num, 2 * kWordSize);
   void* object = Malloc(alloc_size);
   memset(object, 0, alloc_size);
@@ -181,17 +349,32 @@ void* ThreadLocalAllocator::CallocAligned(
 }
 
 
-void ThreadLocalAllocator::ResetBuffer() {
-  current_ = start_;
-  end_ = start_ + prealloc_size_;
-  last_size_ = 0;
+void ThreadLocalAllocator::Free(void* object) {
+  if (object == NULL) {
+    return;
+  }
+  SpanHeader* span = SpanOf(object);
+  ThreadLocalAllocator& tla = Get();
+  tla.usage_.frees++;
+  if (span->owner == &tla) {
+    if (span->size_class == kLargeClass) {
+      tla.FreeLarge(object);
+      return;
+    }
+    tla.usage_.live_bytes -= kSizeClasses[span->size_class];
+    SizeClass& state = tla.classes_[span->size_class];
+    *static_cast<void**>(object) = state.free;
+    state.free = object;
+  } else {
+    tla.FreeRemote(span->owner, object);
+  }
 }
 
 
 bool ThreadLocalAllocator::TryFreeLast() {
-  if (last_size_ > 0) {
-    current_ -= last_size_;
-    last_size_ = 0;
+  if (last_object_ != 0) {
+    Free(reinterpret_cast<void*>(last_object_));
+    last_object_ = 0;
     return true;
   }
   return false;
@@ -220,7 +403,7 @@ inline void* ThreadLocalMemory<0>::operator new(size_t size) {
 
 template<int ALIGN>
 inline void ThreadLocalMemory<ALIGN>::operator delete(void* ptr) {
-  ThreadLocalAllocator::Get().TryFreeLast();
+  ThreadLocalAllocator::Free(ptr);
 }
 
 }  // namespace scal
@@ -119,6 +119,10 @@ class AtomicTaggedValue {
     return raw_atomic_.compare_exchange_strong(val, desired.raw_);
   }
 
+  _always_inline TaggedValue<T> exchange(const TaggedValue<T>& desired) {
+    return TaggedValue<T>(raw_atomic_.exchange(desired.raw_));
+  }
+
   _always_inline void* operator new(size_t size) {
     if (ALIGN == 0) {
       return malloc(size);
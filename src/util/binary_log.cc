@@ -0,0 +1,140 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include "util/binary_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace scal {
+
+static_assert(sizeof(BinaryLogHeader) == 64, "unexpected log header size");
+static_assert(sizeof(BinaryLogRecord) == 24, "unexpected log record size");
+
+
+void BinaryLogWriter::Open(
+    const char* path, uint64_t thread_id, uint64_t capacity) {
+  fd_ = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    fprintf(stderr, "%s: unable to open %s: %s\n",
+            __func__, path, strerror(errno));
+    abort();
+  }
+  count_ = 0;
+  Map((capacity > 0) ? capacity : 1);
+  BinaryLogHeader* header = static_cast<BinaryLogHeader*>(base_);
+  memcpy(header->magic, kBinaryLogMagic, sizeof(kBinaryLogMagic));
+  header->record_size = sizeof(BinaryLogRecord);
+  header->thread_id = thread_id;
+  header->num_records = 0;
+}
+
+
+void BinaryLogWriter::Map(uint64_t capacity) {
+  const size_t old_size = sizeof(BinaryLogHeader) +
+                          capacity_ * sizeof(BinaryLogRecord);
+  const size_t new_size = sizeof(BinaryLogHeader) +
+                          capacity * sizeof(BinaryLogRecord);
+  if (ftruncate(fd_, new_size) != 0) {
+    fprintf(stderr, "%s: ftruncate failed: %s\n", __func__, strerror(errno));
+    abort();
+  }
+  void* base;
+  if (base_ == NULL) {
+    base = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  } else {
+    base = mremap(base_, old_size, new_size, MREMAP_MAYMOVE);
+  }
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "%s: mapping the log failed: %s\n",
+            __func__, strerror(errno));
+    abort();
+  }
+  base_ = base;
+  records_ = reinterpret_cast<BinaryLogRecord*>(
+      static_cast<char*>(base_) + sizeof(BinaryLogHeader));
+  capacity_ = capacity;
+}
+
+
+void BinaryLogWriter::Grow() {
+  Map(2 * capacity_);
+}
+
+
+void BinaryLogWriter::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  static_cast<BinaryLogHeader*>(base_)->num_records = count_;
+  munmap(base_, sizeof(BinaryLogHeader) + capacity_ * sizeof(BinaryLogRecord));
+  if (ftruncate(fd_, sizeof(BinaryLogHeader) +
+                     count_ * sizeof(BinaryLogRecord)) != 0) {
+    fprintf(stderr, "%s: ftruncate failed: %s\n", __func__, strerror(errno));
+    abort();
+  }
+  close(fd_);
+  fd_ = -1;
+  base_ = NULL;
+  records_ = NULL;
+  capacity_ = 0;
+}
+
+
+void BinaryLogReader::Open(const char* path) {
+  fd_ = open(path, O_RDONLY);
+  if (fd_ < 0) {
+    fprintf(stderr, "%s: unable to open %s: %s\n",
+            __func__, path, strerror(errno));
+    abort();
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    fprintf(stderr, "%s: fstat failed: %s\n", __func__, strerror(errno));
+    abort();
+  }
+  size_ = st.st_size;
+  if (size_ < sizeof(BinaryLogHeader)) {
+    fprintf(stderr, "%s: %s: file too small\n", __func__, path);
+    abort();
+  }
+  base_ = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (base_ == MAP_FAILED) {
+    fprintf(stderr, "%s: mmap failed: %s\n", __func__, strerror(errno));
+    abort();
+  }
+  header_ = static_cast<const BinaryLogHeader*>(base_);
+  if ((memcmp(header_->magic, kBinaryLogMagic, sizeof(kBinaryLogMagic)) != 0)
+      || (header_->record_size != sizeof(BinaryLogRecord))) {
+    fprintf(stderr, "%s: %s: not a binary operation log\n", __func__, path);
+    abort();
+  }
+  if ((size_ - sizeof(BinaryLogHeader)) / sizeof(BinaryLogRecord)
+      < header_->num_records) {
+    fprintf(stderr, "%s: %s: truncated log\n", __func__, path);
+    abort();
+  }
+  records_ = reinterpret_cast<const BinaryLogRecord*>(
+      static_cast<const char*>(base_) + sizeof(BinaryLogHeader));
+  madvise(base_, size_, MADV_SEQUENTIAL);
+}
+
+
+void BinaryLogReader::Close() {
+  if (base_ != NULL) {
+    munmap(base_, size_);
+    close(fd_);
+  }
+  fd_ = -1;
+  base_ = NULL;
+  header_ = NULL;
+  records_ = NULL;
+}
+
+}  // namespace scal
@@ -0,0 +1,97 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Compact binary operation log.
+//
+// Every thread writes its operations into its own file, which is mapped into
+// memory and grown on demand, i.e., the log is not limited by the amount of
+// preallocated memory and the kernel writes it back while the benchmark is
+// running. A file consists of a BinaryLogHeader followed by num_records
+// BinaryLogRecords in the order the operations were invoked by the thread.
+
+#ifndef SCAL_UTIL_BINARY_LOG_H_
+#define SCAL_UTIL_BINARY_LOG_H_
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+namespace scal {
+
+const char kBinaryLogMagic[8] = { 'S', 'C', 'A', 'L', 'L', 'O', 'G', '1' };
+
+struct BinaryLogHeader {
+  char magic[8];
+  uint64_t record_size;
+  uint64_t thread_id;
+  uint64_t num_records;
+  uint8_t pad[32];
+};
+
+struct BinaryLogRecord {
+  uint64_t item;
+  // Timestamps as returned by get_hwtime().
+  uint64_t invocation;
+  // Response - invocation, saturated at UINT32_MAX.
+  uint32_t duration;
+  // LogType.
+  uint8_t op_type;
+  uint8_t success;
+  uint8_t pad[2];
+};
+
+
+class BinaryLogWriter {
+ public:
+  BinaryLogWriter() : fd_(-1), base_(NULL), records_(NULL), count_(0),
+                      capacity_(0) {}
+
+  // Creates (or truncates) the file at path with room for capacity records.
+  void Open(const char* path, uint64_t thread_id, uint64_t capacity);
+
+  inline BinaryLogRecord* Append() {
+    if (count_ == capacity_) {
+      Grow();
+    }
+    return &records_[count_++];
+  }
+
+  // Writes the header and truncates the file to the records written.
+  void Close();
+
+ private:
+  void Grow();
+  void Map(uint64_t capacity);
+
+  int fd_;
+  void* base_;
+  BinaryLogRecord* records_;
+  uint64_t count_;
+  uint64_t capacity_;
+};
+
+
+class BinaryLogReader {
+ public:
+  BinaryLogReader() : fd_(-1), base_(NULL), size_(0), header_(NULL),
+                      records_(NULL) {}
+
+  // Maps the file read-only and checks the header. Aborts on errors.
+  void Open(const char* path);
+  void Close();
+
+  inline const BinaryLogHeader& header() const { return *header_; }
+  inline const BinaryLogRecord* records() const { return records_; }
+  inline uint64_t num_records() const { return header_->num_records; }
+
+ private:
+  int fd_;
+  void* base_;
+  size_t size_;
+  const BinaryLogHeader* header_;
+  const BinaryLogRecord* records_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_UTIL_BINARY_LOG_H_
@@ -0,0 +1,143 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Stats policies for counting contention inside data structures.
+//
+// Data structures take the policy as template parameter (defaulting to
+// DsStats) and report events through its static members. NoDsStats compiles
+// to nothing. CountingDsStats keeps per-thread counters for the whole process,
+// i.e., events of all instances (and all backends of a distributed data
+// structure) are summed up.
+//
+// Builds defining SCAL_DS_STATS use CountingDsStats as default.
+
+#ifndef SCAL_UTIL_DS_STATS_H_
+#define SCAL_UTIL_DS_STATS_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "util/platform.h"
+#include "util/threadlocals.h"
+
+namespace scal {
+
+enum DsStatsCounter {
+  kCasAttempts = 0,
+  kCasFailures,
+  // Iterations of retry loops, including the first (successful) one.
+  kLoopIterations,
+  // Segments (k-FIFO, k-Stack) added, removed, or advanced past.
+  kSegmentAdvances,
+  // Emptiness checks that had to be restarted because of concurrent puts.
+  kEmptyRescans,
+  kNumDsStatsCounters
+};
+
+
+class NoDsStats {
+ public:
+  static _always_inline void Count(DsStatsCounter counter) {}
+
+  static _always_inline bool Cas(bool success) {
+    return success;
+  }
+
+  static void Reset() {}
+
+  static char* ds_get_stats() {
+    return NULL;
+  }
+};
+
+
+class CountingDsStats {
+ public:
+  static _always_inline void Count(DsStatsCounter counter) {
+    // Only ever written by the owning thread.
+    counters()[ThreadContext::get().thread_id()].values[counter]++;
+  }
+
+  // Counts a CAS given its outcome, which is passed through.
+  static _always_inline bool Cas(bool success) {
+    Count(kCasAttempts);
+    if (!success) {
+      Count(kCasFailures);
+    }
+    return success;
+  }
+
+  static void Reset() {
+    memset(counters(), 0,
+           ThreadContext::get_max_threads() * sizeof(ThreadCounters));
+  }
+
+  // Returns totals and per-thread values as JSON members (starting with " ,").
+  static char* ds_get_stats() {
+    static const char* const kNames[kNumDsStatsCounters] = {
+      "cas_attempts",
+      "cas_failures",
+      "loop_iterations",
+      "segment_advances",
+      "empty_rescans",
+    };
+    ThreadCounters* all = counters();
+    uint64_t totals[kNumDsStatsCounters] = {0};
+    std::string threads;
+    char buffer[64];
+    for (uint64_t i = 0; i < ThreadContext::get_max_threads(); i++) {
+      bool active = false;
+      for (int j = 0; j < kNumDsStatsCounters; j++) {
+        totals[j] += all[i].values[j];
+        active |= all[i].values[j] != 0;
+      }
+      if (!active) {
+        continue;
+      }
+      snprintf(buffer, sizeof(buffer), "%s{\"thread\": %" PRIu64,
+               threads.empty() ? "" : ", ", i);
+      threads += buffer;
+      for (int j = 0; j < kNumDsStatsCounters; j++) {
+        snprintf(buffer, sizeof(buffer), " ,\"%s\": %" PRIu64,
+                 kNames[j], all[i].values[j]);
+        threads += buffer;
+      }
+      threads += "}";
+    }
+    std::string stats;
+    for (int j = 0; j < kNumDsStatsCounters; j++) {
+      snprintf(buffer, sizeof(buffer), " ,\"%s\": %" PRIu64,
+               kNames[j], totals[j]);
+      stats += buffer;
+    }
+    stats += " ,\"ds_stats_threads\": [" + threads + "]";
+    return strdup(stats.c_str());
+  }
+
+ private:
+  struct ThreadCounters {
+    uint64_t values[kNumDsStatsCounters];
+    uint8_t pad[kCachePrefetch - kNumDsStatsCounters * sizeof(uint64_t)];
+  };
+
+  static ThreadCounters* counters() {
+    static ThreadCounters all[ThreadContext::get_max_threads()];
+    return all;
+  }
+};
+
+
+#ifdef SCAL_DS_STATS
+typedef CountingDsStats DsStats;
+#else
+typedef NoDsStats DsStats;
+#endif  // SCAL_DS_STATS
+
+}  // namespace scal
+
+#endif  // SCAL_UTIL_DS_STATS_H_
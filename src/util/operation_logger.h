@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "util/binary_log.h"
 #include "util/malloc.h"
 #include "util/platform.h"
 #include "util/scal-time.h"
@@ -40,6 +41,8 @@ class TLOperationLoggerInterface {
   virtual void invoke(uint64_t type) = 0;
   virtual void response(bool success, T item) = 0;
   virtual void linearization() = 0;
+  // Prints the log, or closes it if it is written to a file.
+  virtual void print_summary() {}
   virtual ~TLOperationLoggerInterface() {}
 };
 
@@ -102,16 +105,74 @@ class TLOperationLogger : public TLOperationLoggerInterface<T> {
   Operation<T> *operations_;
 };
 
+// Writes operations to <prefix>.<thread id> using the binary log format.
+// Linearization points are not recorded.
+template<typename T>
+class TLBinaryOperationLogger : public TLOperationLoggerInterface<T> {
+ public:
+  TLBinaryOperationLogger() {}
+
+  void init(const char* prefix, uint64_t thread_id, uint64_t num_ops) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s.%" PRIu64, prefix, thread_id);
+    writer_.Open(path, thread_id, num_ops);
+  }
+
+  inline void invoke(uint64_t type) {
+    op_type_ = type;
+    invocation_ = get_hwtime();
+  }
+
+  inline void response(bool success, T item) {
+    const uint64_t duration = get_hwtime() - invocation_;
+    BinaryLogRecord* record = writer_.Append();
+    record->item = success ? static_cast<uint64_t>(item) : 0;
+    record->invocation = invocation_;
+    record->duration = (duration > UINT32_MAX) ? UINT32_MAX : duration;
+    record->op_type = op_type_;
+    record->success = success;
+  }
+
+  inline void linearization() {}
+
+  void print_summary() {
+    writer_.Close();
+  }
+
+ private:
+  BinaryLogWriter writer_;
+  uint64_t op_type_;
+  uint64_t invocation_;
+};
+
 template<typename T>
 class OperationLogger {
  public:
   static void prepare(uint64_t num_threads, uint64_t num_ops) {
     num_loggers_ = num_threads;
-    tl_loggers_ = static_cast<TLOperationLogger<T>**>(calloc(
-        num_threads, sizeof(TLOperationLogger<T>*))); 
+    tl_loggers_ = static_cast<TLOperationLoggerInterface<T>**>(calloc(
+        num_threads, sizeof(TLOperationLoggerInterface<T>*)));
+    for (uint64_t i = 0; i < num_threads; i++) {
+      TLOperationLogger<T>* logger =
+          scal::get<TLOperationLogger<T>>(kPageSize);
+      logger->init(num_ops);
+      tl_loggers_[i] = logger;
+    }
+    active_ = true;
+  }
+
+  // Like prepare() but every thread streams into its own binary log file.
+  // num_ops is only the initial capacity of a file.
+  static void prepare_binary(
+      uint64_t num_threads, uint64_t num_ops, const char* prefix) {
+    num_loggers_ = num_threads;
+    tl_loggers_ = static_cast<TLOperationLoggerInterface<T>**>(calloc(
+        num_threads, sizeof(TLOperationLoggerInterface<T>*)));
     for (uint64_t i = 0; i < num_threads; i++) {
-      tl_loggers_[i] = scal::get<TLOperationLogger<T>>(kPageSize);
-      tl_loggers_[i]->init(num_ops);
+      TLBinaryOperationLogger<T>* logger =
+          scal::get<TLBinaryOperationLogger<T>>(kPageSize);
+      logger->init(prefix, i, num_ops);
+      tl_loggers_[i] = logger;
     }
     active_ = true;
   }
@@ -142,14 +203,14 @@ class OperationLogger {
   }
 
  private:
-  static TLOperationLogger<T> **tl_loggers_;
+  static TLOperationLoggerInterface<T> **tl_loggers_;
   static uint64_t num_loggers_;
   static bool active_;
   static TLOperationLoggerNoop<T> noop_logger_;
 };
 
 template<typename T>
-TLOperationLogger<T>** OperationLogger<T>::tl_loggers_ = NULL;
+TLOperationLoggerInterface<T>** OperationLogger<T>::tl_loggers_ = NULL;
 
 template<typename T>
 uint64_t OperationLogger<T>::num_loggers_ = 0;
@@ -0,0 +1,406 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+// Safe memory reclamation policies for linked lock-free data structures.
+//
+// Data structures take the policy as template parameter (defaulting to
+// Reclamation) and bracket every operation with a Guard. Pointers that are
+// dereferenced are read through Guard::Load() (or announced with
+// Guard::Protect() and then re-validated by the caller). Unlinked objects are
+// handed to Guard::Retire() and reclaimed once no thread can access them
+// anymore. Guards must not be nested; helpers of an operation take the
+// operation's guard as argument.
+//
+// NoReclamation compiles to nothing and never reclaims, i.e., it leaks
+// unlinked objects as data structures did before. HazardPointers implements
+//
+// M. Michael. Hazard pointers: Safe memory reclamation for lock-free objects.
+// IEEE Transactions on Parallel and Distributed Systems, 15(6):491–504, 2004.
+//
+// EpochReclamation implements epoch-based reclamation from
+//
+// K. Fraser. Practical lock-freedom. PhD thesis, University of Cambridge,
+// 2004.
+//
+// Builds defining SCAL_RECLAMATION_HP or SCAL_RECLAMATION_EPOCH use the
+// respective policy as default.
+
+#ifndef SCAL_UTIL_RECLAMATION_H_
+#define SCAL_UTIL_RECLAMATION_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "util/platform.h"
+#include "util/scal-time.h"
+#include "util/threadlocals.h"
+
+namespace scal {
+
+typedef void (*ReclaimFunction)(void* object);
+
+template<typename T>
+void ReclaimObject(void* object) {
+  delete static_cast<T*>(object);
+}
+
+
+enum ReclamationCounter {
+  kRetired = 0,
+  kReclaimed,
+  // Hazard pointer scans or epoch advances.
+  kScans,
+  // TSC cycles spent in scans and reclaiming objects.
+  kReclaimCycles,
+  kNumReclamationCounters
+};
+
+
+namespace reclamation_detail {
+
+struct Retired {
+  void* object;
+  ReclaimFunction reclaim;
+};
+
+
+// Threads with a thread id below the returned value have used a policy.
+inline std::atomic<uint64_t>& ActiveThreads() {
+  static std::atomic<uint64_t> active(0);
+  return active;
+}
+
+
+inline void RegisterThread(uint64_t thread_id) {
+  std::atomic<uint64_t>& active = ActiveThreads();
+  uint64_t old = active.load();
+  while ((old <= thread_id) &&
+         !active.compare_exchange_weak(old, thread_id + 1)) {
+  }
+}
+
+
+inline void ReclaimAll(std::vector<Retired>* list, uint64_t* counters) {
+  for (size_t i = 0; i < list->size(); i++) {
+    (*list)[i].reclaim((*list)[i].object);
+  }
+  counters[kReclaimed] += list->size();
+  list->clear();
+}
+
+
+template<class Record>
+void PrintJson(FILE* fp, const char* policy, Record* records) {
+  uint64_t totals[kNumReclamationCounters] = {0};
+  const uint64_t num_threads = ActiveThreads().load();
+  for (uint64_t i = 0; i < num_threads; i++) {
+    for (int j = 0; j < kNumReclamationCounters; j++) {
+      totals[j] += records[i].counters[j];
+    }
+  }
+  fprintf(fp, " ,\"reclamation\": {\"policy\": \"%s\" ,\"retired\": %" PRIu64
+              " ,\"reclaimed\": %" PRIu64 " ,\"pending\": %" PRIu64
+              " ,\"scans\": %" PRIu64 " ,\"reclaim_cycles\": %" PRIu64 "}",
+          policy, totals[kRetired], totals[kReclaimed],
+          totals[kRetired] - totals[kReclaimed], totals[kScans],
+          totals[kReclaimCycles]);
+}
+
+}  // namespace reclamation_detail
+
+
+class NoReclamation {
+ public:
+  // Whether callers have to validate pointers after Protect().
+  static const bool kHazards = false;
+
+  class Guard {
+   public:
+    _always_inline Guard() {}
+
+    _always_inline void Protect(int slot, const void* object) {}
+
+    template<typename A>
+    _always_inline auto Load(int slot, A* src) -> decltype(src->load()) {
+      return src->load();
+    }
+
+    _always_inline void Retire(void* object, ReclaimFunction reclaim) {}
+  };
+
+  static void PrintJson(FILE* fp) {}
+};
+
+
+class HazardPointers {
+ private:
+  struct Record;
+
+ public:
+  static const bool kHazards = true;
+  static const int kSlots = 4;
+
+  class Guard {
+   public:
+    _always_inline Guard() : record_(HazardPointers::GetRecord()) {}
+
+    _always_inline ~Guard() {
+      for (int i = 0; i < kSlots; i++) {
+        record_->hazards[i].store(NULL, std::memory_order_release);
+      }
+    }
+
+    // Callers have to check that object is still reachable afterwards.
+    _always_inline void Protect(int slot, const void* object) {
+      // Sequentially consistent to order the announcement before the
+      // validating load.
+      record_->hazards[slot].store(object);
+    }
+
+    // Returns the value of src with its pointer protected in slot.
+    template<typename A>
+    _always_inline auto Load(int slot, A* src) -> decltype(src->load()) {
+      decltype(src->load()) value = src->load();
+      while (true) {
+        Protect(slot, value.value());
+        const decltype(src->load()) current = src->load();
+        if (current == value) {
+          return value;
+        }
+        value = current;
+      }
+    }
+
+    _always_inline void Retire(void* object, ReclaimFunction reclaim) {
+      HazardPointers::Retire(record_, object, reclaim);
+    }
+
+   private:
+    Record* record_;
+  };
+
+  static void PrintJson(FILE* fp) {
+    reclamation_detail::PrintJson(fp, "hp", records());
+  }
+
+ private:
+  // Objects are only scanned for if more than this many (plus twice the
+  // number of hazard pointers) are pending on a thread.
+  static const uint64_t kScanThreshold = 64;
+
+  struct Record {
+    std::atomic<const void*> hazards[kSlots];
+    uint8_t pad[kCachePrefetch - kSlots * sizeof(void*)];
+    bool registered;
+    std::vector<reclamation_detail::Retired> retired;
+    uint64_t counters[kNumReclamationCounters];
+  };
+
+  static Record* records() {
+    static Record all[ThreadContext::get_max_threads()];
+    return all;
+  }
+
+  static _always_inline Record* GetRecord() {
+    const uint64_t thread_id = ThreadContext::get().thread_id();
+    Record* record = &records()[thread_id];
+    if (!record->registered) {
+      record->registered = true;
+      reclamation_detail::RegisterThread(thread_id);
+    }
+    return record;
+  }
+
+  static _always_inline void Retire(
+      Record* record, void* object, ReclaimFunction reclaim) {
+    const reclamation_detail::Retired retired = { object, reclaim };
+    record->retired.push_back(retired);
+    record->counters[kRetired]++;
+    if (record->retired.size() >=
+        kScanThreshold + 2 * kSlots * reclamation_detail::ActiveThreads()) {
+      Scan(record);
+    }
+  }
+
+  static void Scan(Record* record);
+};
+
+
+inline void HazardPointers::Scan(Record* record) {
+  const uint64_t start = get_hwtime();
+  const uint64_t num_threads = reclamation_detail::ActiveThreads().load();
+  Record* all = records();
+  std::vector<const void*> hazards;
+  hazards.reserve(num_threads * kSlots);
+  for (uint64_t i = 0; i < num_threads; i++) {
+    for (int j = 0; j < kSlots; j++) {
+      const void* object = all[i].hazards[j].load();
+      if (object != NULL) {
+        hazards.push_back(object);
+      }
+    }
+  }
+  std::sort(hazards.begin(), hazards.end());
+  std::vector<reclamation_detail::Retired>& retired = record->retired;
+  size_t kept = 0;
+  for (size_t i = 0; i < retired.size(); i++) {
+    if (std::binary_search(hazards.begin(), hazards.end(),
+                           retired[i].object)) {
+      retired[kept++] = retired[i];
+    } else {
+      retired[i].reclaim(retired[i].object);
+      record->counters[kReclaimed]++;
+    }
+  }
+  retired.resize(kept);
+  record->counters[kScans]++;
+  record->counters[kReclaimCycles] += get_hwtime() - start;
+}
+
+
+class EpochReclamation {
+ private:
+  struct Record;
+
+ public:
+  static const bool kHazards = false;
+
+  class Guard {
+   public:
+    _always_inline Guard() : record_(EpochReclamation::GetRecord()) {
+      // Sequentially consistent to order the announcement before any load of
+      // the data structure. The epoch is re-read after announcing it, as a
+      // thread preempted in between would otherwise announce (and retire in)
+      // an epoch that has already been left, letting TryAdvance() reclaim
+      // objects it may still access.
+      uint64_t epoch;
+      do {
+        epoch = GlobalEpoch().load();
+        record_->state.store((epoch << 1) | 1);
+      } while (GlobalEpoch().load() != epoch);
+    }
+
+    _always_inline ~Guard() {
+      record_->state.store(0, std::memory_order_release);
+    }
+
+    _always_inline void Protect(int slot, const void* object) {}
+
+    template<typename A>
+    _always_inline auto Load(int slot, A* src) -> decltype(src->load()) {
+      return src->load();
+    }
+
+    _always_inline void Retire(void* object, ReclaimFunction reclaim) {
+      EpochReclamation::Retire(record_, object, reclaim);
+    }
+
+   private:
+    Record* record_;
+  };
+
+  static void PrintJson(FILE* fp) {
+    reclamation_detail::PrintJson(fp, "epoch", records());
+  }
+
+ private:
+  // Retires between two attempts to advance the global epoch.
+  static const uint64_t kAdvanceInterval = 64;
+
+  struct Record {
+    // Announced epoch shifted by one, lowest bit set while in an operation.
+    std::atomic<uint64_t> state;
+    uint8_t pad[kCachePrefetch - sizeof(uint64_t)];
+    bool registered;
+    uint64_t retires;
+    // Objects retired in epoch limbo_epochs[i] with i == epoch % 3.
+    std::vector<reclamation_detail::Retired> limbo[3];
+    uint64_t limbo_epochs[3];
+    uint64_t counters[kNumReclamationCounters];
+  };
+
+  static std::atomic<uint64_t>& GlobalEpoch() {
+    static std::atomic<uint64_t> epoch(0);
+    return epoch;
+  }
+
+  static Record* records() {
+    static Record all[ThreadContext::get_max_threads()];
+    return all;
+  }
+
+  static _always_inline Record* GetRecord() {
+    const uint64_t thread_id = ThreadContext::get().thread_id();
+    Record* record = &records()[thread_id];
+    if (!record->registered) {
+      record->registered = true;
+      reclamation_detail::RegisterThread(thread_id);
+    }
+    return record;
+  }
+
+  static _always_inline void Retire(
+      Record* record, void* object, ReclaimFunction reclaim) {
+    const uint64_t epoch = record->state.load(std::memory_order_relaxed) >> 1;
+    const int index = epoch % 3;
+    if (record->limbo_epochs[index] != epoch) {
+      // Objects from epoch - 3 or earlier.
+      reclamation_detail::ReclaimAll(&record->limbo[index], record->counters);
+      record->limbo_epochs[index] = epoch;
+    }
+    const reclamation_detail::Retired retired = { object, reclaim };
+    record->limbo[index].push_back(retired);
+    record->counters[kRetired]++;
+    if ((++record->retires % kAdvanceInterval) == 0) {
+      TryAdvance(record, epoch);
+    }
+  }
+
+  static void TryAdvance(Record* record, uint64_t epoch);
+};
+
+
+inline void EpochReclamation::TryAdvance(Record* record, uint64_t epoch) {
+  const uint64_t start = get_hwtime();
+  const uint64_t num_threads = reclamation_detail::ActiveThreads().load();
+  Record* all = records();
+  for (uint64_t i = 0; i < num_threads; i++) {
+    const uint64_t state = all[i].state.load();
+    if (((state & 1) != 0) && ((state >> 1) != epoch)) {
+      return;
+    }
+  }
+  uint64_t expected = epoch;
+  if (GlobalEpoch().compare_exchange_strong(expected, epoch + 1)) {
+    record->counters[kScans]++;
+  }
+  // Objects retired two epochs before the current one cannot be accessed
+  // anymore.
+  const uint64_t current = GlobalEpoch().load();
+  for (int i = 0; i < 3; i++) {
+    if (!record->limbo[i].empty() &&
+        (record->limbo_epochs[i] + 2 <= current)) {
+      reclamation_detail::ReclaimAll(&record->limbo[i], record->counters);
+    }
+  }
+  record->counters[kReclaimCycles] += get_hwtime() - start;
+}
+
+
+#if defined(SCAL_RECLAMATION_HP)
+typedef HazardPointers Reclamation;
+#elif defined(SCAL_RECLAMATION_EPOCH)
+typedef EpochReclamation Reclamation;
+#else
+typedef NoReclamation Reclamation;
+#endif
+
+}  // namespace scal
+
+#endif  // SCAL_UTIL_RECLAMATION_H_
@@ -0,0 +1,167 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#include "util/topology.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "util/platform.h"
+
+namespace {
+
+const char kCpuPath[] = "/sys/devices/system/cpu";
+const char kNodePath[] = "/sys/devices/system/node";
+
+// Reads the first line of a (sysfs) file, without the trailing newline.
+bool ReadLine(const std::string& path, std::string* line) {
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == NULL) {
+    return false;
+  }
+  char buffer[4096];
+  const bool ok = (fgets(buffer, sizeof(buffer), fp) != NULL);
+  fclose(fp);
+  if (!ok) {
+    return false;
+  }
+  buffer[strcspn(buffer, "\n")] = '\0';
+  *line = buffer;
+  return true;
+}
+
+
+bool ReadInt(const std::string& path, int* value) {
+  std::string line;
+  if (!ReadLine(path, &line) || line.empty()) {
+    return false;
+  }
+  char* end;
+  *value = static_cast<int>(strtol(line.c_str(), &end, 10));
+  return *end == '\0';
+}
+
+
+bool CompareCpuIds(const scal::CpuInfo& a, const scal::CpuInfo& b) {
+  return a.cpu < b.cpu;
+}
+
+}  // namespace
+
+namespace scal {
+
+CpuTopology& CpuTopology::Get() {
+  static CpuTopology topology;
+  return topology;
+}
+
+
+bool CpuTopology::ParseCpuList(const std::string& list,
+                               std::vector<int>* cpus) {
+  const char* pos = list.c_str();
+  while (*pos != '\0') {
+    char* end;
+    const long first = strtol(pos, &end, 10);
+    if ((end == pos) || (first < 0)) {
+      return false;
+    }
+    long last = first;
+    pos = end;
+    if (*pos == '-') {
+      pos++;
+      last = strtol(pos, &end, 10);
+      if ((end == pos) || (last < first)) {
+        return false;
+      }
+      pos = end;
+    }
+    for (long cpu = first; cpu <= last; cpu++) {
+      cpus->push_back(static_cast<int>(cpu));
+    }
+    if (*pos == ',') {
+      pos++;
+    } else if (*pos != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+CpuTopology::CpuTopology() {
+  std::string line;
+  std::vector<int> online;
+  if (!ReadLine(std::string(kCpuPath) + "/online", &line) ||
+      !ParseCpuList(line, &online) ||
+      online.empty()) {
+    online.clear();
+    for (long i = 0; i < number_of_cores(); i++) {
+      online.push_back(static_cast<int>(i));
+    }
+  }
+
+  std::map<int, int> cpu_to_node;
+  DIR* dir = opendir(kNodePath);
+  if (dir != NULL) {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+      int node;
+      if (sscanf(entry->d_name, "node%d", &node) != 1) {
+        continue;
+      }
+      std::vector<int> node_cpus;
+      if (ReadLine(std::string(kNodePath) + "/" + entry->d_name + "/cpulist",
+                   &line) &&
+          ParseCpuList(line, &node_cpus)) {
+        for (size_t i = 0; i < node_cpus.size(); i++) {
+          cpu_to_node[node_cpus[i]] = node;
+        }
+      }
+    }
+    closedir(dir);
+  }
+
+  for (size_t i = 0; i < online.size(); i++) {
+    CpuInfo info;
+    info.cpu = online[i];
+    char path[256];
+    snprintf(path, sizeof(path), "%s/cpu%d/topology/", kCpuPath, info.cpu);
+    if (!ReadInt(std::string(path) + "physical_package_id", &info.socket) ||
+        (info.socket < 0)) {
+      info.socket = 0;
+    }
+    if (!ReadInt(std::string(path) + "core_id", &info.core)) {
+      info.core = info.cpu;
+    }
+    std::map<int, int>::const_iterator it = cpu_to_node.find(info.cpu);
+    info.node = (it == cpu_to_node.end()) ? 0 : it->second;
+    info.smt = 0;
+    cpus_.push_back(info);
+  }
+  std::sort(cpus_.begin(), cpus_.end(), CompareCpuIds);
+
+  // Siblings get increasing SMT indices in the order of their cpu ids.
+  std::map<std::pair<int, int>, int> siblings;
+  for (size_t i = 0; i < cpus_.size(); i++) {
+    cpus_[i].smt = siblings[std::make_pair(cpus_[i].socket, cpus_[i].core)]++;
+  }
+}
+
+
+const CpuInfo* CpuTopology::Find(int cpu) const {
+  for (size_t i = 0; i < cpus_.size(); i++) {
+    if (cpus_[i].cpu == cpu) {
+      return &cpus_[i];
+    }
+  }
+  return NULL;
+}
+
+}  // namespace scal
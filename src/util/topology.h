@@ -0,0 +1,49 @@
+// Copyright (c) 2016, the Scal Project Authors.  All rights reserved.
+// Please see the AUTHORS file for details.  Use of this source code is governed
+// by a BSD license that can be found in the LICENSE file.
+
+#ifndef SCAL_UTIL_TOPOLOGY_H_
+#define SCAL_UTIL_TOPOLOGY_H_
+
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+namespace scal {
+
+// A single hardware thread (logical cpu) as seen by the OS.
+struct CpuInfo {
+  int cpu;
+  int socket;
+  int core;  // Only unique within a socket.
+  int node;
+  int smt;   // Index of this cpu among the siblings of its core.
+};
+
+
+// CPU topology of the machine, read from /sys/devices/system/cpu and
+// /sys/devices/system/node. If sysfs is not available every online cpu is
+// treated as a core of its own on socket 0, node 0.
+class CpuTopology {
+ public:
+  static CpuTopology& Get();
+
+  inline const std::vector<CpuInfo>& cpus() const { return cpus_; }
+
+  // Returns the info for a given logical cpu, or NULL if it is not online.
+  const CpuInfo* Find(int cpu) const;
+
+  // Parses a list in sysfs format, e.g., "0-3,8,10-11".  Returns false on
+  // malformed input.
+  static bool ParseCpuList(const std::string& list, std::vector<int>* cpus);
+
+ private:
+  CpuTopology();
+
+  std::vector<CpuInfo> cpus_;
+};
+
+}  // namespace scal
+
+#endif  // SCAL_UTIL_TOPOLOGY_H_